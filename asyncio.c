@@ -0,0 +1,555 @@
+/**
+ * @file asyncio.c
+ * @brief Implementation of the asynchronous file I/O backend
+ */
+
+#include "asyncio.h"
+#include "memtrack.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define RING_ENTRIES 8          /* Submission slots, more than the buffers in flight */
+
+IoBackend ioBackend = IO_BACKEND_URING;
+
+/* An io_uring instance with its mapped submission and completion rings */
+typedef struct {
+    int fd;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned* sqArray;
+    struct io_uring_sqe* sqes;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe* cqes;
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+    unsigned queued;    /* Requests published but not yet submitted */
+    unsigned pending;   /* Requests submitted and not yet completed */
+} Uring;
+
+typedef struct {
+    char* data;
+    ssize_t length;     /* Bytes read, or -errno */
+    off_t offset;       /* File offset the buffer is read from */
+    bool done;          /* Read completed */
+} ReadSlot;
+
+struct AsyncReader {
+    int fd;
+    bool useUring;
+    Uring ring;
+    ReadSlot slots[ASYNC_QUEUE_DEPTH];
+    unsigned next;      /* Sequence number of the next buffer handed out */
+    bool handedOut;     /* The previous buffer is still with the caller */
+    off_t offset;       /* File offset of the next read to submit */
+    off_t size;         /* File size when opened */
+    bool endOfFile;     /* A short read was seen; nothing more is queued */
+};
+
+typedef struct {
+    char* data;
+    size_t length;
+    off_t offset;       /* File offset the buffer is written at */
+    bool busy;          /* Write in flight */
+} WriteSlot;
+
+struct AsyncWriter {
+    int fd;
+    bool useUring;
+    Uring ring;
+    WriteSlot slots[ASYNC_QUEUE_DEPTH];
+    int slotCount;
+    int current;        /* Slot being filled */
+    off_t offset;       /* File offset of the current slot */
+    bool failed;
+    int error;
+};
+
+static pthread_once_t probeOnce = PTHREAD_ONCE_INIT;
+static bool uringUsable = false;
+
+/* ---- io_uring through raw system calls ---- */
+
+static void* mapRing(int fd, size_t size, off_t offset) {
+    void* ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return ring == MAP_FAILED ? NULL : ring;
+}
+
+static void uringExit(Uring* ring) {
+    if (ring->sqes != NULL) munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing != NULL && ring->cqRing != ring->sqRing) munmap(ring->cqRing, ring->cqRingSize);
+    if (ring->sqRing != NULL) munmap(ring->sqRing, ring->sqRingSize);
+    if (ring->fd >= 0) close(ring->fd);
+    memset(ring, 0, sizeof(Uring));
+    ring->fd = -1;
+}
+
+static bool uringInit(Uring* ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(Uring));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return false;
+    }
+
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap && ring->cqRingSize > ring->sqRingSize) {
+        ring->sqRingSize = ring->cqRingSize;
+    }
+
+    ring->sqRing = mapRing(ring->fd, ring->sqRingSize, IORING_OFF_SQ_RING);
+    ring->cqRing = singleMap ? ring->sqRing : mapRing(ring->fd, ring->cqRingSize, IORING_OFF_CQ_RING);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)mapRing(ring->fd, ring->sqesSize, IORING_OFF_SQES);
+    if (ring->sqRing == NULL || ring->cqRing == NULL || ring->sqes == NULL) {
+        uringExit(ring);
+        return false;
+    }
+
+    char* sq = (char*)ring->sqRing;
+    char* cq = (char*)ring->cqRing;
+    ring->sqTail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+    ring->cqHead = (unsigned*)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return true;
+}
+
+/**
+ * Publish a filled request; it is handed to the kernel by uringSubmit.
+ * Callers never have more than RING_ENTRIES requests outstanding, so
+ * the submission ring can't overflow.
+ */
+static void uringQueue(Uring* ring, const struct io_uring_sqe* request) {
+    unsigned tail = *ring->sqTail;
+    unsigned index = tail & ring->sqMask;
+    ring->sqes[index] = *request;
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ring->queued++;
+}
+
+/**
+ * Submit the queued requests and optionally wait for a completion.
+ * Requests the kernel did not take stay queued for the next call.
+ * @return false if the kernel rejected the call
+ */
+static bool uringSubmit(Uring* ring, bool wait) {
+    int result;
+    do {
+        result = (int)syscall(__NR_io_uring_enter, ring->fd, ring->queued, wait ? 1 : 0,
+                              wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+        return false;
+    }
+    ring->queued -= (unsigned)result;
+    ring->pending += (unsigned)result;
+    return true;
+}
+
+static bool uringReap(Uring* ring, uint64_t* request, int* result) {
+    unsigned head = *ring->cqHead;
+    if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    const struct io_uring_cqe* completion = &ring->cqes[head & ring->cqMask];
+    *request = completion->user_data;
+    *result = completion->res;
+    __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+    ring->pending--;
+    return true;
+}
+
+/**
+ * Wait for the next completion
+ * @return false if the ring failed; nothing more will complete
+ */
+static bool uringWait(Uring* ring, uint64_t* request, int* result) {
+    while (!uringReap(ring, request, result)) {
+        if (!uringSubmit(ring, true)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void prepareRequest(struct io_uring_sqe* request, uint8_t opcode, int fd, const void* address,
+                           unsigned length, off_t offset, uint64_t userData) {
+    memset(request, 0, sizeof(*request));
+    request->opcode = opcode;
+    request->fd = fd;
+    request->addr = (uint64_t)(uintptr_t)address;
+    request->len = length;
+    request->off = (uint64_t)offset;
+    request->user_data = userData;
+}
+
+/**
+ * Check once that io_uring can be set up and supports the requests used
+ */
+static void probeUring(void) {
+    Uring ring;
+    if (!uringInit(&ring, 2)) {
+        return;
+    }
+
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = (struct io_uring_probe*)trackedCalloc(1, size, MEM_IO_BUFFERS);
+    if (probe != NULL && syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PROBE, probe, 256) == 0) {
+        uringUsable = probe->last_op >= IORING_OP_WRITE &&
+                      (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+                      (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    }
+    trackedFree(probe);
+    uringExit(&ring);
+}
+
+bool asyncIoUsesUring(void) {
+    if (ioBackend == IO_BACKEND_BLOCKING) {
+        return false;
+    }
+    pthread_once(&probeOnce, probeUring);
+    return uringUsable;
+}
+
+const char* asyncIoBackendName(void) {
+    return asyncIoUsesUring() ? "io_uring" : "blocking";
+}
+
+/* ---- Reading ---- */
+
+/**
+ * Queue a read of the part of the slot's buffer not filled yet
+ */
+static void queueSlotRead(AsyncReader* reader, ReadSlot* slot, unsigned index) {
+    struct io_uring_sqe request;
+    prepareRequest(&request, IORING_OP_READ, reader->fd, slot->data + slot->length,
+                   ASYNC_BUFFER_SIZE - (unsigned)slot->length, slot->offset + slot->length, index);
+    uringQueue(&reader->ring, &request);
+}
+
+static void queueRead(AsyncReader* reader, ReadSlot* slot, unsigned index) {
+    slot->offset = reader->offset;
+    slot->length = 0;
+    slot->done = false;
+    queueSlotRead(reader, slot, index);
+    reader->offset += ASYNC_BUFFER_SIZE;
+}
+
+AsyncReader* openAsyncReader(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    AsyncReader* reader = (AsyncReader*)trackedCalloc(1, sizeof(AsyncReader), MEM_IO_BUFFERS);
+    if (reader == NULL) {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    reader->fd = fd;
+    reader->ring.fd = -1;
+    struct stat info;
+    reader->size = fstat(fd, &info) == 0 ? info.st_size : 0;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    reader->useUring = asyncIoUsesUring() && uringInit(&reader->ring, RING_ENTRIES);
+    int buffers = reader->useUring ? ASYNC_QUEUE_DEPTH : 1;
+    for (int i = 0; i < buffers; i++) {
+        reader->slots[i].data = (char*)trackedMalloc(ASYNC_BUFFER_SIZE + 1, MEM_IO_BUFFERS);
+        if (reader->slots[i].data == NULL) {
+            closeAsyncReader(reader);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    // Every buffer starts with a read in flight
+    if (reader->useUring) {
+        for (unsigned i = 0; i < ASYNC_QUEUE_DEPTH; i++) {
+            queueRead(reader, &reader->slots[i], i);
+        }
+        uringSubmit(&reader->ring, false);
+    }
+    return reader;
+}
+
+static ssize_t readBlocking(AsyncReader* reader, char** data) {
+    char* buffer = reader->slots[0].data;
+    size_t filled = 0;
+
+    // Fill the whole buffer so both backends hand out the same chunks
+    while (filled < ASYNC_BUFFER_SIZE) {
+        ssize_t count = read(reader->fd, buffer + filled, ASYNC_BUFFER_SIZE - filled);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) return -1;
+        if (count == 0) break;
+        filled += (size_t)count;
+    }
+    *data = buffer;
+    return (ssize_t)filled;
+}
+
+ssize_t asyncReadNext(AsyncReader* reader, char** data) {
+    if (!reader->useUring) {
+        return readBlocking(reader, data);
+    }
+
+    // The buffer the caller is done with takes the next read
+    if (reader->handedOut) {
+        unsigned previous = (reader->next - 1) % ASYNC_QUEUE_DEPTH;
+        if (!reader->endOfFile) {
+            queueRead(reader, &reader->slots[previous], previous);
+            uringSubmit(&reader->ring, false);
+        }
+        reader->handedOut = false;
+    }
+    if (reader->endOfFile) {
+        return 0;
+    }
+
+    ReadSlot* slot = &reader->slots[reader->next % ASYNC_QUEUE_DEPTH];
+    while (!slot->done) {
+        uint64_t index;
+        int result;
+        if (!uringWait(&reader->ring, &index, &result)) {
+            return -1;
+        }
+
+        // A read may come up short before the end of the file; the rest of
+        // the buffer is read from where it stopped. Only an empty read, or
+        // reaching the size the file had when opened, ends the file.
+        ReadSlot* completed = &reader->slots[index];
+        if (result < 0) {
+            completed->length = result;
+        } else {
+            completed->length += result;
+            if (result > 0 && completed->length < ASYNC_BUFFER_SIZE &&
+                completed->offset + completed->length < reader->size) {
+                queueSlotRead(reader, completed, (unsigned)index);
+                continue;
+            }
+        }
+        completed->done = true;
+    }
+    if (slot->length < 0) {
+        errno = (int)-slot->length;
+        return -1;
+    }
+
+    // Only the last buffer of the file is short
+    if (slot->length < ASYNC_BUFFER_SIZE) {
+        reader->endOfFile = true;
+    }
+    slot->done = false;
+    reader->next++;
+    reader->handedOut = true;
+    *data = slot->data;
+    return slot->length;
+}
+
+void closeAsyncReader(AsyncReader* reader) {
+    if (reader == NULL) {
+        return;
+    }
+
+    // The kernel may still be filling buffers; wait before freeing them
+    if (reader->useUring) {
+        uint64_t index;
+        int result;
+        while (reader->ring.pending > 0 && uringWait(&reader->ring, &index, &result)) {
+        }
+        uringExit(&reader->ring);
+    }
+    for (int i = 0; i < ASYNC_QUEUE_DEPTH; i++) {
+        trackedFree(reader->slots[i].data);
+    }
+    close(reader->fd);
+    trackedFree(reader);
+}
+
+/* ---- Writing ---- */
+
+/**
+ * Write a whole buffer with blocking calls (also finishes short writes)
+ */
+static bool writeFully(int fd, const char* data, size_t length, off_t offset) {
+    while (length > 0) {
+        ssize_t count = pwrite(fd, data, length, offset);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        data += count;
+        length -= (size_t)count;
+        offset += count;
+    }
+    return true;
+}
+
+static void writeFailed(AsyncWriter* writer, int error) {
+    if (!writer->failed) {
+        writer->failed = true;
+        writer->error = error;
+    }
+}
+
+/**
+ * Handle one completion: a finished write frees its buffer
+ * @return false if the ring failed
+ */
+static bool reapWrite(AsyncWriter* writer) {
+    uint64_t request;
+    int result;
+    if (!uringWait(&writer->ring, &request, &result)) {
+        return false;
+    }
+
+    WriteSlot* slot = &writer->slots[request];
+    if (result < 0) {
+        writeFailed(writer, -result);
+    } else if ((size_t)result < slot->length &&
+               !writeFully(writer->fd, slot->data + result, slot->length - (size_t)result,
+                           slot->offset + result)) {
+        writeFailed(writer, errno);
+    }
+    slot->busy = false;
+    return true;
+}
+
+/**
+ * Hand the current buffer to the kernel and move on to the next one,
+ * waiting only if that one is still being written
+ */
+static void flushCurrent(AsyncWriter* writer) {
+    WriteSlot* slot = &writer->slots[writer->current];
+    if (slot->length == 0) {
+        return;
+    }
+
+    if (!writer->useUring) {
+        if (!writeFully(writer->fd, slot->data, slot->length, writer->offset)) {
+            writeFailed(writer, errno);
+        }
+        writer->offset += (off_t)slot->length;
+        slot->length = 0;
+        return;
+    }
+
+    struct io_uring_sqe request;
+    prepareRequest(&request, IORING_OP_WRITE, writer->fd, slot->data, (unsigned)slot->length,
+                   writer->offset, (uint64_t)writer->current);
+    uringQueue(&writer->ring, &request);
+    slot->offset = writer->offset;
+    slot->busy = true;
+    writer->offset += (off_t)slot->length;
+    uringSubmit(&writer->ring, false);
+
+    writer->current = (writer->current + 1) % writer->slotCount;
+    WriteSlot* next = &writer->slots[writer->current];
+    while (next->busy) {
+        // A ring that stopped working never touches the buffer again
+        if (!reapWrite(writer)) {
+            writeFailed(writer, errno);
+            next->busy = false;
+        }
+    }
+    next->length = 0;
+}
+
+AsyncWriter* openAsyncWriter(const char* filename) {
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    AsyncWriter* writer = (AsyncWriter*)trackedCalloc(1, sizeof(AsyncWriter), MEM_IO_BUFFERS);
+    if (writer == NULL) {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    writer->fd = fd;
+    writer->ring.fd = -1;
+    writer->useUring = asyncIoUsesUring() && uringInit(&writer->ring, RING_ENTRIES);
+    writer->slotCount = writer->useUring ? ASYNC_QUEUE_DEPTH : 1;
+    for (int i = 0; i < writer->slotCount; i++) {
+        writer->slots[i].data = (char*)trackedMalloc(ASYNC_BUFFER_SIZE, MEM_IO_BUFFERS);
+        if (writer->slots[i].data == NULL) {
+            closeAsyncWriter(writer);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+    return writer;
+}
+
+void asyncWrite(AsyncWriter* writer, const void* data, size_t length) {
+    const char* bytes = (const char*)data;
+    while (length > 0) {
+        WriteSlot* slot = &writer->slots[writer->current];
+        size_t space = ASYNC_BUFFER_SIZE - slot->length;
+        size_t count = length < space ? length : space;
+        memcpy(slot->data + slot->length, bytes, count);
+        slot->length += count;
+        bytes += count;
+        length -= count;
+        if (slot->length == ASYNC_BUFFER_SIZE) {
+            flushCurrent(writer);
+        }
+    }
+}
+
+bool closeAsyncWriter(AsyncWriter* writer) {
+    if (writer == NULL) {
+        return false;
+    }
+
+    if (writer->slots[writer->current].data != NULL) {
+        flushCurrent(writer);
+    }
+    if (writer->useUring) {
+        while (writer->ring.pending > 0) {
+            if (!reapWrite(writer)) {
+                writeFailed(writer, errno);
+                break;
+            }
+        }
+        uringExit(&writer->ring);
+    }
+
+    if (close(writer->fd) != 0) {
+        writeFailed(writer, errno);
+    }
+    bool written = !writer->failed;
+    int error = writer->error;
+    for (int i = 0; i < ASYNC_QUEUE_DEPTH; i++) {
+        trackedFree(writer->slots[i].data);
+    }
+    trackedFree(writer);
+    if (!written) {
+        errno = error;
+    }
+    return written;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file asyncio.h
+ * @brief Header file containing the asynchronous file I/O backend
+ *
+ * Data files are read and written in large buffers. With io_uring (set
+ * up through raw system calls, so no library is needed) several buffers
+ * are in flight at once: a reader keeps the next reads queued while the
+ * caller parses the current buffer, and a writer hands full buffers to
+ * the kernel while the caller formats the next one.
+ *
+ * Where io_uring is missing or disabled (kernel, seccomp, or --io
+ * blocking) the same calls use plain blocking read and write.
+ * Each reader and writer owns its ring, so they are safe to use from
+ * parallel threads and in a forked child.
+ */
+
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define ASYNC_BUFFER_SIZE (1 << 20)  /* Bytes per read or write request */
+#define ASYNC_QUEUE_DEPTH 4          /* Buffers in flight per reader or writer */
+
+typedef enum {
+    IO_BACKEND_URING,     /* io_uring when the kernel allows it, blocking otherwise */
+    IO_BACKEND_BLOCKING   /* Always blocking system calls */
+} IoBackend;
+
+/* Backend requested for new readers and writers (--io) */
+extern IoBackend ioBackend;
+
+/* Opaque handles */
+typedef struct AsyncReader AsyncReader;
+typedef struct AsyncWriter AsyncWriter;
+
+/**
+ * @brief Check whether new readers and writers will use io_uring
+ *
+ * The kernel is probed once; later calls only look at ioBackend.
+ *
+ * @return true if io_uring is requested and usable
+ */
+bool asyncIoUsesUring(void);
+
+/**
+ * @brief Get the name of the backend new readers and writers will use
+ * @return "io_uring" or "blocking"
+ */
+const char* asyncIoBackendName(void);
+
+/**
+ * @brief Open a file for sequential reading and queue the first reads
+ * @param filename Name of the file to read
+ * @return Reader, or NULL if the file could not be opened (errno is set)
+ */
+AsyncReader* openAsyncReader(const char* filename);
+
+/**
+ * @brief Get the next buffer of the file, in file order
+ *
+ * The buffer belongs to the reader and may be modified by the caller; it
+ * stays valid until the next call, which hands it back for another read.
+ * One byte past the end is writable, so it can be NUL-terminated.
+ *
+ * @param reader Reader
+ * @param data Receives the start of the buffer
+ * @return Bytes in the buffer, 0 at end of file, or -1 on a read error
+ */
+ssize_t asyncReadNext(AsyncReader* reader, char** data);
+
+/**
+ * @brief Close the file and free the reader, first waiting for reads still in flight
+ * @param reader Reader to close
+ */
+void closeAsyncReader(AsyncReader* reader);
+
+/**
+ * @brief Create or truncate a file for sequential writing
+ * @param filename Name of the file to write
+ * @return Writer, or NULL if the file could not be opened (errno is set)
+ */
+AsyncWriter* openAsyncWriter(const char* filename);
+
+/**
+ * @brief Append bytes to the file
+ *
+ * Bytes are copied into the current buffer; a full buffer is submitted
+ * and only waited for when every buffer is in flight.
+ *
+ * @param writer Writer
+ * @param data Bytes to append
+ * @param length Number of bytes
+ */
+void asyncWrite(AsyncWriter* writer, const void* data, size_t length);
+
+/**
+ * @brief Write what is buffered, wait for every request and close the file
+ * @param writer Writer to close
+ * @return true if every byte was written
+ */
+bool closeAsyncWriter(AsyncWriter* writer);
+
+#endif /* ASYNCIO_H */
@@ -0,0 +1,275 @@
+/**
+ * @file autosave.c
+ * @brief Implementation of periodic background autosave
+ */
+
+#include "autosave.h"
+#include "fileio.h"
+#include "idindex.h"
+#include "stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define NANOS_PER_SECOND 1000000000ULL
+#define REAP_POLL_MS 200  /* How often to check on a running snapshot while idle */
+
+/* Written by the child to the pipe when the snapshot is done */
+typedef struct {
+    uint64_t nanos;   /* Time to write, sync and rename the snapshot */
+    uint64_t bytes;   /* Size of the snapshot */
+    uint64_t inode;   /* Identity of the snapshot file, kept by the rename */
+    int64_t mtimeNanos;
+    int saved;        /* 1 if the data file was replaced */
+} SnapshotResult;
+
+static bool enabled = false;
+static char dataFile[256];
+static uint64_t intervalNanos;
+static uint64_t nextDue;
+static unsigned long savedVersion;    /* Version the data file holds */
+static unsigned long pendingVersion;  /* Version being written by the child */
+static pid_t child = -1;
+static int resultPipe = -1;
+
+static unsigned long snapshotCount = 0;
+static unsigned long failureCount = 0;
+static SnapshotResult lastResult;
+static uint64_t lastForkNanos = 0;    /* How long the parent paused to fork */
+
+/**
+ * Sync the directory holding a file, so a rename into it is durable
+ */
+static void syncParentDirectory(const char* filename) {
+    char directory[sizeof(dataFile)];
+    const char* slash = strrchr(filename, '/');
+
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    } else {
+        size_t length = (size_t)(slash - filename);
+        memcpy(directory, filename, length == 0 ? 1 : length);
+        directory[length == 0 ? 1 : length] = '\0';
+    }
+
+    int fd = open(directory, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/**
+ * Body of the child: write the snapshot next to the data file and
+ * atomically replace the data file with it
+ */
+static SnapshotResult writeSnapshot(const Student* head) {
+    SnapshotResult result = {0, 0, 0, 0, 0};
+    char tempFile[sizeof(dataFile) + sizeof(AUTOSAVE_TEMP_SUFFIX)];
+    uint64_t start = statsNow();
+
+    snprintf(tempFile, sizeof(tempFile), "%s%s", dataFile, AUTOSAVE_TEMP_SUFFIX);
+
+    IdIndex* index = getAttachedIdIndex();
+    bool written = index != NULL ? saveStudentsToFileInIdOrder(tempFile, head, index)
+                                 : saveStudentsToFile(tempFile, head);
+    if (!written) {
+        return result;
+    }
+
+    // fclose only hands the data to the kernel; make it durable before
+    // the rename can expose it
+    int fd = open(tempFile, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fsync(fd) != 0 || fstat(fd, &info) != 0) {
+        fprintf(stderr, "Autosave: could not sync %s: %s\n", tempFile, strerror(errno));
+        if (fd >= 0) close(fd);
+        unlink(tempFile);
+        return result;
+    }
+    close(fd);
+
+    if (rename(tempFile, dataFile) != 0) {
+        fprintf(stderr, "Autosave: could not replace %s: %s\n", dataFile, strerror(errno));
+        unlink(tempFile);
+        return result;
+    }
+    syncParentDirectory(dataFile);
+
+    result.bytes = (uint64_t)info.st_size;
+    result.inode = (uint64_t)info.st_ino;
+    result.mtimeNanos = (int64_t)info.st_mtim.tv_sec * (int64_t)NANOS_PER_SECOND + info.st_mtim.tv_nsec;
+    result.nanos = statsNow() - start;
+    result.saved = 1;
+    return result;
+}
+
+static void forkSnapshot(const Student* head) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        fprintf(stderr, "Autosave: could not create pipe: %s\n", strerror(errno));
+        failureCount++;
+        return;
+    }
+
+    uint64_t start = statsNow();
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "Autosave: could not fork: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        failureCount++;
+        return;
+    }
+
+    if (pid == 0) {
+        // The child owns a frozen copy of the roster; _exit skips the
+        // parent's stdio buffers and exit handlers
+        close(fds[0]);
+        SnapshotResult result = writeSnapshot(head);
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == (ssize_t)sizeof(result) && result.saved ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    lastForkNanos = statsNow() - start;
+    close(fds[1]);
+    child = pid;
+    resultPipe = fds[0];
+    pendingVersion = studentStoreVersion();
+}
+
+/**
+ * Collect the result of the running child
+ * @param block Wait for the child instead of returning if it is still running
+ */
+static void reapSnapshot(bool block) {
+    int status;
+    pid_t pid;
+
+    if (child < 0) {
+        return;
+    }
+    do {
+        pid = waitpid(child, &status, block ? 0 : WNOHANG);
+    } while (pid < 0 && errno == EINTR);
+    if (pid == 0) {
+        return;
+    }
+
+    SnapshotResult result = {0, 0, 0, 0, 0};
+    bool received = read(resultPipe, &result, sizeof(result)) == (ssize_t)sizeof(result);
+    close(resultPipe);
+    resultPipe = -1;
+    child = -1;
+
+    if (pid > 0 && received && result.saved && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+        savedVersion = pendingVersion;
+        lastResult = result;
+        snapshotCount++;
+        if (statsEnabled) {
+            statsRecord(STAT_AUTOSAVE, result.nanos);
+        }
+    } else {
+        failureCount++;
+    }
+}
+
+void startAutosave(const char* filename, int intervalSeconds) {
+    snprintf(dataFile, sizeof(dataFile), "%s", filename);
+    intervalNanos = (uint64_t)intervalSeconds * NANOS_PER_SECOND;
+    nextDue = statsNow() + intervalNanos;
+    savedVersion = studentStoreVersion();
+    enabled = true;
+}
+
+bool autosaveEnabled(void) {
+    return enabled;
+}
+
+void autosaveTick(const Student* head) {
+    if (!enabled) {
+        return;
+    }
+
+    reapSnapshot(false);
+
+    uint64_t now = statsNow();
+    if (child >= 0 || now < nextDue) {
+        return;
+    }
+    nextDue = now + intervalNanos;
+
+    if (studentStoreVersion() != savedVersion) {
+        fflush(NULL);
+        forkSnapshot(head);
+    }
+}
+
+void autosaveWaitForInput(const Student* head) {
+    if (!enabled) {
+        return;
+    }
+    if (!isatty(STDIN_FILENO)) {
+        autosaveTick(head);
+        return;
+    }
+
+    // The prompt has no newline, so make sure it shows before waiting
+    fflush(stdout);
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    for (;;) {
+        autosaveTick(head);
+
+        uint64_t now = statsNow();
+        uint64_t waitNanos = nextDue > now ? nextDue - now : 0;
+        int timeout = (int)(waitNanos / 1000000ULL) + 1;
+        if (child >= 0 && timeout > REAP_POLL_MS) {
+            timeout = REAP_POLL_MS;
+        }
+
+        int ready = poll(&input, 1, timeout);
+        if (ready > 0 || (ready < 0 && errno != EINTR)) {
+            return;
+        }
+    }
+}
+
+void stopAutosave(void) {
+    reapSnapshot(true);
+    enabled = false;
+}
+
+bool autosaveWroteFile(const struct stat* info) {
+    reapSnapshot(false);
+    if (snapshotCount == 0) {
+        return false;
+    }
+    int64_t mtimeNanos = (int64_t)info->st_mtim.tv_sec * (int64_t)NANOS_PER_SECOND + info->st_mtim.tv_nsec;
+    return (uint64_t)info->st_ino == lastResult.inode && (uint64_t)info->st_size == lastResult.bytes &&
+           mtimeNanos == lastResult.mtimeNanos;
+}
+
+void printAutosaveReport(FILE* out) {
+    if (intervalNanos == 0) {
+        fprintf(out, "Autosave is disabled (start with --autosave SECONDS to enable it).\n");
+        return;
+    }
+
+    fprintf(out, "Autosave:            every %llus to %s\n",
+            (unsigned long long)(intervalNanos / NANOS_PER_SECOND), dataFile);
+    fprintf(out, "Snapshots written:   %lu (%lu failed)\n", snapshotCount, failureCount);
+    if (snapshotCount > 0) {
+        fprintf(out, "Last snapshot:       %llu bytes in %.1fms\n",
+                (unsigned long long)lastResult.bytes, (double)lastResult.nanos / 1e6);
+        fprintf(out, "Last fork pause:     %.1fms\n", (double)lastForkNanos / 1e6);
+    }
+    fprintf(out, "Snapshot running:    %s\n", child >= 0 ? "yes" : "no");
+    fprintf(out, "Unsaved changes:     %s\n", studentStoreVersion() != savedVersion ? "yes" : "no");
+}
@@ -0,0 +1,78 @@
+/**
+ * @file autosave.h
+ * @brief Header file containing periodic background autosave
+ *
+ * When the roster has changed since the last snapshot and the interval
+ * has passed, the process forks. The child sees a copy-on-write snapshot
+ * of the roster, writes it to a temporary file, syncs it and renames it
+ * over the data file, while the parent returns to the menu at once. The
+ * child reports how long the write took and how many bytes it wrote
+ * through a pipe, and is reaped without blocking.
+ */
+
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include "student.h"
+
+#define AUTOSAVE_TEMP_SUFFIX ".autosave.tmp"  /* Appended to the data file name */
+
+/**
+ * @brief Enable autosave of the roster to a data file
+ *
+ * The current roster version counts as saved, so call this after loading.
+ *
+ * @param filename Data file that snapshots replace
+ * @param intervalSeconds Minimum number of seconds between snapshots
+ */
+void startAutosave(const char* filename, int intervalSeconds);
+
+/**
+ * @brief Check if autosave has been enabled
+ * @return true if startAutosave was called
+ */
+bool autosaveEnabled(void);
+
+/**
+ * @brief Reap a finished snapshot and start a new one if one is due
+ * @param head Pointer to the head of the linked list
+ */
+void autosaveTick(const Student* head);
+
+/**
+ * @brief Wait until standard input has data, taking snapshots while idle
+ *
+ * Only waits when standard input is a terminal; otherwise it ticks once
+ * and returns, leaving the read to the caller.
+ *
+ * @param head Pointer to the head of the linked list
+ */
+void autosaveWaitForInput(const Student* head);
+
+/**
+ * @brief Wait for a running snapshot to finish and disable autosave
+ *
+ * Call this before the final save so a late snapshot can't replace it.
+ */
+void stopAutosave(void);
+
+/**
+ * @brief Check if a data file is the last snapshot this session wrote
+ *
+ * A finished snapshot is reaped first. The file is identified by its
+ * inode, size and modification time, which the final rename keeps.
+ *
+ * @param info Status of the data file
+ * @return true if the file is that snapshot, unchanged since
+ */
+bool autosaveWroteFile(const struct stat* info);
+
+/**
+ * @brief Print the autosave interval, snapshot count, duration and size
+ * @param out Stream to print to
+ */
+void printAutosaveReport(FILE* out);
+
+#endif /* AUTOSAVE_H */
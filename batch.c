@@ -0,0 +1,360 @@
+/**
+ * @file batch.c
+ * @brief Implementation of the non-interactive batch command runner
+ */
+
+#include "batch.h"
+#include "fileio.h"
+#include "stats.h"
+#include "memtrack.h"
+#include "compact.h"
+#include "dedup.h"
+#include "txn.h"
+#include "fuzzy.h"
+#include "idindex.h"
+#include "filter.h"
+#include "columnar.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define BATCH_LINE_LENGTH 256
+
+/**
+ * Split off the first whitespace-separated word of a string
+ * @return Pointer to the rest of the string after the word
+ */
+static char* splitWord(char* text) {
+    while (*text != '\0' && !isspace((unsigned char)*text)) {
+        text++;
+    }
+    if (*text != '\0') {
+        *text++ = '\0';
+        while (isspace((unsigned char)*text)) {
+            text++;
+        }
+    }
+    return text;
+}
+
+static bool batchAdd(Student** head, char* args) {
+    Student* student = parseStudentLine(args);
+    if (student == NULL) {
+        fprintf(stderr, "add: expected ID,NAME,AGE,COURSE,GRADES\n");
+        return false;
+    }
+    if (studentIdExists(*head, student->id)) {
+        fprintf(stderr, "add: a student with ID %s already exists\n", student->id);
+        freeStudent(student);
+        return false;
+    }
+    if (student->age < 1 || student->age > 120) {
+        fprintf(stderr, "add: age must be between 1 and 120\n");
+        freeStudent(student);
+        return false;
+    }
+
+    *head = addStudent(*head, student);
+    printf("Added student %s.\n", student->id);
+    return true;
+}
+
+static bool batchModify(Student* head, char* args) {
+    char* field = splitWord(args);
+    char* value = splitWord(field);
+    const char* id = args;
+
+    if (*id == '\0' || *field == '\0' || *value == '\0') {
+        fprintf(stderr, "modify: expected ID FIELD VALUE\n");
+        return false;
+    }
+
+    bool modified;
+    if (strcmp(field, "name") == 0) {
+        modified = modifyStudent(head, id, value, -1, NULL, NULL);
+    } else if (strcmp(field, "age") == 0) {
+        int age = atoi(value);
+        if (age < 1 || age > 120) {
+            fprintf(stderr, "modify: age must be between 1 and 120\n");
+            return false;
+        }
+        modified = modifyStudent(head, id, NULL, age, NULL, NULL);
+    } else if (strcmp(field, "course") == 0) {
+        modified = modifyStudent(head, id, NULL, -1, value, NULL);
+    } else if (strcmp(field, "grades") == 0) {
+        modified = modifyStudent(head, id, NULL, -1, NULL, value);
+    } else {
+        fprintf(stderr, "modify: unknown field '%s'\n", field);
+        return false;
+    }
+
+    if (!modified) {
+        fprintf(stderr, "modify: no student found with ID %s\n", id);
+        return false;
+    }
+    printf("Modified student %s.\n", id);
+    return true;
+}
+
+/**
+ * Build a compact copy of the roster and compare its footprint with the
+ * list, and with a name the time of a name search in each layout
+ */
+static bool batchCompact(Student* head, const char* name) {
+    CompactRoster* roster = buildCompactRoster(head);
+    if (roster == NULL) {
+        return false;
+    }
+
+    int count = compactCount(roster);
+    printf("Records:              %d\n", count);
+    printf("Linked list:          %zu bytes\n", sizeof(Student) * (size_t)count);
+    printf("Compact roster:       %zu bytes\n", compactFootprint(roster));
+    printf("  hot fields:         %zu bytes\n", sizeof(CompactHot) * (size_t)count);
+    printf("  cold fields:        %zu bytes\n", sizeof(CompactCold) * (size_t)count);
+    printf("  string arena:       %zu bytes used\n", roster->arenaSize);
+
+    bool ok = true;
+    if (*name != '\0') {
+        uint64_t start = statsNow();
+        int listCount = 0;
+        Student** results = searchStudentsByName(head, name, &listCount);
+        uint64_t listNanos = statsNow() - start;
+        freeSearchResults(results);
+
+        start = statsNow();
+        int compactMatches = 0;
+        int* matches = compactSearchByName(roster, name, &compactMatches);
+        uint64_t compactNanos = statsNow() - start;
+        for (int i = 0; i < compactMatches; i++) {
+            int row = matches[i];
+            printf("%s %s %d %s %s\n", compactId(roster, row), compactName(roster, row),
+                   compactAge(roster, row), compactCourse(roster, row), compactGrades(roster, row));
+        }
+        trackedFree(matches);
+
+        char listTime[32], compactTime[32];
+        formatDuration(listTime, sizeof(listTime), listNanos);
+        formatDuration(compactTime, sizeof(compactTime), compactNanos);
+        printf("Name search '%s':\n", name);
+        printf("  linked list:        %d match(es) in %s\n", listCount, listTime);
+        printf("  compact roster:     %d match(es) in %s\n", compactMatches, compactTime);
+        if (listCount != compactMatches) {
+            fprintf(stderr, "compact: the layouts disagree on '%s'\n", name);
+            ok = false;
+        }
+    }
+
+    freeCompactRoster(roster);
+    return ok;
+}
+
+static bool runCommand(char* line, Student** head, const char* dataFile) {
+    char* args = splitWord(line);
+
+    if (strcmp(line, "add") == 0) {
+        return batchAdd(head, args);
+    }
+    if (strcmp(line, "modify") == 0) {
+        return batchModify(*head, args);
+    }
+    if (strcmp(line, "delete") == 0) {
+        if (!studentIdExists(*head, args)) {
+            fprintf(stderr, "delete: no student found with ID %s\n", args);
+            return false;
+        }
+        *head = deleteStudent(*head, args);
+        return true;
+    }
+    if (strcmp(line, "find") == 0) {
+        Student* student = searchStudentById(*head, args);
+        if (student == NULL) {
+            printf("No student found with ID %s.\n", args);
+        } else {
+            displayStudent(student);
+        }
+        return true;
+    }
+    if (strcmp(line, "search") == 0) {
+        int count = 0;
+        Student** results = searchStudentsByName(*head, args, &count);
+        for (int i = 0; i < count; i++) {
+            displayStudent(results[i]);
+        }
+        printf("Found %d student(s) matching '%s'.\n", count, args);
+        freeSearchResults(results);
+        return true;
+    }
+    if (strcmp(line, "fuzzy") == 0) {
+        char* name = splitWord(args);
+        int maxDistance = atoi(args);
+        if (maxDistance < 1 || maxDistance > MAX_FUZZY_DISTANCE || *name == '\0') {
+            fprintf(stderr, "fuzzy: expected DISTANCE (1-%d) NAME\n", MAX_FUZZY_DISTANCE);
+            return false;
+        }
+        int count = 0;
+        FuzzyMatch* matches = searchStudentsByNameFuzzy(*head, name, maxDistance, &count);
+        for (int i = 0; i < count; i++) {
+            printf("%d %s %s\n", matches[i].distance, matches[i].student->id, matches[i].student->name);
+        }
+        printf("Found %d student(s) close to '%s'.\n", count, name);
+        freeFuzzyMatches(matches);
+        return true;
+    }
+    if (strcmp(line, "range") == 0) {
+        char* high = splitWord(args);
+        IdIndex* index = getAttachedIdIndex();
+        if (*args == '\0' || *high == '\0' || index == NULL) {
+            fprintf(stderr, "range: expected LOW HIGH\n");
+            return false;
+        }
+        int count = 0;
+        Student** results = idIndexRange(index, args, high, &count);
+        displayStudentArray(results, count);
+        printf("Found %d student(s) with IDs from %s to %s.\n", count, args, high);
+        freeSearchResults(results);
+        return true;
+    }
+    if (strcmp(line, "filter") == 0) {
+        char error[128];
+        FilterProgram* program = compileFilter(args, error, sizeof(error));
+        if (program == NULL) {
+            fprintf(stderr, "filter: %s\n", error);
+            return false;
+        }
+        int count = 0;
+        Student** results = searchStudentsByFilter(*head, program, &count);
+        displayStudentArray(results, count);
+        printf("Found %d student(s) matching %s.\n", count, args);
+        freeSearchResults(results);
+        freeFilter(program);
+        return true;
+    }
+    if (strcmp(line, "list") == 0) {
+        IdIndex* index = getAttachedIdIndex();
+        int count = index != NULL ? displayStudentsInIdOrder(index) : displayAllStudents(*head);
+        printf("Total number of students: %d\n", count);
+        return true;
+    }
+    if (strcmp(line, "save") == 0) {
+        // The file must never hold changes that a rollback could still undo
+        if (transactionActive()) {
+            fprintf(stderr, "save: commit or roll back the open transaction first\n");
+            return false;
+        }
+        if (!saveStudentsWithBackup(dataFile, *head, BACKUP_PREFIX, BACKUP_EXT)) {
+            return false;
+        }
+        return truncateJournal(JOURNAL_FILE);
+    }
+    if (strcmp(line, "export") == 0) {
+        const char* filename = *args != '\0' ? args : COLUMNAR_FILE;
+        if (!exportColumnar(filename, *head)) {
+            return false;
+        }
+        printf("Exported the roster to %s.\n", filename);
+        return true;
+    }
+    if (strcmp(line, "begin") == 0) {
+        if (!beginTransaction()) {
+            fprintf(stderr, "begin: a transaction is already open\n");
+            return false;
+        }
+        return true;
+    }
+    if (strcmp(line, "commit") == 0) {
+        int changes = transactionChangeCount();
+        if (!transactionActive()) {
+            fprintf(stderr, "commit: no transaction is open\n");
+            return false;
+        }
+        if (!commitTransaction(JOURNAL_FILE)) {
+            return false;
+        }
+        printf("Committed %d change(s).\n", changes);
+        return true;
+    }
+    if (strcmp(line, "rollback") == 0) {
+        int changes = transactionChangeCount();
+        if (!rollbackTransaction(head)) {
+            fprintf(stderr, "rollback: no transaction could be rolled back\n");
+            return false;
+        }
+        printf("Rolled back %d change(s).\n", changes);
+        return true;
+    }
+    if (strcmp(line, "stats") == 0) {
+        printStats(stdout);
+        return true;
+    }
+    if (strcmp(line, "duplicates") == 0) {
+        double threshold = *args != '\0' ? atof(args) : DEFAULT_DUPLICATE_THRESHOLD;
+        if (threshold <= 0.0 || threshold > 1.0) {
+            fprintf(stderr, "duplicates: expected a THRESHOLD between 0 and 1\n");
+            return false;
+        }
+        int count = 0;
+        DuplicateCandidate* candidates = findDuplicateCandidates(*head, threshold, &count);
+        for (int i = 0; i < count; i++) {
+            printf("%.3f %s %s | %s %s\n", candidates[i].similarity,
+                   candidates[i].first->id, candidates[i].first->name,
+                   candidates[i].second->id, candidates[i].second->name);
+        }
+        printf("Found %d duplicate candidate pair(s).\n", count);
+        freeDuplicateCandidates(candidates);
+        return true;
+    }
+    if (strcmp(line, "compact") == 0) {
+        return batchCompact(*head, args);
+    }
+    if (strcmp(line, "memory") == 0) {
+        printMemoryReport(stdout);
+        return true;
+    }
+    if (strcmp(line, "reclaim") == 0) {
+        if (transactionActive()) {
+            fprintf(stderr, "reclaim: commit or roll back the open transaction first\n");
+            return false;
+        }
+        printf("Reclaimed %d deleted record(s).\n", compactStudentList(head, -1));
+        return true;
+    }
+
+    fprintf(stderr, "Unknown batch command: %s\n", line);
+    return false;
+}
+
+int runBatch(FILE* input, Student** head, const char* dataFile) {
+    char line[BATCH_LINE_LENGTH];
+    int failures = 0;
+    int lineNumber = 0;
+
+    while (fgets(line, sizeof(line), input)) {
+        lineNumber++;
+
+        // Strip the line ending and leading whitespace
+        line[strcspn(line, "\r\n")] = '\0';
+        char* command = line;
+        while (isspace((unsigned char)*command)) {
+            command++;
+        }
+        if (*command == '\0' || *command == '#') {
+            continue;
+        }
+
+        if (!runCommand(command, head, dataFile)) {
+            fprintf(stderr, "Batch command failed on line %d.\n", lineNumber);
+            failures++;
+        }
+    }
+
+    // A transaction that was never committed doesn't survive the batch
+    if (transactionActive()) {
+        fprintf(stderr, "Batch ended inside a transaction; rolling it back.\n");
+        rollbackTransaction(head);
+        failures++;
+    }
+
+    return failures;
+}
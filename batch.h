@@ -0,0 +1,50 @@
+/**
+ * @file batch.h
+ * @brief Header file containing the non-interactive batch command runner
+ *
+ * Batch commands are read one per line; blank lines and lines starting
+ * with '#' are ignored:
+ *
+ *   add ID,NAME,AGE,COURSE,GRADES   Add a new student
+ *   modify ID FIELD VALUE           Change name, age, course or grades
+ *   delete ID                       Delete a student
+ *   find ID                         Display a student by ID
+ *   search NAME                     Display students whose name contains NAME
+ *   fuzzy DISTANCE NAME             List students whose name is within DISTANCE
+ *                                   typos of NAME, best matches first
+ *   range LOW HIGH                  Display students with IDs from LOW to HIGH
+ *   filter EXPR                     Display students matching a filter expression
+ *                                   (see filter.h)
+ *   list                            Display all students (in ID order)
+ *   save                            Back up and save the data file, then empty
+ *                                   the journal
+ *   export [FILE]                   Write the roster as a columnar analytics file
+ *                                   (see columnar.h)
+ *   begin                           Start a transaction
+ *   commit                          Journal the changes since begin with one fsync
+ *   rollback                        Undo the changes since begin
+ *   stats                           Print operation latency statistics
+ *   memory                          Print the memory footprint report
+ *   compact [NAME]                  Compare the compact layout footprint with the list,
+ *                                   and the time of a search for NAME in each
+ *   reclaim                         Free every deleted record still awaiting compaction
+ *   duplicates [THRESHOLD]          List pairs of students in the same course with
+ *                                   similar names, most similar first
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include "student.h"
+
+/**
+ * @brief Run batch commands from a stream against the student list
+ * @param input Stream to read commands from
+ * @param head Pointer to the head of the linked list (updated in place)
+ * @param dataFile Data file written by the save command
+ * @return Number of commands that failed
+ */
+int runBatch(FILE* input, Student** head, const char* dataFile);
+
+#endif /* BATCH_H */
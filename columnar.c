@@ -0,0 +1,800 @@
+/**
+ * @file columnar.c
+ * @brief Implementation of the columnar analytics export
+ */
+
+#include "columnar.h"
+#include "crc32c.h"
+#include "idindex.h"
+#include "memtrack.h"
+#include "stats.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHUNK_ALIGNMENT 8
+#define HEADER_CHECKED_BYTES offsetof(ColumnarHeader, directoryChecksum)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t columnCount;
+    uint64_t rowCount;
+    uint32_t directoryChecksum;  /* CRC32C of the fields above and the column directory */
+    uint32_t reserved;
+} ColumnarHeader;
+
+/* Directory entry of one column */
+typedef struct {
+    char name[COLUMN_NAME_LENGTH];
+    uint8_t encoding;
+    uint8_t bitWidth;       /* Bits per packed value or code */
+    uint16_t reserved;
+    uint32_t checksum;      /* CRC32C of the chunk */
+    uint64_t offset;        /* File offset of the chunk */
+    uint64_t length;        /* Chunk length in bytes */
+    ColumnStats stats;
+} ColumnEntry;
+
+/* A column chunk being built in memory */
+typedef struct {
+    uint8_t* data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} ChunkBuffer;
+
+/* A column read back from a file */
+typedef struct {
+    bool loaded;
+    uint8_t* chunk;
+    const uint32_t* offsets;   /* Strings or dictionary values */
+    const char* bytes;
+    uint32_t dictionarySize;
+    const uint64_t* packed;    /* Bit-packed ages or codes */
+    uint32_t* codes;           /* Run-length encoded codes, expanded */
+} Column;
+
+struct ColumnarFile {
+    int fd;
+    char filename[64];
+    ColumnarHeader header;
+    ColumnEntry entries[COLUMN_COUNT];
+    Column columns[COLUMN_COUNT];
+    uint64_t bytesRead;
+};
+
+static const char* columnNames[COLUMN_COUNT] = {"id", "name", "age", "course", "grades"};
+
+static const char* encodingNames[] = {"offset strings", "bit-packed", "dictionary", "dictionary+rle"};
+
+/* ---- Writing ---- */
+
+static void chunkAppend(ChunkBuffer* chunk, const void* data, size_t length) {
+    if (chunk->failed) {
+        return;
+    }
+    if (chunk->length + length > chunk->capacity) {
+        size_t capacity = chunk->capacity == 0 ? 4096 : chunk->capacity * 2;
+        while (capacity < chunk->length + length) capacity *= 2;
+        uint8_t* grown = (uint8_t*)trackedRealloc(chunk->data, capacity, MEM_IO_BUFFERS);
+        if (grown == NULL) {
+            chunk->failed = true;
+            return;
+        }
+        chunk->data = grown;
+        chunk->capacity = capacity;
+    }
+    memcpy(chunk->data + chunk->length, data, length);
+    chunk->length += length;
+}
+
+static void chunkAlign(ChunkBuffer* chunk) {
+    static const uint8_t zeros[CHUNK_ALIGNMENT] = {0};
+    size_t padding = (CHUNK_ALIGNMENT - chunk->length % CHUNK_ALIGNMENT) % CHUNK_ALIGNMENT;
+    chunkAppend(chunk, zeros, padding);
+}
+
+/**
+ * Fewest bits that hold every value from 0 to range
+ */
+static uint8_t bitWidthFor(uint64_t range) {
+    uint8_t width = 0;
+    while (width < 32 && (range >> width) != 0) {
+        width++;
+    }
+    return width;
+}
+
+/**
+ * Append values of width bits each, packed from the low bit of 64-bit words
+ */
+static void appendPacked(ChunkBuffer* chunk, const uint32_t* values, uint64_t count, uint8_t width) {
+    uint64_t word = 0;
+    unsigned used = 0;
+
+    if (width == 0) {
+        return;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        word |= (uint64_t)values[i] << used;
+        used += width;
+        if (used >= 64) {
+            chunkAppend(chunk, &word, sizeof(word));
+            used -= 64;
+            // The bits of this value that did not fit start the next word
+            word = used > 0 ? (uint64_t)values[i] >> (width - used) : 0;
+        }
+    }
+    if (used > 0) {
+        chunkAppend(chunk, &word, sizeof(word));
+    }
+}
+
+/**
+ * Append (row count + 1) offsets and then the bytes of each string
+ */
+static void appendOffsetStrings(ChunkBuffer* chunk, const char* const* strings, uint64_t count) {
+    uint32_t offset = 0;
+    chunkAppend(chunk, &offset, sizeof(offset));
+    for (uint64_t i = 0; i < count; i++) {
+        offset += (uint32_t)strlen(strings[i]);
+        chunkAppend(chunk, &offset, sizeof(offset));
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        chunkAppend(chunk, strings[i], strlen(strings[i]));
+    }
+    chunkAlign(chunk);
+}
+
+static void setTextStats(ColumnStats* stats, const char* min, const char* max) {
+    snprintf(stats->minText, sizeof(stats->minText), "%s", min);
+    snprintf(stats->maxText, sizeof(stats->maxText), "%s", max);
+}
+
+static void buildStringColumn(ChunkBuffer* chunk, ColumnEntry* entry, const char* const* values,
+                              uint64_t rows, bool naturalOrder) {
+    entry->encoding = ENCODING_OFFSET_STRINGS;
+    appendOffsetStrings(chunk, values, rows);
+
+    if (rows == 0) {
+        return;
+    }
+    const char* min = values[0];
+    const char* max = values[0];
+    for (uint64_t i = 1; i < rows; i++) {
+        int low = naturalOrder ? compareIds(values[i], min) : strcmp(values[i], min);
+        int high = naturalOrder ? compareIds(values[i], max) : strcmp(values[i], max);
+        if (low < 0) min = values[i];
+        if (high > 0) max = values[i];
+    }
+    setTextStats(&entry->stats, min, max);
+}
+
+static void buildAgeColumn(ChunkBuffer* chunk, ColumnEntry* entry, const Student* const* students,
+                           uint64_t rows, uint32_t* scratch) {
+    entry->encoding = ENCODING_BIT_PACKED;
+    if (rows == 0) {
+        return;
+    }
+
+    int min = students[0]->age;
+    int max = students[0]->age;
+    for (uint64_t i = 1; i < rows; i++) {
+        if (students[i]->age < min) min = students[i]->age;
+        if (students[i]->age > max) max = students[i]->age;
+    }
+    for (uint64_t i = 0; i < rows; i++) {
+        scratch[i] = (uint32_t)(students[i]->age - min);
+    }
+
+    entry->stats.minValue = min;
+    entry->stats.maxValue = max;
+    entry->bitWidth = bitWidthFor((uint64_t)((int64_t)max - min));
+    appendPacked(chunk, scratch, rows, entry->bitWidth);
+}
+
+/* Provisional dictionary, in order of first appearance */
+typedef struct {
+    const char** values;
+    uint32_t count;
+    uint32_t* table;      /* Open addressing: provisional code + 1, or 0 if empty */
+    uint32_t tableSize;
+} Dictionary;
+
+static uint32_t hashText(const char* text) {
+    uint32_t hash = 2166136261u;
+    for (const char* p = text; *p != '\0'; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Get the provisional code of a value, adding it if it is new
+ * @return Code, or UINT32_MAX if allocation failed
+ */
+static uint32_t dictionaryCode(Dictionary* dictionary, const char* value) {
+    if ((dictionary->count + 1) * 2 > dictionary->tableSize) {
+        uint32_t size = dictionary->tableSize == 0 ? 64 : dictionary->tableSize * 2;
+        uint32_t* table = (uint32_t*)trackedCalloc(size, sizeof(uint32_t), MEM_INDEXES);
+        const char** values = (const char**)trackedRealloc(dictionary->values,
+                                                           sizeof(char*) * size / 2, MEM_INDEXES);
+        if (table == NULL || values == NULL) {
+            trackedFree(table);
+            if (values != NULL) dictionary->values = values;
+            return UINT32_MAX;
+        }
+        dictionary->values = values;
+        for (uint32_t code = 0; code < dictionary->count; code++) {
+            uint32_t slot = hashText(values[code]) & (size - 1);
+            while (table[slot] != 0) slot = (slot + 1) & (size - 1);
+            table[slot] = code + 1;
+        }
+        trackedFree(dictionary->table);
+        dictionary->table = table;
+        dictionary->tableSize = size;
+    }
+
+    uint32_t mask = dictionary->tableSize - 1;
+    uint32_t slot = hashText(value) & mask;
+    while (dictionary->table[slot] != 0) {
+        uint32_t code = dictionary->table[slot] - 1;
+        if (strcmp(dictionary->values[code], value) == 0) {
+            return code;
+        }
+        slot = (slot + 1) & mask;
+    }
+    dictionary->values[dictionary->count] = value;
+    dictionary->table[slot] = dictionary->count + 1;
+    return dictionary->count++;
+}
+
+static const char** sortingValues;
+
+static int compareCodes(const void* first, const void* second) {
+    return strcmp(sortingValues[*(const uint32_t*)first], sortingValues[*(const uint32_t*)second]);
+}
+
+/**
+ * Encode a text column as a sorted dictionary and a code per row
+ */
+static bool buildDictionaryColumn(ChunkBuffer* chunk, ColumnEntry* entry, const char* const* values,
+                                  uint64_t rows, uint32_t* codes) {
+    Dictionary dictionary = {NULL, 0, NULL, 0};
+    bool ok = true;
+
+    for (uint64_t i = 0; i < rows && ok; i++) {
+        codes[i] = dictionaryCode(&dictionary, values[i]);
+        ok = codes[i] != UINT32_MAX;
+    }
+
+    // Sort the distinct values so codes compare like the values do
+    uint32_t* order = ok ? (uint32_t*)trackedMalloc(sizeof(uint32_t) * (dictionary.count + 1), MEM_INDEXES) : NULL;
+    uint32_t* rank = ok ? (uint32_t*)trackedMalloc(sizeof(uint32_t) * (dictionary.count + 1), MEM_INDEXES) : NULL;
+    ok = ok && order != NULL && rank != NULL;
+    if (ok) {
+        for (uint32_t code = 0; code < dictionary.count; code++) order[code] = code;
+        sortingValues = dictionary.values;
+        qsort(order, dictionary.count, sizeof(uint32_t), compareCodes);
+        for (uint32_t sorted = 0; sorted < dictionary.count; sorted++) rank[order[sorted]] = sorted;
+
+        const char** sortedValues = (const char**)trackedMalloc(sizeof(char*) * (dictionary.count + 1), MEM_INDEXES);
+        ok = sortedValues != NULL;
+        if (ok) {
+            uint64_t runs = 0;
+            for (uint32_t sorted = 0; sorted < dictionary.count; sorted++) {
+                sortedValues[sorted] = dictionary.values[order[sorted]];
+            }
+            for (uint64_t i = 0; i < rows; i++) {
+                codes[i] = rank[codes[i]];
+                if (i == 0 || codes[i] != codes[i - 1]) runs++;
+            }
+
+            chunkAppend(chunk, &dictionary.count, sizeof(uint32_t));
+            appendOffsetStrings(chunk, sortedValues, dictionary.count);
+
+            // Runs pay off when equal values are grouped, e.g. a roster sorted by course
+            entry->bitWidth = bitWidthFor(dictionary.count > 0 ? dictionary.count - 1 : 0);
+            uint64_t packedBytes = (rows * entry->bitWidth + 63) / 64 * 8;
+            uint64_t runBytes = sizeof(uint32_t) + runs * 2 * sizeof(uint32_t);
+            if (runBytes < packedBytes) {
+                entry->encoding = ENCODING_DICTIONARY_RLE;
+                uint32_t runCount = (uint32_t)runs;
+                chunkAppend(chunk, &runCount, sizeof(runCount));
+                for (uint64_t start = 0; start < rows;) {
+                    uint64_t end = start + 1;
+                    while (end < rows && codes[end] == codes[start]) end++;
+                    uint32_t run[2] = {codes[start], (uint32_t)(end - start)};
+                    chunkAppend(chunk, run, sizeof(run));
+                    start = end;
+                }
+                chunkAlign(chunk);
+            } else {
+                entry->encoding = ENCODING_DICTIONARY;
+                appendPacked(chunk, codes, rows, entry->bitWidth);
+            }
+
+            entry->stats.distinct = dictionary.count;
+            entry->stats.minValue = 0;
+            entry->stats.maxValue = dictionary.count > 0 ? dictionary.count - 1 : 0;
+            if (dictionary.count > 0) {
+                setTextStats(&entry->stats, sortedValues[0], sortedValues[dictionary.count - 1]);
+            }
+            trackedFree(sortedValues);
+        }
+    }
+
+    trackedFree(order);
+    trackedFree(rank);
+    trackedFree(dictionary.values);
+    trackedFree(dictionary.table);
+    return ok;
+}
+
+/**
+ * Collect the students to export, in ID order when an index is attached
+ */
+static const Student** collectRows(const Student* head, uint64_t* rows) {
+    IdIndex* index = getAttachedIdIndex();
+    if (index != NULL && idIndexDuplicates(index) > 0) {
+        index = NULL;   /* It left out duplicate IDs, so export every record in list order */
+    }
+    uint64_t count = 0;
+
+    if (index != NULL) {
+        count = (uint64_t)idIndexCount(index);
+    } else {
+        for (const Student* current = head; current != NULL; current = current->next) {
+            if (!current->deleted) count++;
+        }
+    }
+
+    const Student** students = (const Student**)trackedMalloc(sizeof(Student*) * (count + 1), MEM_IO_BUFFERS);
+    if (students == NULL) {
+        return NULL;
+    }
+    uint64_t filled = 0;
+    if (index != NULL) {
+        for (const IdIndexNode* node = idIndexFirst(index); node != NULL && filled < count; node = idIndexNext(node)) {
+            students[filled++] = idIndexStudent(node);
+        }
+    } else {
+        for (const Student* current = head; current != NULL; current = current->next) {
+            if (!current->deleted) students[filled++] = current;
+        }
+    }
+    *rows = filled;
+    return students;
+}
+
+bool exportColumnar(const char* filename, const Student* head) {
+    STATS_BEGIN(timer);
+    uint64_t rows = 0;
+    const Student** students = collectRows(head, &rows);
+    const char** texts = students != NULL ? (const char**)trackedMalloc(sizeof(char*) * (rows + 1), MEM_IO_BUFFERS) : NULL;
+    uint32_t* scratch = texts != NULL ? (uint32_t*)trackedMalloc(sizeof(uint32_t) * (rows + 1), MEM_IO_BUFFERS) : NULL;
+    if (scratch == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed for the columnar export.\n");
+        trackedFree(students);
+        trackedFree(texts);
+        return false;
+    }
+
+    ChunkBuffer chunks[COLUMN_COUNT];
+    ColumnEntry entries[COLUMN_COUNT];
+    memset(chunks, 0, sizeof(chunks));
+    memset(entries, 0, sizeof(entries));
+    bool ok = true;
+
+    for (int column = 0; column < COLUMN_COUNT && ok; column++) {
+        ColumnEntry* entry = &entries[column];
+        snprintf(entry->name, sizeof(entry->name), "%s", columnNames[column]);
+
+        for (uint64_t i = 0; i < rows; i++) {
+            const Student* student = students[i];
+            texts[i] = column == COLUMN_ID ? student->id
+                     : column == COLUMN_NAME ? student->name
+                     : column == COLUMN_COURSE ? student->course
+                     : student->grades;
+        }
+        switch (column) {
+            case COLUMN_ID:
+            case COLUMN_NAME:
+                buildStringColumn(&chunks[column], entry, texts, rows, column == COLUMN_ID);
+                break;
+            case COLUMN_AGE:
+                buildAgeColumn(&chunks[column], entry, students, rows, scratch);
+                break;
+            default:
+                ok = buildDictionaryColumn(&chunks[column], entry, texts, rows, scratch);
+                break;
+        }
+        ok = ok && !chunks[column].failed;
+    }
+
+    // Chunks follow the directory, each starting on an aligned offset
+    ColumnarHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+    header.version = COLUMNAR_VERSION;
+    header.columnCount = COLUMN_COUNT;
+    header.rowCount = rows;
+
+    uint64_t offset = sizeof(header) + sizeof(entries);
+    for (int column = 0; column < COLUMN_COUNT && ok; column++) {
+        entries[column].offset = offset;
+        entries[column].length = chunks[column].length;
+        entries[column].checksum = crc32c(0, chunks[column].data, chunks[column].length);
+        offset += chunks[column].length;
+    }
+    header.directoryChecksum = crc32c(crc32c(0, &header, HEADER_CHECKED_BYTES), entries, sizeof(entries));
+
+    FILE* file = ok ? fopen(filename, "wb") : NULL;
+    if (ok && file == NULL) {
+        fprintf(stderr, "Error: Could not open file %s for writing.\n", filename);
+        ok = false;
+    } else if (!ok) {
+        fprintf(stderr, "Error: Memory allocation failed for the columnar export.\n");
+    }
+    if (file != NULL) {
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(entries, sizeof(entries), 1, file);
+        for (int column = 0; column < COLUMN_COUNT; column++) {
+            fwrite(chunks[column].data, 1, chunks[column].length, file);
+        }
+        if (ferror(file) | (fclose(file) != 0)) {
+            fprintf(stderr, "Error: Could not write file %s.\n", filename);
+            ok = false;
+        }
+    }
+
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        trackedFree(chunks[column].data);
+    }
+    trackedFree(students);
+    trackedFree(texts);
+    trackedFree(scratch);
+    STATS_END(STAT_SAVE, timer);
+    return ok;
+}
+
+/* ---- Reading ---- */
+
+ColumnarFile* openColumnarFile(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open columnar file %s.\n", filename);
+        return NULL;
+    }
+
+    ColumnarFile* file = (ColumnarFile*)trackedCalloc(1, sizeof(ColumnarFile), MEM_INDEXES);
+    if (file == NULL) {
+        close(fd);
+        return NULL;
+    }
+    file->fd = fd;
+    snprintf(file->filename, sizeof(file->filename), "%s", filename);
+
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0 &&
+              pread(fd, &file->header, sizeof(file->header), 0) == (ssize_t)sizeof(file->header) &&
+              memcmp(file->header.magic, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC)) == 0 &&
+              file->header.version == COLUMNAR_VERSION &&
+              file->header.columnCount == COLUMN_COUNT &&
+              pread(fd, file->entries, sizeof(file->entries), sizeof(file->header)) ==
+                  (ssize_t)sizeof(file->entries) &&
+              crc32c(crc32c(0, &file->header, HEADER_CHECKED_BYTES), file->entries,
+                     sizeof(file->entries)) == file->header.directoryChecksum;
+    file->bytesRead = sizeof(file->header) + sizeof(file->entries);
+
+    // Every row has an offset in the ID column, which bounds the row count
+    // by the file size before it sizes any offset table or allocation
+    ok = ok && file->header.rowCount < file->entries[COLUMN_ID].length / sizeof(uint32_t);
+
+    for (int column = 0; column < COLUMN_COUNT && ok; column++) {
+        const ColumnEntry* entry = &file->entries[column];
+        ok = strncmp(entry->name, columnNames[column], COLUMN_NAME_LENGTH) == 0 &&
+             entry->offset % CHUNK_ALIGNMENT == 0 &&
+             entry->offset + entry->length <= (uint64_t)info.st_size &&
+             entry->bitWidth <= 32;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: %s is not a valid columnar file.\n", filename);
+        closeColumnarFile(file);
+        return NULL;
+    }
+    return file;
+}
+
+uint64_t columnarRowCount(const ColumnarFile* file) {
+    return file->header.rowCount;
+}
+
+const ColumnStats* columnarStats(const ColumnarFile* file, ColumnId column) {
+    return &file->entries[column].stats;
+}
+
+uint64_t columnarBytesRead(const ColumnarFile* file) {
+    return file->bytesRead;
+}
+
+/**
+ * Point at count + 1 offsets and the string bytes after them, checking
+ * that the offsets stay inside the chunk
+ * @return Bytes used before padding, or 0 if the offsets are invalid
+ */
+static size_t parseOffsetStrings(Column* column, const uint8_t* data, size_t available, uint64_t count) {
+    size_t offsetBytes = (size_t)(count + 1) * sizeof(uint32_t);
+    if (offsetBytes > available) {
+        return 0;
+    }
+    column->offsets = (const uint32_t*)data;
+    column->bytes = (const char*)data + offsetBytes;
+    for (uint64_t i = 0; i < count; i++) {
+        if (column->offsets[i] > column->offsets[i + 1]) {
+            return 0;
+        }
+    }
+    size_t used = offsetBytes + column->offsets[count];
+    return column->offsets[0] == 0 && used <= available ? used : 0;
+}
+
+static bool parseColumn(ColumnarFile* file, ColumnId id) {
+    const ColumnEntry* entry = &file->entries[id];
+    Column* column = &file->columns[id];
+    uint64_t rows = file->header.rowCount;
+    const uint8_t* data = column->chunk;
+    size_t length = (size_t)entry->length;
+    uint64_t packedBytes = (rows * entry->bitWidth + 63) / 64 * 8;
+
+    switch (entry->encoding) {
+        case ENCODING_OFFSET_STRINGS:
+            return (id == COLUMN_ID || id == COLUMN_NAME) && parseOffsetStrings(column, data, length, rows) > 0;
+
+        case ENCODING_BIT_PACKED:
+            column->packed = (const uint64_t*)data;
+            return id == COLUMN_AGE && packedBytes <= length;
+
+        case ENCODING_DICTIONARY:
+        case ENCODING_DICTIONARY_RLE: {
+            if (id != COLUMN_COURSE && id != COLUMN_GRADES) return false;
+            if (length < sizeof(uint32_t)) return false;
+            memcpy(&column->dictionarySize, data, sizeof(uint32_t));
+            size_t used = parseOffsetStrings(column, data + sizeof(uint32_t), length - sizeof(uint32_t),
+                                             column->dictionarySize);
+            if (used == 0) return false;
+            // The codes start on the next aligned offset of the chunk
+            used += sizeof(uint32_t);
+            used += (CHUNK_ALIGNMENT - used % CHUNK_ALIGNMENT) % CHUNK_ALIGNMENT;
+            if (used > length) return false;
+            data += used;
+            length -= used;
+
+            if (entry->encoding == ENCODING_DICTIONARY) {
+                column->packed = (const uint64_t*)data;
+                return packedBytes <= length;
+            }
+
+            // Expand the runs once, so every row is read in constant time
+            uint32_t runs;
+            if (length < sizeof(runs)) return false;
+            memcpy(&runs, data, sizeof(runs));
+            if (sizeof(runs) + (uint64_t)runs * 2 * sizeof(uint32_t) > length) return false;
+            column->codes = (uint32_t*)trackedMalloc(sizeof(uint32_t) * (rows + 1), MEM_IO_BUFFERS);
+            if (column->codes == NULL) return false;
+            const uint32_t* run = (const uint32_t*)(data + sizeof(runs));
+            uint64_t row = 0;
+            for (uint32_t i = 0; i < runs; i++, run += 2) {
+                if (run[0] >= column->dictionarySize || run[1] > rows - row) return false;
+                for (uint32_t k = 0; k < run[1]; k++) column->codes[row++] = run[0];
+            }
+            return row == rows;
+        }
+    }
+    return false;
+}
+
+bool columnarLoadColumn(ColumnarFile* file, ColumnId id) {
+    Column* column = &file->columns[id];
+    const ColumnEntry* entry = &file->entries[id];
+    if (column->loaded) {
+        return true;
+    }
+
+    column->chunk = (uint8_t*)trackedMalloc((size_t)entry->length + CHUNK_ALIGNMENT, MEM_IO_BUFFERS);
+    if (column->chunk == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed for column %s.\n", columnNames[id]);
+        return false;
+    }
+    ssize_t count = pread(file->fd, column->chunk, (size_t)entry->length, (off_t)entry->offset);
+    file->bytesRead += count > 0 ? (uint64_t)count : 0;
+
+    bool ok = count == (ssize_t)entry->length;
+    if (ok && crc32c(0, column->chunk, (size_t)entry->length) != entry->checksum) {
+        fprintf(stderr, "Error: Column %s of %s fails its checksum.\n", columnNames[id], file->filename);
+        ok = false;
+    } else if (ok && !parseColumn(file, id)) {
+        fprintf(stderr, "Error: Column %s of %s is malformed.\n", columnNames[id], file->filename);
+        ok = false;
+    } else if (!ok) {
+        fprintf(stderr, "Error: Could not read column %s of %s.\n", columnNames[id], file->filename);
+    }
+
+    if (!ok) {
+        trackedFree(column->codes);
+        trackedFree(column->chunk);
+        memset(column, 0, sizeof(Column));
+        return false;
+    }
+    column->loaded = true;
+    return true;
+}
+
+static uint32_t unpack(const uint64_t* packed, uint64_t row, uint8_t width) {
+    if (width == 0) {
+        return 0;
+    }
+    uint64_t bit = row * width;
+    uint64_t word = bit / 64;
+    unsigned shift = (unsigned)(bit % 64);
+    uint64_t value = packed[word] >> shift;
+    if (shift + width > 64) {
+        value |= packed[word + 1] << (64 - shift);
+    }
+    return (uint32_t)(value & ((1ULL << width) - 1));
+}
+
+static const char* copyText(const Column* column, uint32_t index, char* buffer, size_t size) {
+    size_t length = column->offsets[index + 1] - column->offsets[index];
+    if (length >= size) length = size - 1;
+    memcpy(buffer, column->bytes + column->offsets[index], length);
+    buffer[length] = '\0';
+    return buffer;
+}
+
+int columnarCode(ColumnarFile* file, ColumnId id, uint64_t row) {
+    if ((id != COLUMN_COURSE && id != COLUMN_GRADES) || row >= file->header.rowCount ||
+        !columnarLoadColumn(file, id)) {
+        return -1;
+    }
+    const Column* column = &file->columns[id];
+    uint32_t code = column->codes != NULL ? column->codes[row]
+                                          : unpack(column->packed, row, file->entries[id].bitWidth);
+    return code < column->dictionarySize ? (int)code : -1;
+}
+
+const char* columnarDictionaryValue(ColumnarFile* file, ColumnId id, uint32_t code, char* buffer, size_t size) {
+    if ((id != COLUMN_COURSE && id != COLUMN_GRADES) || !columnarLoadColumn(file, id) ||
+        code >= file->columns[id].dictionarySize) {
+        return NULL;
+    }
+    return copyText(&file->columns[id], code, buffer, size);
+}
+
+const char* columnarText(ColumnarFile* file, ColumnId id, uint64_t row, char* buffer, size_t size) {
+    if (id == COLUMN_COURSE || id == COLUMN_GRADES) {
+        int code = columnarCode(file, id, row);
+        return code < 0 ? NULL : columnarDictionaryValue(file, id, (uint32_t)code, buffer, size);
+    }
+    if ((id != COLUMN_ID && id != COLUMN_NAME) || row >= file->header.rowCount ||
+        !columnarLoadColumn(file, id)) {
+        return NULL;
+    }
+    return copyText(&file->columns[id], (uint32_t)row, buffer, size);
+}
+
+int columnarAge(ColumnarFile* file, uint64_t row) {
+    if (row >= file->header.rowCount || !columnarLoadColumn(file, COLUMN_AGE)) {
+        return -1;
+    }
+    const ColumnEntry* entry = &file->entries[COLUMN_AGE];
+    return (int)(entry->stats.minValue + unpack(file->columns[COLUMN_AGE].packed, row, entry->bitWidth));
+}
+
+void closeColumnarFile(ColumnarFile* file) {
+    if (file == NULL) {
+        return;
+    }
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        trackedFree(file->columns[column].codes);
+        trackedFree(file->columns[column].chunk);
+    }
+    close(file->fd);
+    trackedFree(file);
+}
+
+/* ---- Report ---- */
+
+bool printColumnarReport(const char* filename, FILE* out) {
+    uint64_t start = statsNow();
+    ColumnarFile* file = openColumnarFile(filename);
+    if (file == NULL) {
+        return false;
+    }
+
+    uint64_t rows = columnarRowCount(file);
+    uint64_t fileBytes = sizeof(ColumnarHeader) + sizeof(file->entries);
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        fileBytes += file->entries[column].length;
+    }
+
+    // The directory alone answers this part
+    fprintf(out, "%s: %llu rows, %d columns, %llu bytes\n", filename, (unsigned long long)rows,
+            COLUMN_COUNT, (unsigned long long)fileBytes);
+    fprintf(out, "%-8s %-16s %12s  %-20s %-20s\n", "Column", "Encoding", "Bytes", "Min", "Max");
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        const ColumnEntry* entry = &file->entries[column];
+        char encoding[32];
+        char min[COLUMN_STAT_LENGTH];
+        char max[COLUMN_STAT_LENGTH];
+        if (entry->encoding == ENCODING_OFFSET_STRINGS) {
+            snprintf(encoding, sizeof(encoding), "%s", encodingNames[entry->encoding]);
+        } else if (entry->encoding == ENCODING_BIT_PACKED) {
+            snprintf(encoding, sizeof(encoding), "%s(%u)", encodingNames[entry->encoding], entry->bitWidth);
+        } else {
+            snprintf(encoding, sizeof(encoding), "%s(%u)", encodingNames[entry->encoding % 4],
+                     entry->stats.distinct);
+        }
+        if (column == COLUMN_AGE) {
+            snprintf(min, sizeof(min), "%lld", (long long)entry->stats.minValue);
+            snprintf(max, sizeof(max), "%lld", (long long)entry->stats.maxValue);
+        } else {
+            snprintf(min, sizeof(min), "%.*s", COLUMN_STAT_LENGTH - 1, entry->stats.minText);
+            snprintf(max, sizeof(max), "%.*s", COLUMN_STAT_LENGTH - 1, entry->stats.maxText);
+        }
+        fprintf(out, "%-8s %-16s %12llu  %-20s %-20s\n", columnNames[column], encoding,
+                (unsigned long long)entry->length, min, max);
+    }
+
+    // Aggregates on dictionary codes: only course, age and grades are read
+    bool ok = columnarLoadColumn(file, COLUMN_COURSE) && columnarLoadColumn(file, COLUMN_AGE) &&
+              columnarLoadColumn(file, COLUMN_GRADES);
+    uint32_t courses = file->columns[COLUMN_COURSE].dictionarySize;
+    uint32_t grades = file->columns[COLUMN_GRADES].dictionarySize;
+    uint64_t* courseRows = ok ? (uint64_t*)trackedCalloc(courses + 1, sizeof(uint64_t), MEM_SEARCH_RESULTS) : NULL;
+    uint64_t* ageTotals = ok ? (uint64_t*)trackedCalloc(courses + 1, sizeof(uint64_t), MEM_SEARCH_RESULTS) : NULL;
+    uint64_t* gradeRows = ok ? (uint64_t*)trackedCalloc(grades + 1, sizeof(uint64_t), MEM_SEARCH_RESULTS) : NULL;
+    ok = ok && courseRows != NULL && ageTotals != NULL && gradeRows != NULL;
+
+    for (uint64_t row = 0; row < rows && ok; row++) {
+        int course = columnarCode(file, COLUMN_COURSE, row);
+        int grade = columnarCode(file, COLUMN_GRADES, row);
+        ok = course >= 0 && grade >= 0;
+        if (ok) {
+            courseRows[course]++;
+            ageTotals[course] += (uint64_t)columnarAge(file, row);
+            gradeRows[grade]++;
+        }
+    }
+
+    if (ok) {
+        char value[COLUMN_STAT_LENGTH];
+        fprintf(out, "\n%-30s %10s %8s\n", "Course", "Students", "Avg age");
+        for (uint32_t code = 0; code < courses; code++) {
+            fprintf(out, "%-30s %10llu %8.1f\n",
+                    columnarDictionaryValue(file, COLUMN_COURSE, code, value, sizeof(value)),
+                    (unsigned long long)courseRows[code],
+                    courseRows[code] > 0 ? (double)ageTotals[code] / (double)courseRows[code] : 0.0);
+        }
+        fprintf(out, "\n%-20s %10s %8s\n", "Grades", "Students", "Share");
+        for (uint32_t code = 0; code < grades; code++) {
+            fprintf(out, "%-20s %10llu %7.1f%%\n",
+                    columnarDictionaryValue(file, COLUMN_GRADES, code, value, sizeof(value)),
+                    (unsigned long long)gradeRows[code],
+                    rows > 0 ? 100.0 * (double)gradeRows[code] / (double)rows : 0.0);
+        }
+        fprintf(out, "\nRead %llu of %llu bytes in %.1f ms\n", (unsigned long long)columnarBytesRead(file),
+                (unsigned long long)fileBytes, (double)(statsNow() - start) / 1e6);
+    }
+
+    trackedFree(courseRows);
+    trackedFree(ageTotals);
+    trackedFree(gradeRows);
+    closeColumnarFile(file);
+    return ok;
+}
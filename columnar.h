@@ -0,0 +1,176 @@
+/**
+ * @file columnar.h
+ * @brief Header file containing the columnar analytics export
+ *
+ * A columnar file stores each student field as a separate chunk, so a
+ * report reads only the columns it aggregates:
+ *
+ *   header       magic, version, row and column counts, and a CRC32C
+ *                of those fields and the directory
+ *   directory    per column: name, encoding, chunk offset, length and
+ *                CRC32C, and min/max statistics
+ *   chunks       one per column, 8-byte aligned
+ *
+ * Encodings:
+ *   - id, name: offset strings (row count + 1 offsets, then the bytes)
+ *   - age: bit-packed (value - min) in the fewest bits that hold max - min
+ *   - course, grades: a sorted dictionary of the distinct values, then a
+ *     code per row, bit-packed or run-length encoded, whichever is smaller
+ *
+ * Codes follow the dictionary order, so comparing codes compares values.
+ * Integers are in host byte order (little-endian on x86).
+ */
+
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "student.h"
+
+#define COLUMNAR_FILE "students.col"   /* Default columnar export */
+#define COLUMNAR_MAGIC "STUCOL1"       /* First 8 bytes of a columnar file */
+#define COLUMNAR_VERSION 2              /* 2: the checksum covers the header fields */
+#define COLUMN_NAME_LENGTH 16
+#define COLUMN_STAT_LENGTH 64          /* Room for the longest text field */
+
+/* The exported columns, in file order */
+typedef enum {
+    COLUMN_ID,
+    COLUMN_NAME,
+    COLUMN_AGE,
+    COLUMN_COURSE,
+    COLUMN_GRADES,
+    COLUMN_COUNT
+} ColumnId;
+
+typedef enum {
+    ENCODING_OFFSET_STRINGS,  /* Offsets into a block of string bytes */
+    ENCODING_BIT_PACKED,      /* Integers minus the minimum, bitWidth bits each */
+    ENCODING_DICTIONARY,      /* Dictionary, then bit-packed codes */
+    ENCODING_DICTIONARY_RLE   /* Dictionary, then (code, run length) pairs */
+} ColumnEncoding;
+
+/* Statistics kept in the directory; only the ones of the column's type are set */
+typedef struct {
+    int64_t minValue;                 /* Integer columns */
+    int64_t maxValue;
+    char minText[COLUMN_STAT_LENGTH]; /* Text columns (IDs in natural order) */
+    char maxText[COLUMN_STAT_LENGTH];
+    uint32_t distinct;                /* Dictionary columns: dictionary size */
+} ColumnStats;
+
+/* Opaque handle for a columnar file opened for reading */
+typedef struct ColumnarFile ColumnarFile;
+
+/**
+ * @brief Export the roster to a columnar file
+ *
+ * Rows are written in ID order when an ID index is attached, and in list
+ * order otherwise; deleted students are left out.
+ *
+ * @param filename Name of the file to write
+ * @param head Pointer to the head of the linked list
+ * @return true if the file was written
+ */
+bool exportColumnar(const char* filename, const Student* head);
+
+/**
+ * @brief Open a columnar file and read its directory; no column is read yet
+ * @param filename Name of the file to open
+ * @return Handle, or NULL if the file is missing or not a valid columnar file
+ */
+ColumnarFile* openColumnarFile(const char* filename);
+
+/**
+ * @brief Get the number of rows
+ * @param file Columnar file
+ * @return Number of rows
+ */
+uint64_t columnarRowCount(const ColumnarFile* file);
+
+/**
+ * @brief Get the statistics of a column from the directory
+ * @param file Columnar file
+ * @param column Column
+ * @return Statistics of the column
+ */
+const ColumnStats* columnarStats(const ColumnarFile* file, ColumnId column);
+
+/**
+ * @brief Read a column chunk and check its checksum
+ *
+ * The accessors below load their column on first use; calling this
+ * first lets a failure be handled. A column is read at most once.
+ *
+ * @param file Columnar file
+ * @param column Column to read
+ * @return true if the column is loaded
+ */
+bool columnarLoadColumn(ColumnarFile* file, ColumnId column);
+
+/**
+ * @brief Get a text value (id, name, course or grades) of a row
+ * @param file Columnar file
+ * @param column Text column
+ * @param row Row number
+ * @param buffer Receives the NUL-terminated value
+ * @param size Size of the buffer
+ * @return buffer, or NULL if the column could not be read
+ */
+const char* columnarText(ColumnarFile* file, ColumnId column, uint64_t row, char* buffer, size_t size);
+
+/**
+ * @brief Get the age of a row
+ * @param file Columnar file
+ * @param row Row number
+ * @return Age, or -1 if the column could not be read
+ */
+int columnarAge(ColumnarFile* file, uint64_t row);
+
+/**
+ * @brief Get the dictionary code of a row in the course or grades column
+ * @param file Columnar file
+ * @param column Dictionary-encoded column
+ * @param row Row number
+ * @return Code (an index into the sorted dictionary), or -1 on error
+ */
+int columnarCode(ColumnarFile* file, ColumnId column, uint64_t row);
+
+/**
+ * @brief Get a dictionary value by code
+ * @param file Columnar file
+ * @param column Dictionary-encoded column
+ * @param code Code from columnarCode
+ * @param buffer Receives the NUL-terminated value
+ * @param size Size of the buffer
+ * @return buffer, or NULL on error
+ */
+const char* columnarDictionaryValue(ColumnarFile* file, ColumnId column, uint32_t code,
+                                    char* buffer, size_t size);
+
+/**
+ * @brief Get the number of file bytes read so far (directory and chunks)
+ * @param file Columnar file
+ * @return Bytes read
+ */
+uint64_t columnarBytesRead(const ColumnarFile* file);
+
+/**
+ * @brief Close a columnar file and free its columns
+ * @param file File to close
+ */
+void closeColumnarFile(ColumnarFile* file);
+
+/**
+ * @brief Print the column directory and per-course and per-grade aggregates
+ *
+ * Only the course, age and grades columns are read.
+ *
+ * @param filename Columnar file to report on
+ * @param out Stream to print to
+ * @return true if the file could be read
+ */
+bool printColumnarReport(const char* filename, FILE* out);
+
+#endif /* COLUMNAR_H */
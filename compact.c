@@ -0,0 +1,226 @@
+/**
+ * @file compact.c
+ * @brief Implementation of the compact, read-optimized roster layout
+ */
+
+#include "compact.h"
+#include "memtrack.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_RECORDS 256
+#define INITIAL_ARENA (16 * 1024)
+
+static bool reserveRecords(CompactRoster* roster, int needed) {
+    if (needed <= roster->capacity) {
+        return true;
+    }
+
+    int capacity = roster->capacity == 0 ? INITIAL_RECORDS : roster->capacity;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    CompactHot* hot = (CompactHot*)trackedRealloc(roster->hot, sizeof(CompactHot) * capacity, MEM_RECORDS);
+    if (hot == NULL) {
+        return false;
+    }
+    roster->hot = hot;
+
+    CompactCold* cold = (CompactCold*)trackedRealloc(roster->cold, sizeof(CompactCold) * capacity, MEM_RECORDS);
+    if (cold == NULL) {
+        return false;
+    }
+    roster->cold = cold;
+
+    roster->capacity = capacity;
+    return true;
+}
+
+/**
+ * Copy a string into the arena, truncated to maxLength - 1 characters
+ * like the fixed-size Student fields
+ */
+static bool storeString(CompactRoster* roster, const char* text, int maxLength, StringRef* ref) {
+    size_t length = strnlen(text, (size_t)maxLength - 1);
+
+    if (roster->arenaSize + length + 1 > roster->arenaCapacity) {
+        size_t capacity = roster->arenaCapacity == 0 ? INITIAL_ARENA : roster->arenaCapacity;
+        while (roster->arenaSize + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        if (capacity > UINT32_MAX) {
+            fprintf(stderr, "Compact roster string arena is full\n");
+            return false;
+        }
+
+        char* arena = (char*)trackedRealloc(roster->arena, capacity, MEM_RECORDS);
+        if (arena == NULL) {
+            return false;
+        }
+        roster->arena = arena;
+        roster->arenaCapacity = capacity;
+    }
+
+    memcpy(roster->arena + roster->arenaSize, text, length);
+    roster->arena[roster->arenaSize + length] = '\0';
+    ref->offset = (uint32_t)roster->arenaSize;
+    ref->length = (uint8_t)length;
+    roster->arenaSize += length + 1;
+    return true;
+}
+
+static CompactRoster* createCompactRoster(void) {
+    CompactRoster* roster = (CompactRoster*)trackedCalloc(1, sizeof(CompactRoster), MEM_RECORDS);
+    if (roster == NULL) {
+        fprintf(stderr, "Memory allocation failed for compact roster\n");
+    }
+    return roster;
+}
+
+/**
+ * Release the growth slack of a roster that will not be appended to soon.
+ * Shrinking is best effort; a failed realloc keeps the larger block.
+ */
+static void shrinkToFit(CompactRoster* roster) {
+    if (roster->count > 0 && roster->count < roster->capacity) {
+        CompactHot* hot = (CompactHot*)trackedRealloc(roster->hot, sizeof(CompactHot) * roster->count, MEM_RECORDS);
+        CompactCold* cold = (CompactCold*)trackedRealloc(roster->cold, sizeof(CompactCold) * roster->count, MEM_RECORDS);
+        if (hot != NULL) roster->hot = hot;
+        if (cold != NULL) roster->cold = cold;
+        if (hot != NULL && cold != NULL) roster->capacity = roster->count;
+    }
+    if (roster->arenaSize > 0 && roster->arenaSize < roster->arenaCapacity) {
+        char* arena = (char*)trackedRealloc(roster->arena, roster->arenaSize, MEM_RECORDS);
+        if (arena != NULL) {
+            roster->arena = arena;
+            roster->arenaCapacity = roster->arenaSize;
+        }
+    }
+}
+
+/**
+ * Append a copy of a student, applying the usual field length limits
+ */
+static bool compactAppend(CompactRoster* roster, const Student* student) {
+    if (!reserveRecords(roster, roster->count + 1)) {
+        return false;
+    }
+
+    CompactHot* hot = &roster->hot[roster->count];
+    CompactCold* cold = &roster->cold[roster->count];
+
+    strncpy(hot->id, student->id, ID_LENGTH - 1);
+    hot->id[ID_LENGTH - 1] = '\0';
+    cold->age = (uint8_t)student->age;
+
+    if (!storeString(roster, student->name, MAX_NAME_LENGTH, &hot->name) ||
+        !storeString(roster, student->nameKey, MAX_NAME_LENGTH, &hot->nameKey) ||
+        !storeString(roster, student->course, MAX_COURSE_LENGTH, &cold->course) ||
+        !storeString(roster, student->grades, MAX_GRADES_LENGTH, &cold->grades)) {
+        return false;
+    }
+
+    roster->count++;
+    return true;
+}
+
+CompactRoster* buildCompactRoster(const Student* head) {
+    CompactRoster* roster = createCompactRoster();
+    if (roster == NULL) {
+        return NULL;
+    }
+
+    for (const Student* current = head; current != NULL; current = current->next) {
+        if (current->deleted) continue;
+        if (!compactAppend(roster, current)) {
+            freeCompactRoster(roster);
+            return NULL;
+        }
+    }
+    shrinkToFit(roster);
+    return roster;
+}
+
+int compactCount(const CompactRoster* roster) {
+    return roster->count;
+}
+
+const char* compactId(const CompactRoster* roster, int index) {
+    return roster->hot[index].id;
+}
+
+const char* compactName(const CompactRoster* roster, int index) {
+    return roster->arena + roster->hot[index].name.offset;
+}
+
+int compactAge(const CompactRoster* roster, int index) {
+    return roster->cold[index].age;
+}
+
+const char* compactCourse(const CompactRoster* roster, int index) {
+    return roster->arena + roster->cold[index].course.offset;
+}
+
+const char* compactGrades(const CompactRoster* roster, int index) {
+    return roster->arena + roster->cold[index].grades.offset;
+}
+
+int* compactSearchByName(const CompactRoster* roster, const char* name, int* count) {
+    char key[MAX_NAME_LENGTH];
+    foldSearchKey(key, name, MAX_NAME_LENGTH);
+    size_t keyLength = strlen(key);
+    int capacity = 16;
+    int* results = (int*)trackedMalloc(sizeof(int) * capacity, MEM_SEARCH_RESULTS);
+
+    *count = 0;
+    if (results == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < roster->count; i++) {
+        const StringRef* ref = &roster->hot[i].nameKey;
+
+        // The stored length rules out short names without touching the arena
+        if (ref->length < keyLength ||
+            strstr(roster->arena + ref->offset, key) == NULL) {
+            continue;
+        }
+
+        if (*count == capacity) {
+            capacity *= 2;
+            int* grown = (int*)trackedRealloc(results, sizeof(int) * capacity, MEM_SEARCH_RESULTS);
+            if (grown == NULL) {
+                trackedFree(results);
+                *count = 0;
+                return NULL;
+            }
+            results = grown;
+        }
+        results[(*count)++] = i;
+    }
+
+    if (*count == 0) {
+        trackedFree(results);
+        return NULL;
+    }
+    return results;
+}
+
+size_t compactFootprint(const CompactRoster* roster) {
+    return sizeof(CompactRoster)
+         + (sizeof(CompactHot) + sizeof(CompactCold)) * (size_t)roster->capacity
+         + roster->arenaCapacity;
+}
+
+void freeCompactRoster(CompactRoster* roster) {
+    if (roster == NULL) {
+        return;
+    }
+    trackedFree(roster->hot);
+    trackedFree(roster->cold);
+    trackedFree(roster->arena);
+    trackedFree(roster);
+}
@@ -0,0 +1,98 @@
+/**
+ * @file compact.h
+ * @brief Header file containing the compact, read-optimized roster layout
+ *
+ * A compact roster stores every string in one contiguous arena and
+ * refers to it by offset and length. Fields used by lookups (ID and
+ * name) live in a dense "hot" array, separate from the "cold" array
+ * holding age, course and grades, so scans touch as few cache lines
+ * as possible. Records are read through accessor functions that return
+ * the same values the Student fields would.
+ *
+ * The roster is a read-only copy of the list; the batch 'compact'
+ * command builds one to compare footprint and name search time.
+ */
+
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "student.h"
+
+/* Reference to a NUL-terminated string inside the arena */
+typedef struct {
+    uint32_t offset;  /* Byte offset of the string in the arena */
+    uint8_t length;   /* String length without the terminator */
+} StringRef;
+
+/* Fields used by lookups, kept dense for scanning */
+typedef struct {
+    char id[ID_LENGTH];  /* Student ID, the lookup key */
+    StringRef name;      /* Student name */
+    StringRef nameKey;   /* Folded name matched by name searches */
+} CompactHot;
+
+/* Fields only needed once a record has been found */
+typedef struct {
+    StringRef course;
+    StringRef grades;
+    uint8_t age;         /* Ages are validated to 1-120 at input time */
+} CompactCold;
+
+typedef struct {
+    CompactHot* hot;       /* Hot fields, one entry per record */
+    CompactCold* cold;     /* Cold fields, same indexes as hot */
+    int count;
+    int capacity;
+    char* arena;           /* Contiguous storage for every string */
+    size_t arenaSize;
+    size_t arenaCapacity;
+} CompactRoster;
+
+/**
+ * @brief Build a compact roster holding a copy of every student in a list
+ * @param head Pointer to the head of the linked list
+ * @return New roster, or NULL if allocation failed
+ */
+CompactRoster* buildCompactRoster(const Student* head);
+
+/**
+ * @brief Get the number of records
+ * @param roster Compact roster
+ * @return Number of records
+ */
+int compactCount(const CompactRoster* roster);
+
+/* Field accessors; the returned strings stay valid until the roster is freed */
+const char* compactId(const CompactRoster* roster, int index);
+const char* compactName(const CompactRoster* roster, int index);
+int compactAge(const CompactRoster* roster, int index);
+const char* compactCourse(const CompactRoster* roster, int index);
+const char* compactGrades(const CompactRoster* roster, int index);
+
+/**
+ * @brief Search for records by name (case-insensitive, accents ignored),
+ *        scanning only the hot fields
+ * @param roster Compact roster
+ * @param name Name to search for
+ * @param count Pointer to store the count of matching records
+ * @return Array of matching record indexes (free with trackedFree),
+ *         or NULL if nothing matched
+ */
+int* compactSearchByName(const CompactRoster* roster, const char* name, int* count);
+
+/**
+ * @brief Get the number of bytes used by the roster's arrays and arena
+ * @param roster Compact roster
+ * @return Footprint in bytes
+ */
+size_t compactFootprint(const CompactRoster* roster);
+
+/**
+ * @brief Free a compact roster
+ * @param roster Roster to free (NULL is ignored)
+ */
+void freeCompactRoster(CompactRoster* roster);
+
+#endif /* COMPACT_H */
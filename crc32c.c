@@ -0,0 +1,124 @@
+/**
+ * @file crc32c.c
+ * @brief Implementation of the CRC32C (Castagnoli) checksum
+ */
+
+#include "crc32c.h"
+#include <pthread.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define HAVE_CRC32_INSTRUCTION 1
+#endif
+
+#define CRC32C_POLYNOMIAL 0x82F63B78u  /* Reflected Castagnoli polynomial */
+
+typedef uint32_t (*Crc32cFunction)(uint32_t crc, const unsigned char* data, size_t length);
+
+static uint32_t table[8][256];
+static Crc32cFunction implementation;
+static pthread_once_t initialized = PTHREAD_ONCE_INIT;
+
+/**
+ * Software version: eight table lookups per eight bytes
+ */
+static uint32_t crc32cSoftware(uint32_t crc, const unsigned char* data, size_t length) {
+    while (length > 0 && ((uintptr_t)data & 7) != 0) {
+        crc = table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+        length--;
+    }
+    while (length >= 8) {
+        uint32_t low;
+        uint32_t high;
+        memcpy(&low, data, 4);
+        memcpy(&high, data + 4, 4);
+        low ^= crc;
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+              table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^
+              table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while (length > 0) {
+        crc = table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+        length--;
+    }
+    return crc;
+}
+
+#ifdef HAVE_CRC32_INSTRUCTION
+__attribute__((target("sse4.2")))
+static uint32_t crc32cInstruction(uint32_t crc, const unsigned char* data, size_t length) {
+#ifdef __x86_64__
+    uint64_t wide = crc;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        wide = _mm_crc32_u64(wide, word);
+        data += 8;
+        length -= 8;
+    }
+    crc = (uint32_t)wide;
+#endif
+    // Records are short, so finish in at most three steps rather than byte by byte
+    while (length >= 4) {
+        uint32_t word;
+        memcpy(&word, data, 4);
+        crc = _mm_crc32_u32(crc, word);
+        data += 4;
+        length -= 4;
+    }
+    if (length >= 2) {
+        uint16_t half;
+        memcpy(&half, data, 2);
+        crc = _mm_crc32_u16(crc, half);
+        data += 2;
+        length -= 2;
+    }
+    if (length > 0) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+#endif
+
+static void initialize(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLYNOMIAL : 0);
+        }
+        table[0][i] = crc;
+    }
+    for (int slice = 1; slice < 8; slice++) {
+        for (int i = 0; i < 256; i++) {
+            uint32_t previous = table[slice - 1][i];
+            table[slice][i] = (previous >> 8) ^ table[0][previous & 0xFF];
+        }
+    }
+
+    Crc32cFunction function = crc32cSoftware;
+#ifdef HAVE_CRC32_INSTRUCTION
+    if (__builtin_cpu_supports("sse4.2")) {
+        function = crc32cInstruction;
+    }
+#endif
+    // Published last: a caller that sees it also sees the tables
+    __atomic_store_n(&implementation, function, __ATOMIC_RELEASE);
+}
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t length) {
+    // Called once per record, so skip pthread_once after the first call
+    Crc32cFunction function = __atomic_load_n(&implementation, __ATOMIC_ACQUIRE);
+    if (function == NULL) {
+        pthread_once(&initialized, initialize);
+        function = implementation;
+    }
+    return ~function(~crc, (const unsigned char*)data, length);
+}
+
+bool crc32cHardware(void) {
+    pthread_once(&initialized, initialize);
+    return implementation != crc32cSoftware;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file crc32c.h
+ * @brief Header file containing the CRC32C (Castagnoli) checksum
+ *
+ * On x86 processors with SSE4.2 the checksum uses the crc32 instruction,
+ * eight bytes at a time; elsewhere a table-driven (slicing-by-8) software
+ * version gives the same results. The choice is made once, on first use.
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Extend a CRC32C checksum with more data
+ *
+ * Start with 0; the checksum of a concatenation equals feeding the
+ * parts in order.
+ *
+ * @param crc Checksum of the data so far (0 for none)
+ * @param data Data to add
+ * @param length Number of bytes
+ * @return Checksum including the data
+ */
+uint32_t crc32c(uint32_t crc, const void* data, size_t length);
+
+/**
+ * @brief Check whether the hardware instruction is used
+ * @return true if checksums are computed with SSE4.2
+ */
+bool crc32cHardware(void);
+
+#endif /* CRC32C_H */
@@ -0,0 +1,382 @@
+/**
+ * @file dedup.c
+ * @brief Implementation of near-duplicate student detection
+ */
+
+#include "dedup.h"
+#include "idindex.h"
+#include "memtrack.h"
+#include "stats.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Largest number of following names each name is compared with in a block */
+#define BLOCK_WINDOW 16
+
+/* Blocking passes: Soundex of the first name token, then of the last one */
+#define BLOCK_PASSES 2
+
+typedef struct {
+    uint64_t keys[BLOCK_PASSES];  /* Block key of each pass */
+    uint64_t namePrefix;          /* First 8 bytes of the folded name, big-endian */
+    uint64_t gramMask;            /* One bit per hashed bigram of the name */
+    Student* student;
+    uint32_t position;            /* Position of the student in the list */
+    uint32_t gramStart;           /* First bigram in the shared bigram pool */
+    uint32_t gramCount;
+} DedupEntry;
+
+/* Candidate with the list positions of its students, for a cheap tie-break */
+typedef struct {
+    DuplicateCandidate candidate;
+    uint32_t firstPosition;
+    uint32_t secondPosition;
+} RankedCandidate;
+
+typedef struct {
+    RankedCandidate* candidates;
+    int count;
+    int capacity;
+} CandidateList;
+
+/* Pass whose key is being sorted on, read by compareEntries */
+static int sortPass;
+
+void soundexCode(const char* text, char* code) {
+    // Digit of each letter a..z; 0 for vowels, 7 for h and w which do
+    // not separate two consonants with the same digit
+    static const char digits[26] = {
+        0, 1, 2, 3, 0, 1, 2, 7, 0, 2, 2, 4, 5, 5, 0, 1, 2, 6, 2, 3, 0, 1, 7, 2, 0, 2
+    };
+    int length = 0;
+    char previous = 0;
+
+    for (const char* p = text; *p != '\0' && length < 4; p++) {
+        char letter = *p;
+        if (letter >= 'A' && letter <= 'Z') letter = (char)(letter - 'A' + 'a');
+        if (letter < 'a' || letter > 'z') continue;
+
+        char digit = digits[letter - 'a'];
+        if (length == 0) {
+            code[length++] = (char)(letter - 'a' + 'A');
+        } else if (digit == 7) {
+            continue;
+        } else if (digit != 0 && digit != previous) {
+            code[length++] = (char)('0' + digit);
+        }
+        previous = digit;
+    }
+
+    if (length == 0) {
+        code[length++] = '0';
+    }
+    while (length < 4) {
+        code[length++] = '0';
+    }
+    code[4] = '\0';
+}
+
+static uint64_t hashBytes(uint64_t hash, const char* text) {
+    for (const char* p = text; *p != '\0'; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 1099511628211ULL;
+    }
+    // Separator, so "ab"+"c" and "a"+"bc" hash differently
+    hash ^= 0xff;
+    hash *= 1099511628211ULL;
+    return hash;
+}
+
+/**
+ * Block keys of a student: the folded course combined with the Soundex
+ * code of the first and of the last token of the folded name
+ */
+static void computeBlockKeys(const Student* student, uint64_t keys[BLOCK_PASSES]) {
+    char course[sizeof(student->course)];
+    char token[MAX_NAME_LENGTH];
+    char code[5];
+    const char* name = student->nameKey;
+
+    foldSearchKey(course, student->course, sizeof(course));
+    uint64_t courseHash = hashBytes(1469598103934665603ULL, course);
+
+    while (*name == ' ') name++;
+    size_t firstLength = strcspn(name, " ");
+    memcpy(token, name, firstLength);
+    token[firstLength] = '\0';
+    soundexCode(token, code);
+    keys[0] = hashBytes(courseHash, code);
+
+    const char* last = strrchr(name, ' ');
+    soundexCode(last != NULL ? last + 1 : name, code);
+    keys[1] = hashBytes(courseHash, code);
+}
+
+static unsigned gramBit(uint16_t gram) {
+    return (unsigned)((gram * 40503u) >> 10) & 63u;
+}
+
+/**
+ * Bigrams of a folded name padded with a space on both sides, sorted so
+ * two names can be intersected with a merge
+ */
+static uint32_t collectBigrams(const char* nameKey, uint16_t* grams) {
+    uint32_t count = 0;
+    unsigned char previous = ' ';
+
+    for (const char* p = nameKey; ; p++) {
+        unsigned char current = *p != '\0' ? (unsigned char)*p : ' ';
+        if (!(previous == ' ' && current == ' ')) {
+            grams[count++] = (uint16_t)((previous << 8) | current);
+        }
+        if (*p == '\0') break;
+        previous = current;
+    }
+
+    // Names are short, so insertion sort beats qsort here
+    for (uint32_t i = 1; i < count; i++) {
+        uint16_t gram = grams[i];
+        uint32_t j = i;
+        while (j > 0 && grams[j - 1] > gram) {
+            grams[j] = grams[j - 1];
+            j--;
+        }
+        grams[j] = gram;
+    }
+    return count;
+}
+
+/**
+ * Dice coefficient of the two bigram multisets
+ */
+static double nameSimilarity(const uint16_t* first, uint32_t firstCount,
+                             const uint16_t* second, uint32_t secondCount) {
+    uint32_t i = 0, j = 0, shared = 0;
+
+    while (i < firstCount && j < secondCount) {
+        if (first[i] < second[j]) {
+            i++;
+        } else if (first[i] > second[j]) {
+            j++;
+        } else {
+            shared++;
+            i++;
+            j++;
+        }
+    }
+    return 2.0 * shared / (double)(firstCount + secondCount);
+}
+
+static int compareEntries(const void* a, const void* b) {
+    const DedupEntry* first = (const DedupEntry*)a;
+    const DedupEntry* second = (const DedupEntry*)b;
+
+    if (first->keys[sortPass] != second->keys[sortPass]) {
+        return first->keys[sortPass] < second->keys[sortPass] ? -1 : 1;
+    }
+    if (first->namePrefix != second->namePrefix) {
+        return first->namePrefix < second->namePrefix ? -1 : 1;
+    }
+    return strcmp(first->student->nameKey, second->student->nameKey);
+}
+
+static uint64_t namePrefix(const char* nameKey) {
+    uint64_t prefix = 0;
+    int i = 0;
+    for (; i < 8 && nameKey[i] != '\0'; i++) {
+        prefix = (prefix << 8) | (unsigned char)nameKey[i];
+    }
+    return prefix << (8 * (8 - i));
+}
+
+static bool addCandidate(CandidateList* list, const DedupEntry* first, const DedupEntry* second,
+                         double similarity) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        RankedCandidate* grown = (RankedCandidate*)trackedRealloc(
+            list->candidates, sizeof(RankedCandidate) * capacity, MEM_INDEXES);
+        if (grown == NULL) {
+            return false;
+        }
+        list->candidates = grown;
+        list->capacity = capacity;
+    }
+
+    // Lower ID first, so a pair always reads the same way
+    if (compareIds(first->student->id, second->student->id) > 0) {
+        const DedupEntry* swap = first;
+        first = second;
+        second = swap;
+    }
+    RankedCandidate* ranked = &list->candidates[list->count++];
+    ranked->candidate.first = first->student;
+    ranked->candidate.second = second->student;
+    ranked->candidate.similarity = similarity;
+    ranked->firstPosition = first->position;
+    ranked->secondPosition = second->position;
+    return true;
+}
+
+/**
+ * Compare the names within each block of the entries, already sorted on
+ * the key of this pass
+ */
+static bool compareBlocks(const DedupEntry* entries, int count, const uint16_t* pool,
+                          int pass, double threshold, CandidateList* list) {
+    for (int i = 0; i < count; i++) {
+        const DedupEntry* entry = &entries[i];
+
+        for (int j = i + 1; j < count && j <= i + BLOCK_WINDOW; j++) {
+            const DedupEntry* other = &entries[j];
+            if (other->keys[pass] != entry->keys[pass]) break;
+
+            // Pairs that also share an earlier block were compared there
+            bool seen = false;
+            for (int earlier = 0; earlier < pass; earlier++) {
+                if (other->keys[earlier] == entry->keys[earlier]) seen = true;
+            }
+            if (seen) continue;
+
+            // Every bit set for one name only stands for at least one bigram
+            // the other name lacks, which bounds the shared bigrams from above
+            uint32_t total = entry->gramCount + other->gramCount;
+            int entryOnly = __builtin_popcountll(entry->gramMask & ~other->gramMask);
+            int otherOnly = __builtin_popcountll(other->gramMask & ~entry->gramMask);
+            int sharedBound = (int)entry->gramCount - entryOnly;
+            if ((int)other->gramCount - otherOnly < sharedBound) {
+                sharedBound = (int)other->gramCount - otherOnly;
+            }
+            if (2.0 * sharedBound / (double)total < threshold) continue;
+
+            double similarity = nameSimilarity(pool + entry->gramStart, entry->gramCount,
+                                               pool + other->gramStart, other->gramCount);
+            if (similarity >= threshold &&
+                !addCandidate(list, entry, other, similarity)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Most similar first; equal scores keep the order of the students in the list
+ */
+static int compareCandidates(const void* a, const void* b) {
+    const RankedCandidate* first = (const RankedCandidate*)a;
+    const RankedCandidate* second = (const RankedCandidate*)b;
+
+    if (first->candidate.similarity != second->candidate.similarity) {
+        return first->candidate.similarity > second->candidate.similarity ? -1 : 1;
+    }
+    if (first->firstPosition != second->firstPosition) {
+        return first->firstPosition < second->firstPosition ? -1 : 1;
+    }
+    return (first->secondPosition > second->secondPosition) - (first->secondPosition < second->secondPosition);
+}
+
+DuplicateCandidate* findDuplicateCandidates(Student* head, double threshold, int* count) {
+    STATS_BEGIN(timer);
+    CandidateList list = {NULL, 0, 0};
+    int studentCount = 0;
+    size_t gramTotal = 0;
+    *count = 0;
+
+    // Every name has at most strlen + 1 padded bigrams
+    for (Student* current = head; current != NULL; current = current->next) {
+        if (current->deleted) continue;
+        studentCount++;
+        gramTotal += strlen(current->nameKey) + 1;
+    }
+    if (studentCount < 2) {
+        return NULL;
+    }
+
+    DedupEntry* entries = (DedupEntry*)trackedMalloc(sizeof(DedupEntry) * studentCount, MEM_INDEXES);
+    uint16_t* pool = (uint16_t*)trackedMalloc(sizeof(uint16_t) * gramTotal, MEM_INDEXES);
+    uint16_t* spare = (uint16_t*)trackedMalloc(sizeof(uint16_t) * gramTotal, MEM_INDEXES);
+    if (entries == NULL || pool == NULL || spare == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed for duplicate detection.\n");
+        trackedFree(entries);
+        trackedFree(pool);
+        trackedFree(spare);
+        return NULL;
+    }
+
+    int i = 0;
+    uint32_t poolUsed = 0;
+    for (Student* current = head; current != NULL; current = current->next) {
+        if (current->deleted) continue;
+        entries[i].student = current;
+        entries[i].position = (uint32_t)i;
+        entries[i].namePrefix = namePrefix(current->nameKey);
+        computeBlockKeys(current, entries[i].keys);
+        entries[i].gramStart = poolUsed;
+        entries[i].gramCount = collectBigrams(current->nameKey, pool + poolUsed);
+        entries[i].gramMask = 0;
+        for (uint32_t g = 0; g < entries[i].gramCount; g++) {
+            entries[i].gramMask |= 1ULL << gramBit(pool[poolUsed + g]);
+        }
+        poolUsed += entries[i].gramCount;
+        i++;
+    }
+
+    bool ok = true;
+    for (int pass = 0; pass < BLOCK_PASSES && ok; pass++) {
+        sortPass = pass;
+        qsort(entries, studentCount, sizeof(DedupEntry), compareEntries);
+
+        // Lay the bigrams out in block order, so comparing neighbours
+        // reads the pool sequentially instead of missing the cache
+        poolUsed = 0;
+        for (i = 0; i < studentCount; i++) {
+            memcpy(spare + poolUsed, pool + entries[i].gramStart, sizeof(uint16_t) * entries[i].gramCount);
+            entries[i].gramStart = poolUsed;
+            poolUsed += entries[i].gramCount;
+        }
+        uint16_t* swap = pool;
+        pool = spare;
+        spare = swap;
+
+        ok = compareBlocks(entries, studentCount, pool, pass, threshold, &list);
+    }
+
+    trackedFree(entries);
+    trackedFree(pool);
+    trackedFree(spare);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Memory allocation failed for duplicate detection.\n");
+        trackedFree(list.candidates);
+        return NULL;
+    }
+
+    if (list.count == 0) {
+        STATS_END(STAT_DUPLICATES, timer);
+        return NULL;
+    }
+
+    qsort(list.candidates, list.count, sizeof(RankedCandidate), compareCandidates);
+    DuplicateCandidate* candidates = (DuplicateCandidate*)trackedMalloc(
+        sizeof(DuplicateCandidate) * list.count, MEM_SEARCH_RESULTS);
+    if (candidates == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed for duplicate detection.\n");
+        trackedFree(list.candidates);
+        return NULL;
+    }
+    for (int c = 0; c < list.count; c++) {
+        candidates[c] = list.candidates[c].candidate;
+    }
+    trackedFree(list.candidates);
+
+    *count = list.count;
+    STATS_END(STAT_DUPLICATES, timer);
+    return candidates;
+}
+
+void freeDuplicateCandidates(DuplicateCandidate* candidates) {
+    trackedFree(candidates);
+}
@@ -0,0 +1,50 @@
+/**
+ * @file dedup.h
+ * @brief Header file containing near-duplicate student detection
+ *
+ * Students are grouped into blocks that share a course and the Soundex
+ * code of a name token (one pass for the first token, one for the last
+ * token), and only students within a block are compared. Names are
+ * compared by the Dice coefficient of their folded bigrams. Very large
+ * blocks are compared within a sliding window over the names sorted
+ * alphabetically, so the work stays linear in the roster size.
+ */
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "student.h"
+
+#define DEFAULT_DUPLICATE_THRESHOLD 0.7  /* Minimum name similarity reported */
+
+/* Two students that may be the same person */
+typedef struct {
+    Student* first;
+    Student* second;
+    double similarity;   /* Name similarity between 0 and 1 */
+} DuplicateCandidate;
+
+/**
+ * @brief Compute the Soundex code of the letters in a text
+ * @param text Text to encode (non-letters are ignored)
+ * @param code Buffer of at least 5 bytes for the code (for example "S530")
+ */
+void soundexCode(const char* text, char* code);
+
+/**
+ * @brief Find pairs of students in the same course with similar names
+ * @param head Pointer to the head of the linked list
+ * @param threshold Minimum name similarity (0 to 1) of a reported pair
+ * @param count Pointer to store the number of candidate pairs
+ * @return Candidates ranked by similarity, most similar first (free with
+ *         freeDuplicateCandidates), or NULL if none were found
+ */
+DuplicateCandidate* findDuplicateCandidates(Student* head, double threshold, int* count);
+
+/**
+ * @brief Free a candidate array returned by findDuplicateCandidates
+ * @param candidates Array to free (the students themselves are not freed)
+ */
+void freeDuplicateCandidates(DuplicateCandidate* candidates);
+
+#endif /* DEDUP_H */
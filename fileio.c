@@ -4,92 +4,666 @@
  */
 
 #include "fileio.h"
+#include "stats.h"
+#include "utils.h"
+#include "memtrack.h"
+#include "idindex.h"
+#include "shard.h"
+#include "crc32c.h"
+#include "asyncio.h"
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-bool saveStudentsToFile(const char* filename, const Student* head) {
-    FILE* file = fopen(filename, "w");
-    if (file == NULL) {
+#define SAVE_TEMP_SUFFIX ".saving"   /* Data file being written by a save */
+#define LOAD_REPORT_LIMIT 10        /* Problems printed individually while loading */
+#define VERIFY_WINDOW (4 << 20)     /* Bytes checksummed at a time while verifying */
+#define FIELD_SEPARATORS 4          /* Commas between the five fields of a record */
+
+bool strictLoading = false;
+
+_Static_assert(STUDENT_RECORD_LENGTH <= RECORD_LINE_LENGTH,
+               "the longest record must fit the line buffer used when loading");
+
+/* Record text and parsing, expanded from the schema */
+#define APPEND_FIELD(member, kind, size, label, width) \
+    SCHEMA_APPEND_##kind(out, student->member); \
+    *out++ = ',';
+#define PARSE_FIELD(member, kind, size, label, width) \
+    token = strtok_r(cursor, ",", &save); \
+    if (token == NULL) return false; \
+    SCHEMA_PARSE_##kind(student->member, token); \
+    cursor = NULL;
+
+/* A data file being written, with the running checksum for its trailer */
+typedef struct {
+    AsyncWriter* out;
+    uint32_t checksum;
+    uint64_t records;
+} DataFileWriter;
+
+/* Line splitting state carried from one read buffer to the next */
+typedef struct {
+    DataLineHandler handler;
+    void* context;
+    char partial[RECORD_LINE_LENGTH];  /* Start of a line split across buffers */
+    size_t partialLength;
+} LineSplitter;
+
+/* Records loaded so far */
+typedef struct {
+    Student* head;
+    Student* tail;
+    IntegrityCheck check;
+} DataFileLoader;
+
+/**
+ * Open a data file for writing; formatted records are written in large
+ * buffers, overlapped with formatting the next ones when io_uring is used
+ */
+static bool openDataFileForWriting(DataFileWriter* writer, const char* filename) {
+    memset(writer, 0, sizeof(DataFileWriter));
+    writer->out = openAsyncWriter(filename);
+    if (writer->out == NULL) {
         fprintf(stderr, "Error: Could not open file %s for writing.\n", filename);
         return false;
     }
+    return true;
+}
+
+static void writeStudentRecord(DataFileWriter* writer, const Student* student) {
+    char line[RECORD_LINE_LENGTH];
+    int length = formatStudentRecord(line, sizeof(line), student);
+    
+    writer->checksum = crc32c(writer->checksum, line, (size_t)length);
+    writer->records++;
+    asyncWrite(writer->out, line, (size_t)length);
+}
+
+/**
+ * Write the trailer and close the file
+ * @return false if anything could not be written
+ */
+static bool closeDataFile(DataFileWriter* writer, const char* filename) {
+    char trailer[64];
+    int length = formatFileTrailer(trailer, sizeof(trailer), writer->checksum, writer->records);
+    asyncWrite(writer->out, trailer, (size_t)length);
+    
+    bool written = closeAsyncWriter(writer->out);
+    if (!written) {
+        fprintf(stderr, "Error: Could not write file %s: %s\n", filename, strerror(errno));
+    }
+    return written;
+}
+
+int formatStudentFields(char* line, const Student* student) {
+    char* out = line;
+    STUDENT_FIELDS(APPEND_FIELD)
+    
+    // Drop the comma after the last field
+    *--out = '\0';
+    return (int)(out - line);
+}
+
+static const char hexDigits[] = "0123456789abcdef";
+
+int formatStudentRecord(char* line, size_t size, const Student* student) {
+    if (size < STUDENT_RECORD_LENGTH) {
+        return 0;
+    }
+    
+    // CSV fields, then the checksum of exactly those bytes
+    int length = formatStudentFields(line, student);
+    uint32_t checksum = crc32c(0, line, (size_t)length);
+    char* out = line + length;
+    *out++ = ',';
+    *out++ = '~';
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        *out++ = hexDigits[(checksum >> shift) & 0xf];
+    }
+    *out++ = '\n';
+    *out = '\0';
+    return (int)(out - line);
+}
+
+int formatFileTrailer(char* line, size_t size, uint32_t checksum, uint64_t records) {
+    return snprintf(line, size, FILE_CHECKSUM_TAG "%08x,records=%llu\n", checksum,
+                    (unsigned long long)records);
+}
+
+/**
+ * Write every student, in ID order when an index is given (the index is
+ * already ordered, so no sort pass is needed) and in list order otherwise
+ */
+static void writeRoster(DataFileWriter* writer, const Student* head, const IdIndex* index) {
+    // An index that left out duplicate IDs would drop those records
+    if (index != NULL && idIndexDuplicates(index) == 0) {
+        for (const IdIndexNode* node = idIndexFirst(index); node != NULL; node = idIndexNext(node)) {
+            writeStudentRecord(writer, idIndexStudent(node));
+        }
+        return;
+    }
     
-    const Student* current = head;
+    for (const Student* current = head; current != NULL; current = current->next) {
+        if (!current->deleted) {
+            writeStudentRecord(writer, current);
+        }
+    }
+}
+
+bool saveStudentsToFile(const char* filename, const Student* head) {
+    STATS_BEGIN(timer);
+    DataFileWriter writer;
+    if (!openDataFileForWriting(&writer, filename)) {
+        return false;
+    }
     
-    while (current != NULL) {
-        // Write student data to file in CSV format
-        fprintf(file, "%s,%s,%d,%s,%s\n", 
-                current->id, 
-                current->name, 
-                current->age, 
-                current->course, 
-                current->grades);
+    writeRoster(&writer, head, NULL);
+    bool written = closeDataFile(&writer, filename);
+    STATS_END(STAT_SAVE, timer);
+    return written;
+}
+
+bool saveStudentsToFileInIdOrder(const char* filename, const Student* head, const IdIndex* index) {
+    STATS_BEGIN(timer);
+    DataFileWriter writer;
+    if (!openDataFileForWriting(&writer, filename)) {
+        return false;
+    }
+    
+    writeRoster(&writer, head, index);
+    bool written = closeDataFile(&writer, filename);
+    STATS_END(STAT_SAVE, timer);
+    return written;
+}
+
+/* Value plus one of each hex digit; 0 for any other character */
+static const unsigned char hexValues[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+RecordStatus checkRecordChecksum(const char* line, size_t length) {
+    if (length > 0 && line[length - 1] == '\n') {
+        length--;
+    }
+    if (length < RECORD_CHECKSUM_LENGTH) {
+        return RECORD_UNCHECKED;
+    }
+    
+    const char* suffix = line + length - RECORD_CHECKSUM_LENGTH;
+    if (suffix[0] != ',' || suffix[1] != '~') {
+        return RECORD_UNCHECKED;
+    }
+    // Table lookups without branches: the digits are random, so a branch
+    // per digit would mispredict on every record
+    uint32_t stored = 0;
+    unsigned valid = 1;
+    for (int i = 2; i < RECORD_CHECKSUM_LENGTH; i++) {
+        unsigned value = hexValues[(unsigned char)suffix[i]];
+        valid &= value != 0;
+        stored = (stored << 4) | ((value - 1) & 0xF);
+    }
+    if (!valid) {
+        return RECORD_UNCHECKED;
+    }
+    
+    return crc32c(0, line, length - RECORD_CHECKSUM_LENGTH) == stored ? RECORD_OK : RECORD_CORRUPT;
+}
+
+void beginIntegrityCheck(IntegrityCheck* check, const char* filename, FILE* out, int reportLimit) {
+    memset(check, 0, sizeof(IntegrityCheck));
+    check->filename = filename;
+    check->out = out;
+    check->reportLimit = reportLimit;
+    check->trackFileChecksum = true;
+}
+
+/**
+ * Report one problem, with the line and student ID when it concerns a line
+ */
+static void reportProblem(IntegrityCheck* check, const char* line, size_t length, const char* problem) {
+    check->problems++;
+    if (check->reportLimit >= 0 && check->problems > (uint64_t)check->reportLimit) {
+        return;
+    }
+    if (line == NULL) {
+        fprintf(check->out, "%s: %s\n", check->filename, problem);
+        return;
+    }
+    
+    // The ID is the first field; damaged bytes are shown as '?'
+    char id[ID_LENGTH];
+    size_t idLength = 0;
+    while (idLength < length && idLength < ID_LENGTH - 1 && line[idLength] != ',' &&
+           line[idLength] != '\n') {
+        unsigned char c = (unsigned char)line[idLength];
+        id[idLength++] = (c >= 32 && c < 127) ? (char)c : '?';
+    }
+    id[idLength] = '\0';
+    fprintf(check->out, "%s:%llu: %s (ID %s)\n", check->filename,
+            (unsigned long long)check->line, problem, idLength > 0 ? id : "missing");
+}
+
+/**
+ * Compare a trailer line with what has been read before it
+ */
+static void checkTrailer(IntegrityCheck* check, const char* line, size_t length) {
+    char text[64];
+    unsigned int checksum;
+    unsigned long long records;
+    
+    if (check->hasTrailer) {
+        reportProblem(check, line, length, "second file checksum trailer");
+        return;
+    }
+    check->hasTrailer = true;
+    
+    snprintf(text, sizeof(text), "%.*s", (int)(length < sizeof(text) ? length : sizeof(text) - 1), line);
+    if (sscanf(text, FILE_CHECKSUM_TAG "%8x,records=%llu", &checksum, &records) != 2) {
+        reportProblem(check, line, length, "malformed file checksum trailer");
+        return;
+    }
+    
+    char problem[128];
+    uint64_t found = check->records + check->corrupt + check->malformed;
+    if (checksum != check->fileChecksum) {
+        snprintf(problem, sizeof(problem), "file checksum %08x does not match the stored %08x",
+                 check->fileChecksum, checksum);
+        reportProblem(check, NULL, 0, problem);
+    } else if (records != found) {
+        snprintf(problem, sizeof(problem), "trailer lists %llu record(s) but %llu were found",
+                 records, (unsigned long long)found);
+        reportProblem(check, NULL, 0, problem);
+    } else {
+        check->trailerOk = true;
+    }
+}
+
+RecordStatus checkDataLine(IntegrityCheck* check, const char* line, size_t length, size_t* payload) {
+    size_t textLength = length > 0 && line[length - 1] == '\n' ? length - 1 : length;
+    check->line++;
+    
+    if (line[0] == '#' && textLength >= sizeof(FILE_CHECKSUM_TAG) - 1 &&
+        memcmp(line, FILE_CHECKSUM_TAG, sizeof(FILE_CHECKSUM_TAG) - 1) == 0) {
+        checkTrailer(check, line, textLength);
+        return RECORD_SKIPPED;
+    }
+    
+    // Everything before the trailer is covered by the file checksum
+    if (check->trackFileChecksum && !check->hasTrailer) {
+        check->fileChecksum = crc32c(check->fileChecksum, line, length);
+    }
+    // Only the trailer is special; a student ID may itself start with '#'
+    if (textLength == 0) {
+        return RECORD_SKIPPED;
+    }
+    if (check->hasTrailer) {
+        reportProblem(check, line, textLength, "record after the file checksum trailer");
+    }
+    
+    // A record with a correct checksum was written whole, so the fields
+    // only need counting when it has none or a wrong one
+    RecordStatus status = checkRecordChecksum(line, textLength);
+    if (status != RECORD_OK) {
+        int separators = 0;
+        for (size_t i = 0; i < textLength && separators < FIELD_SEPARATORS; i++) {
+            if (line[i] == ',') separators++;
+        }
+        if (separators < FIELD_SEPARATORS || line[0] == ',') {
+            check->malformed++;
+            reportProblem(check, line, textLength, "malformed record");
+            return RECORD_MALFORMED;
+        }
+    }
+
+    if (check->records + check->corrupt == 0) {
+        // The first record tells whether the file was written with checksums
+        check->checksummed = status != RECORD_UNCHECKED;
+    }
+    if (status == RECORD_UNCHECKED && check->checksummed) {
+        check->corrupt++;
+        reportProblem(check, line, textLength, "record has lost its checksum");
+        return RECORD_CORRUPT;
+    }
+    if (status == RECORD_CORRUPT) {
+        check->corrupt++;
+        reportProblem(check, line, textLength, "record fails its checksum");
+        return RECORD_CORRUPT;
+    }
+    
+    check->records++;
+    if (status == RECORD_UNCHECKED) {
+        check->unchecked++;
+        *payload = textLength;
+    } else {
+        *payload = textLength - RECORD_CHECKSUM_LENGTH;
+    }
+    return status;
+}
+
+bool endIntegrityCheck(IntegrityCheck* check) {
+    if ((check->checksummed || check->corrupt > 0) && !check->hasTrailer) {
+        reportProblem(check, NULL, 0, "no file checksum trailer; the file is truncated");
+    }
+    if (check->reportLimit >= 0 && check->problems > (uint64_t)check->reportLimit) {
+        fprintf(check->out, "%s: %llu more problem(s) not shown\n", check->filename,
+                (unsigned long long)(check->problems - (uint64_t)check->reportLimit));
+    }
+    // Verification prints its own summary
+    if (check->problems > 0 && check->reportLimit >= 0) {
+        fprintf(check->out, "%s: %llu corrupt record(s) and %llu malformed line(s) skipped, "
+                "%llu record(s) intact\n", check->filename, (unsigned long long)check->corrupt,
+                (unsigned long long)check->malformed, (unsigned long long)check->records);
+    }
+    return check->problems == 0;
+}
+
+void enforceStrictLoading(const IntegrityCheck* check) {
+    if (strictLoading && check->problems > 0) {
+        fprintf(stderr, "Strict loading: %s failed its integrity check; stopping. "
+                        "Restore it from a backup or load without --strict.\n", check->filename);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Check the lines of one window of a mapped data file
+ */
+static void verifyWindow(IntegrityCheck* check, const char* data, size_t length) {
+    size_t offset = 0;
+    size_t payload;
+    
+    while (offset < length) {
+        const char* end = memchr(data + offset, '\n', length - offset);
+        size_t lineLength = (end != NULL ? (size_t)(end - data) + 1 : length) - offset;
+        checkDataLine(check, data + offset, lineLength, &payload);
+        offset += lineLength;
+    }
+}
+
+bool verifyStudentsFile(const char* filename, FILE* out, VerifyReport* report) {
+    memset(report, 0, sizeof(VerifyReport));
+    IntegrityCheck* check = &report->check;
+    beginIntegrityCheck(check, filename, out, -1);
+    
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open file %s.\n", filename);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        fprintf(stderr, "Error: Could not read file %s.\n", filename);
+        close(fd);
+        return false;
+    }
+    report->bytes = (uint64_t)info.st_size;
+    
+    uint64_t start = statsNow();
+    const char* data = NULL;
+    size_t size = (size_t)info.st_size;
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (data == MAP_FAILED) {
+            fprintf(stderr, "Error: Could not map file %s.\n", filename);
+            close(fd);
+            return false;
+        }
+        madvise((void*)data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    
+    // The trailer is the last line; everything before it is checksummed
+    // window by window, and each window's lines are checked while the
+    // window is still in cache. Without a final trailer, lines are
+    // checksummed one at a time so a misplaced trailer is still checked.
+    size_t body = size;
+    if (size > 0) {
+        size_t last = size - (data[size - 1] == '\n' ? 1 : 0);
+        while (last > 0 && data[last - 1] != '\n') last--;
+        if (size - last >= sizeof(FILE_CHECKSUM_TAG) - 1 &&
+            memcmp(data + last, FILE_CHECKSUM_TAG, sizeof(FILE_CHECKSUM_TAG) - 1) == 0) {
+            body = last;
+        }
+    }
+    
+    check->trackFileChecksum = body == size;
+    size_t position = 0;
+    while (position < body) {
+        size_t windowEnd = body - position > VERIFY_WINDOW ? position + VERIFY_WINDOW : body;
+        const char* newline = memchr(data + windowEnd - 1, '\n', body - windowEnd + 1);
+        windowEnd = newline != NULL ? (size_t)(newline - data) + 1 : body;
         
-        current = current->next;
+        if (!check->trackFileChecksum) {
+            check->fileChecksum = crc32c(check->fileChecksum, data + position, windowEnd - position);
+        }
+        verifyWindow(check, data + position, windowEnd - position);
+        position = windowEnd;
+    }
+    report->wholeChecksum = body == size ? crc32c(0, data, size) : check->fileChecksum;
+    if (body < size) {
+        verifyWindow(check, data + body, size - body);
+        report->wholeChecksum = crc32c(report->wholeChecksum, data + body, size - body);
+    }
+    
+    bool ok = endIntegrityCheck(check);
+    report->nanos = statsNow() - start;
+    if (data != NULL) {
+        munmap((void*)data, size);
     }
+    return ok;
+}
+
+void printVerifyReport(FILE* out, const VerifyReport* report) {
+    const IntegrityCheck* check = &report->check;
+    double seconds = (double)report->nanos / 1e9;
     
-    fclose(file);
+    fprintf(out, "%s: %llu record(s), %llu corrupt, %llu malformed", check->filename,
+            (unsigned long long)(check->records + check->corrupt),
+            (unsigned long long)check->corrupt, (unsigned long long)check->malformed);
+    if (!check->checksummed && check->corrupt == 0) {
+        fprintf(out, "; written without checksums, so records could not be verified");
+    } else if (check->trailerOk) {
+        fprintf(out, "; file checksum %08x matches", check->fileChecksum);
+    }
+    fprintf(out, "\nVerified %llu bytes in %.3fs", (unsigned long long)report->bytes, seconds);
+    if (seconds > 0.0) {
+        fprintf(out, ": %.0f MB/s", (double)report->bytes / 1e6 / seconds);
+    }
+    fprintf(out, " (%s CRC32C)\n", crc32cHardware() ? "hardware" : "software");
+}
+
+/**
+ * Split a record into the schema fields; strtok_r keeps parallel shard
+ * loads independent
+ * @return false if a field is missing
+ */
+static bool parseStudentFields(Student* student, char* line) {
+    char* cursor = line;
+    char* save = NULL;
+    char* token;
+    STUDENT_FIELDS(PARSE_FIELD)
     return true;
 }
 
-Student* loadStudentsFromFile(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (file == NULL) {
-        // File doesn't exist yet, which is okay for first run
+Student* parseStudentLine(char* line) {
+    // Remove newline character if present
+    size_t len = strlen(line);
+    if (len > 0 && line[len-1] == '\n') {
+        line[len-1] = '\0';
+    }
+    
+    Student fields;
+    if (!parseStudentFields(&fields, line)) {
         return NULL;
     }
+    return createStudentFrom(&fields);
+}
+
+/**
+ * Check and parse one line; the line may be modified
+ */
+static void loadLine(void* context, char* line, size_t length) {
+    DataFileLoader* loader = (DataFileLoader*)context;
+    size_t payload;
+    RecordStatus status = checkDataLine(&loader->check, line, length, &payload);
+    if (status != RECORD_OK && status != RECORD_UNCHECKED) return;
+    
+    line[payload] = '\0';
+    Student* newStudent = parseStudentLine(line);
+    if (newStudent == NULL) return;
     
-    Student* head = NULL;
-    char line[256];
+    // Append at the tail so loading stays linear in the file size
+    if (loader->tail == NULL) {
+        loader->head = newStudent;
+    } else {
+        loader->tail->next = newStudent;
+    }
+    loader->tail = newStudent;
+}
+
+/**
+ * Split a read buffer into lines. Lines inside the buffer are handled in
+ * place; a line split across buffers is joined in splitter->partial. As
+ * with fgets, a line longer than RECORD_LINE_LENGTH - 1 bytes is cut
+ * into pieces of that length.
+ */
+static void splitBuffer(LineSplitter* splitter, char* data, size_t length) {
+    const size_t limit = RECORD_LINE_LENGTH - 1;
+    size_t offset = 0;
     
-    while (fgets(line, sizeof(line), file)) {
-        char id[ID_LENGTH];
-        char name[MAX_NAME_LENGTH];
-        int age;
-        char course[MAX_COURSE_LENGTH];
-        char grades[MAX_GRADES_LENGTH];
+    while (offset < length) {
+        size_t room = limit - splitter->partialLength;
+        size_t available = length - offset < room ? length - offset : room;
+        char* end = memchr(data + offset, '\n', available);
         
-        // Remove newline character if present
-        size_t len = strlen(line);
-        if (len > 0 && line[len-1] == '\n') {
-            line[len-1] = '\0';
+        if (end != NULL && splitter->partialLength == 0) {
+            // Common case: the whole line is in this buffer
+            size_t lineLength = (size_t)(end - (data + offset)) + 1;
+            splitter->handler(splitter->context, data + offset, lineLength);
+            offset += lineLength;
+            continue;
         }
         
-        // Parse the CSV line
-        char* token = strtok(line, ",");
-        if (token == NULL) continue;
-        strncpy(id, token, ID_LENGTH - 1);
-        id[ID_LENGTH - 1] = '\0';
-        
-        token = strtok(NULL, ",");
-        if (token == NULL) continue;
-        strncpy(name, token, MAX_NAME_LENGTH - 1);
-        name[MAX_NAME_LENGTH - 1] = '\0';
-        
-        token = strtok(NULL, ",");
-        if (token == NULL) continue;
-        age = atoi(token);
-        
-        token = strtok(NULL, ",");
-        if (token == NULL) continue;
-        strncpy(course, token, MAX_COURSE_LENGTH - 1);
-        course[MAX_COURSE_LENGTH - 1] = '\0';
-        
-        token = strtok(NULL, ",");
-        if (token == NULL) continue;
-        strncpy(grades, token, MAX_GRADES_LENGTH - 1);
-        grades[MAX_GRADES_LENGTH - 1] = '\0';
-        
-        // Create a student and add to list
-        Student* newStudent = createStudent(id, name, age, course, grades);
-        if (newStudent != NULL) {
-            head = addStudent(head, newStudent);
+        size_t take = end != NULL ? (size_t)(end - (data + offset)) + 1 : available;
+        memcpy(splitter->partial + splitter->partialLength, data + offset, take);
+        splitter->partialLength += take;
+        offset += take;
+        if (end != NULL || splitter->partialLength == limit) {
+            splitter->partial[splitter->partialLength] = '\0';
+            splitter->handler(splitter->context, splitter->partial, splitter->partialLength);
+            splitter->partialLength = 0;
         }
     }
+}
+
+bool readDataFileLines(AsyncReader* reader, const char* filename,
+                       DataLineHandler handler, void* context) {
+    // Handling one buffer overlaps the reads queued for the next ones
+    LineSplitter* splitter = (LineSplitter*)trackedCalloc(1, sizeof(LineSplitter), MEM_IO_BUFFERS);
+    if (splitter == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed while reading %s.\n", filename);
+        return false;
+    }
+    splitter->handler = handler;
+    splitter->context = context;
     
-    fclose(file);
-    return head;
+    char* data;
+    ssize_t length;
+    while ((length = asyncReadNext(reader, &data)) > 0) {
+        splitBuffer(splitter, data, (size_t)length);
+    }
+    if (length < 0) {
+        fprintf(stderr, "Error: Could not read %s: %s\n", filename, strerror(errno));
+    }
+    if (splitter->partialLength > 0) {
+        // A final line without a newline still counts
+        splitter->partial[splitter->partialLength] = '\0';
+        handler(context, splitter->partial, splitter->partialLength);
+    }
+    trackedFree(splitter);
+    return length == 0;
+}
+
+Student* loadStudentsFromFile(const char* filename) {
+    AsyncReader* reader = openAsyncReader(filename);
+    if (reader == NULL) {
+        // File doesn't exist yet, which is okay for first run
+        return NULL;
+    }
+    
+    STATS_BEGIN(timer);
+    DataFileLoader loader = {NULL, NULL, {0}};
+    beginIntegrityCheck(&loader.check, filename, stderr, LOAD_REPORT_LIMIT);
+    readDataFileLines(reader, filename, loadLine, &loader);
+    closeAsyncReader(reader);
+    
+    endIntegrityCheck(&loader.check);
+    enforceStrictLoading(&loader.check);
+    STATS_END(STAT_LOAD, timer);
+    return loader.head;
+}
+
+bool saveStudentsWithBackup(const char* filename, const Student* head,
+                            const char* backupPrefix, const char* backupExtension) {
+    // A sharded roster backs up and rewrites only its dirty shards
+    ShardSet* shards = getAttachedShardSet();
+    if (shards != NULL) {
+        return saveShardSet(shards, head);
+    }
+    
+    // Write next to the data file, so it is only replaced by a complete save
+    STATS_BEGIN(timer);
+    char temporary[256];
+    snprintf(temporary, sizeof(temporary), "%s%s", filename, SAVE_TEMP_SUFFIX);
+    DataFileWriter writer;
+    if (!openDataFileForWriting(&writer, temporary)) {
+        fprintf(stderr, "Failed to save student data.\n");
+        return false;
+    }
+    
+    // Save current data, in ID order when an index is available
+    writeRoster(&writer, head, getAttachedIdIndex());
+    bool written = closeDataFile(&writer, temporary);
+    bool saved = written;
+    
+    // Only a complete save touches the data file: the backup is a second
+    // link to the current file, and the rename then replaces the data file
+    // in one step, so students.dat exists throughout
+    if (saved && doesFileExist(filename)) {
+        char backupFilename[100];
+        generateBackupFilename(backupFilename, backupPrefix, backupExtension, sizeof(backupFilename));
+        unlink(backupFilename);
+        if (link(filename, backupFilename) == 0) {
+            printf("Created backup: %s\n", backupFilename);
+        } else {
+            fprintf(stderr, "Failed to create backup file.\n");
+        }
+    }
+    if (saved && rename(temporary, filename) != 0) {
+        fprintf(stderr, "Error: Could not replace %s: %s\n", filename, strerror(errno));
+        saved = false;
+    }
+    STATS_END(STAT_SAVE, timer);
+    
+    if (saved) {
+        printf("Student data saved successfully to %s.\n", filename);
+        return true;
+    }
+    
+    if (!written) {
+        unlink(temporary);
+    }
+    fprintf(stderr, "Failed to save student data.\n");
+    return false;
 }
 
 bool doesFileExist(const char* filename) {
@@ -6,7 +6,71 @@
 #ifndef FILEIO_H
 #define FILEIO_H
 
+#include <stdio.h>
+#include <stdint.h>
 #include "student.h"
+#include "idindex.h"
+#include "asyncio.h"
+
+#define DATA_FILE "students.dat"          /* Default student data file */
+#define BACKUP_PREFIX "students_backup"   /* Prefix of timestamped backups */
+#define BACKUP_EXT "dat"                  /* Extension of timestamped backups */
+#define RECORD_LINE_LENGTH 256            /* Longest data file line that is read */
+#define RECORD_CHECKSUM_LENGTH 10         /* ",~" and eight hex digits after each record */
+#define FILE_CHECKSUM_TAG "#crc32c="      /* Start of the trailer line of a data file */
+
+/* Longest record line written: the schema fields, checksum and newline, plus a NUL */
+#define STUDENT_RECORD_LENGTH (STUDENT_FIELDS_LENGTH + RECORD_CHECKSUM_LENGTH + 2)
+
+/*
+ * Data files are written with a CRC32C checksum after every record and a
+ * trailer holding the checksum of everything before it:
+ *
+ *   S1,Alice Smith,20,Physics,A,~1c2d3e4f
+ *   ...
+ *   #crc32c=9a8b7c6d,records=1000
+ *
+ * A record checksum covers the record text before ",~". Files written
+ * before checksums existed have neither and still load unchecked.
+ */
+
+/* When true, any integrity problem found while loading stops the program */
+extern bool strictLoading;
+
+/* Result of checking one record line */
+typedef enum {
+    RECORD_OK,         /* Checksum present and correct */
+    RECORD_UNCHECKED,  /* No checksum (written by an older version) */
+    RECORD_CORRUPT,    /* Checksum present but wrong */
+    RECORD_MALFORMED,  /* Fewer than five fields */
+    RECORD_SKIPPED     /* Blank line or trailer; not a record */
+} RecordStatus;
+
+/* Integrity state of one data file, built up line by line */
+typedef struct {
+    const char* filename;
+    FILE* out;                /* Where problems are reported */
+    int reportLimit;          /* Problems printed individually (-1 for all) */
+    bool trackFileChecksum;   /* Feed each line into fileChecksum */
+    uint32_t fileChecksum;    /* CRC32C of the bytes before the trailer */
+    uint64_t line;            /* Number of the line being checked */
+    uint64_t records;         /* Records that passed */
+    uint64_t unchecked;       /* Records without a checksum, of those that passed */
+    uint64_t corrupt;         /* Records failing their checksum */
+    uint64_t malformed;       /* Lines that are not records */
+    uint64_t problems;        /* Problems found, including trailer problems */
+    bool checksummed;         /* The first record carried a checksum */
+    bool hasTrailer;
+    bool trailerOk;           /* Trailer checksum and record count match */
+} IntegrityCheck;
+
+/* Result of verifying a data file */
+typedef struct {
+    IntegrityCheck check;
+    uint64_t bytes;           /* Size of the file */
+    uint32_t wholeChecksum;   /* CRC32C of the entire file, trailer included */
+    uint64_t nanos;           /* Time spent verifying */
+} VerifyReport;
 
 /**
  * @brief Save the student linked list to a file
@@ -16,13 +80,176 @@
  */
 bool saveStudentsToFile(const char* filename, const Student* head);
 
+/**
+ * @brief Save the students of an ID index to a file in ID order
+ *
+ * If the index left out students with duplicate IDs, every student of
+ * the list is saved in list order instead, so none are lost.
+ *
+ * @param filename Name of the file to save to
+ * @param head Pointer to the head of the linked list
+ * @param index ID index over the linked list
+ * @return true if save was successful, false otherwise
+ */
+bool saveStudentsToFileInIdOrder(const char* filename, const Student* head, const IdIndex* index);
+
+/**
+ * @brief Save to a temporary file, then replace the data file with it
+ *
+ * The roster is written to "<filename>.saving". Once that file is
+ * complete, the existing data file is linked to a timestamped backup and
+ * the temporary file is renamed over it, so a failed save leaves the
+ * data file untouched.
+ *
+ * Records are written in ID order when an ID index is attached, and in
+ * list order otherwise. When a shard set is attached, the roster is saved
+ * through saveShardSet instead and filename is not used.
+ *
+ * @param filename Name of the file to save to
+ * @param head Pointer to the head of the linked list
+ * @param backupPrefix Prefix for the backup filename
+ * @param backupExtension Extension for the backup filename
+ * @return true if save was successful, false otherwise
+ */
+bool saveStudentsWithBackup(const char* filename, const Student* head,
+                            const char* backupPrefix, const char* backupExtension);
+
 /**
  * @brief Load student data from a file into a linked list
+ *
+ * Records failing their checksum and malformed lines are reported and
+ * skipped, or stop the program when strictLoading is set.
+ *
  * @param filename Name of the file to load from
  * @return Head of the loaded linked list, or NULL if file doesn't exist
  */
 Student* loadStudentsFromFile(const char* filename);
 
+/* Receives one line of a data file, with its newline if it has one; the line may be modified */
+typedef void (*DataLineHandler)(void* context, char* line, size_t length);
+
+/**
+ * @brief Read a data file to the end, split into lines as loading does
+ *
+ * As with fgets, a line longer than RECORD_LINE_LENGTH - 1 bytes is
+ * handed over in pieces of that length. A final line without a newline
+ * still counts.
+ *
+ * @param reader Reader opened on the file; the caller closes it
+ * @param filename Name of the file, used in error messages
+ * @param handler Called with each line, in file order
+ * @param context Passed to the handler
+ * @return true if the whole file was read
+ */
+bool readDataFileLines(AsyncReader* reader, const char* filename,
+                       DataLineHandler handler, void* context);
+
+/**
+ * @brief Parse one CSV line (id,name,age,course,grades) into a new student
+ *
+ * Fields after grades, such as a record checksum, are ignored.
+ *
+ * @param line Line to parse; it is modified in place by the tokenizer
+ * @return Newly created student, or NULL if the line is malformed
+ */
+Student* parseStudentLine(char* line);
+
+/**
+ * @brief Format the stored fields of a student as comma-separated text
+ * @param line Buffer of at least STUDENT_FIELDS_LENGTH + 1 bytes; NUL-terminated
+ * @param student Student to format
+ * @return Length of the text
+ */
+int formatStudentFields(char* line, const Student* student);
+
+/**
+ * @brief Format a student as a checksummed data file line
+ * @param line Buffer for the line, including its newline
+ * @param size Size of the buffer, at least STUDENT_RECORD_LENGTH
+ * @param student Student to format
+ * @return Length of the line, or 0 if the buffer is too small
+ */
+int formatStudentRecord(char* line, size_t size, const Student* student);
+
+/**
+ * @brief Format the trailer line that ends a data file
+ * @param line Buffer for the line, including its newline
+ * @param size Size of the buffer
+ * @param checksum CRC32C of every record line before the trailer
+ * @param records Number of records in the file
+ * @return Length of the line
+ */
+int formatFileTrailer(char* line, size_t size, uint32_t checksum, uint64_t records);
+
+/**
+ * @brief Check the checksum of a single record line
+ * @param line Record line, with or without its newline
+ * @param length Length of the line
+ * @return RECORD_OK, RECORD_UNCHECKED or RECORD_CORRUPT
+ */
+RecordStatus checkRecordChecksum(const char* line, size_t length);
+
+/**
+ * @brief Start the integrity check of a data file
+ * @param check State to initialize
+ * @param filename Name of the file, used in reports
+ * @param out Stream problems are reported to
+ * @param reportLimit Problems to print individually (-1 for all)
+ */
+void beginIntegrityCheck(IntegrityCheck* check, const char* filename, FILE* out, int reportLimit);
+
+/**
+ * @brief Check the next line of a data file
+ *
+ * Problems are reported with their line number and student ID.
+ *
+ * @param check Integrity state of the file
+ * @param line Line, including its newline if it has one
+ * @param length Length of the line
+ * @param payload Set to the length of the record text without its
+ *                checksum or newline when the line is a record
+ * @return Status of the line
+ */
+RecordStatus checkDataLine(IntegrityCheck* check, const char* line, size_t length, size_t* payload);
+
+/**
+ * @brief Finish the integrity check of a data file
+ *
+ * Reports a missing trailer on a checksummed file (truncation) and a
+ * summary of the problems found.
+ *
+ * @param check Integrity state of the file
+ * @return true if no problem was found
+ */
+bool endIntegrityCheck(IntegrityCheck* check);
+
+/**
+ * @brief Stop the program if strict loading is on and a check failed
+ * @param check Finished integrity check
+ */
+void enforceStrictLoading(const IntegrityCheck* check);
+
+/**
+ * @brief Verify every record and the trailer of a data file
+ *
+ * The file is mapped into memory and checked in large windows, so the
+ * speed is close to the memory bandwidth when CRC32C is done in hardware.
+ * Every corrupt record is reported to out.
+ *
+ * @param filename Name of the file to verify
+ * @param out Stream the problems are reported to
+ * @param report Filled with the results
+ * @return true if the file could be read and no problem was found
+ */
+bool verifyStudentsFile(const char* filename, FILE* out, VerifyReport* report);
+
+/**
+ * @brief Print the summary and throughput of a verification
+ * @param out Stream to print to
+ * @param report Results of verifyStudentsFile
+ */
+void printVerifyReport(FILE* out, const VerifyReport* report);
+
 /**
  * @brief Check if the student data file exists
  * @param filename Name of the file to check
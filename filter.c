@@ -0,0 +1,657 @@
+/**
+ * @file filter.c
+ * @brief Implementation of the student filter expression language
+ */
+
+#include "filter.h"
+#include "idindex.h"
+#include "memtrack.h"
+#include "stats.h"
+#include "utils.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+typedef enum {
+    FILTER_FIELD_ID,
+    FILTER_FIELD_NAME,
+    FILTER_FIELD_AGE,
+    FILTER_FIELD_COURSE,
+    FILTER_FIELD_GRADES
+} FilterField;
+
+typedef enum {
+    FOP_COMPARE,   /* field <comparison> operand */
+    FOP_BETWEEN,   /* operand <= field <= highOperand */
+    FOP_CONTAINS,  /* folded field contains folded operand */
+    FOP_AND,
+    FOP_OR,
+    FOP_NOT
+} FilterOpcode;
+
+typedef enum { CMP_EQ, CMP_NE, CMP_LT, CMP_LE, CMP_GT, CMP_GE } FilterComparison;
+
+typedef struct {
+    unsigned char opcode;
+    unsigned char field;
+    unsigned char comparison;
+    int number;                      /* Operands of age predicates */
+    int highNumber;
+    char text[MAX_NAME_LENGTH];      /* Operands of string predicates */
+    char highText[MAX_NAME_LENGTH];
+} FilterInstruction;
+
+struct FilterProgram {
+    FilterInstruction code[FILTER_MAX_INSTRUCTIONS];  /* Postfix order */
+    int count;
+    bool hasLow;                     /* ID bounds every match satisfies */
+    bool hasHigh;
+    char low[MAX_NAME_LENGTH];
+    char high[MAX_NAME_LENGTH];
+};
+
+static const struct {
+    const char* name;
+    FilterField field;
+} fieldNames[] = {
+    {"id", FILTER_FIELD_ID}, {"name", FILTER_FIELD_NAME}, {"age", FILTER_FIELD_AGE},
+    {"course", FILTER_FIELD_COURSE}, {"grades", FILTER_FIELD_GRADES}
+};
+
+/* ---- Tokenizer ---- */
+
+typedef enum {
+    TOKEN_END,
+    TOKEN_WORD,     /* Field name or keyword */
+    TOKEN_STRING,
+    TOKEN_NUMBER,
+    TOKEN_OPERATOR,
+    TOKEN_LPAREN,
+    TOKEN_RPAREN
+} TokenKind;
+
+typedef struct {
+    TokenKind kind;
+    int position;                    /* 1-based column, for error messages */
+    int number;
+    size_t length;                   /* Characters in text (strings may be truncated) */
+    char text[MAX_NAME_LENGTH];
+} Token;
+
+typedef struct {
+    const char* text;
+    size_t offset;
+    Token token;                     /* Current token */
+    FilterProgram* program;
+    char* error;
+    size_t errorSize;
+    bool failed;
+} Parser;
+
+static void parseError(Parser* parser, const char* format, ...) {
+    if (parser->failed) {
+        return;
+    }
+    parser->failed = true;
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(parser->error, parser->errorSize, format, args);
+    va_end(args);
+}
+
+static void nextToken(Parser* parser) {
+    const char* text = parser->text;
+    size_t offset = parser->offset;
+    Token* token = &parser->token;
+
+    while (isspace((unsigned char)text[offset])) {
+        offset++;
+    }
+
+    memset(token, 0, sizeof(Token));
+    token->position = (int)offset + 1;
+
+    char c = text[offset];
+    if (c == '\0') {
+        token->kind = TOKEN_END;
+    } else if (c == '(' || c == ')') {
+        token->kind = c == '(' ? TOKEN_LPAREN : TOKEN_RPAREN;
+        offset++;
+    } else if (c == '"' || c == '\'') {
+        size_t start = ++offset;
+        while (text[offset] != '\0' && text[offset] != c) {
+            offset++;
+        }
+        if (text[offset] != c) {
+            parseError(parser, "Unterminated string at position %d", token->position);
+            token->kind = TOKEN_END;
+            parser->offset = offset;
+            return;
+        }
+        token->kind = TOKEN_STRING;
+        token->length = offset - start;
+        size_t copy = token->length < MAX_NAME_LENGTH - 1 ? token->length : MAX_NAME_LENGTH - 1;
+        memcpy(token->text, text + start, copy);
+        offset++;
+    } else if (isdigit((unsigned char)c) || (c == '-' && isdigit((unsigned char)text[offset + 1]))) {
+        char* end;
+        long value = strtol(text + offset, &end, 10);
+        if (value > 1000000 || value < -1000000) {
+            parseError(parser, "Number out of range at position %d", token->position);
+        }
+        token->kind = TOKEN_NUMBER;
+        token->number = (int)value;
+        offset = (size_t)(end - text);
+    } else if (isalpha((unsigned char)c) || c == '_') {
+        size_t start = offset;
+        while (isalnum((unsigned char)text[offset]) || text[offset] == '_') {
+            offset++;
+        }
+        token->kind = TOKEN_WORD;
+        token->length = offset - start;
+        size_t copy = token->length < MAX_NAME_LENGTH - 1 ? token->length : MAX_NAME_LENGTH - 1;
+        memcpy(token->text, text + start, copy);
+    } else if (strchr("=!<>~", c) != NULL) {
+        size_t start = offset++;
+        if (text[offset] == '=' && c != '~') {
+            offset++;
+        }
+        token->kind = TOKEN_OPERATOR;
+        token->length = offset - start;
+        memcpy(token->text, text + start, token->length);
+        if (strcmp(token->text, "=") == 0 || strcmp(token->text, "!") == 0) {
+            parseError(parser, "Unknown operator '%s' at position %d (use == or !=)",
+                       token->text, token->position);
+        }
+    } else {
+        parseError(parser, "Unexpected character '%c' at position %d", c, token->position);
+        token->kind = TOKEN_END;
+    }
+
+    parser->offset = offset;
+}
+
+static bool isKeyword(const Token* token, const char* keyword) {
+    return token->kind == TOKEN_WORD && strcasecmp(token->text, keyword) == 0;
+}
+
+static const char* describeToken(const Token* token) {
+    switch (token->kind) {
+        case TOKEN_END: return "end of expression";
+        case TOKEN_STRING: return "string";
+        case TOKEN_NUMBER: return "number";
+        case TOKEN_LPAREN: return "'('";
+        case TOKEN_RPAREN: return "')'";
+        default: return token->text;
+    }
+}
+
+/* ---- Parser: emits instructions in postfix order ---- */
+
+static FilterInstruction* emit(Parser* parser, FilterOpcode opcode) {
+    if (parser->failed) {
+        return NULL;
+    }
+    FilterProgram* program = parser->program;
+    if (program->count == FILTER_MAX_INSTRUCTIONS) {
+        parseError(parser, "Expression is too long (at most %d predicates and operators)",
+                   FILTER_MAX_INSTRUCTIONS);
+        return NULL;
+    }
+    FilterInstruction* instruction = &program->code[program->count++];
+    memset(instruction, 0, sizeof(FilterInstruction));
+    instruction->opcode = (unsigned char)opcode;
+    return instruction;
+}
+
+/**
+ * Read a literal operand, checking it has the type of the field
+ */
+static bool parseOperand(Parser* parser, FilterField field, const char* fieldName,
+                         int* number, char* text) {
+    Token* token = &parser->token;
+
+    if (field == FILTER_FIELD_AGE) {
+        if (token->kind != TOKEN_NUMBER) {
+            parseError(parser, "Field '%s' compares with a number, found %s at position %d",
+                       fieldName, describeToken(token), token->position);
+            return false;
+        }
+        *number = token->number;
+    } else {
+        if (token->kind != TOKEN_STRING) {
+            parseError(parser, "Field '%s' compares with a quoted string, found %s at position %d",
+                       fieldName, describeToken(token), token->position);
+            return false;
+        }
+        if (token->length > MAX_NAME_LENGTH - 1) {
+            parseError(parser, "String at position %d is longer than %d characters",
+                       token->position, MAX_NAME_LENGTH - 1);
+            return false;
+        }
+        strcpy(text, token->text);
+    }
+    nextToken(parser);
+    return true;
+}
+
+static void parsePredicate(Parser* parser) {
+    Token* token = &parser->token;
+
+    int fieldIndex = -1;
+    if (token->kind == TOKEN_WORD) {
+        for (size_t i = 0; i < sizeof(fieldNames) / sizeof(fieldNames[0]); i++) {
+            if (strcasecmp(token->text, fieldNames[i].name) == 0) {
+                fieldIndex = (int)i;
+                break;
+            }
+        }
+    }
+    if (fieldIndex < 0) {
+        if (token->kind == TOKEN_WORD) {
+            parseError(parser, "Unknown field '%s' at position %d (fields: id, name, age, course, grades)",
+                       token->text, token->position);
+        } else {
+            parseError(parser, "Expected a field name, found %s at position %d",
+                       describeToken(token), token->position);
+        }
+        return;
+    }
+    FilterField field = fieldNames[fieldIndex].field;
+    const char* fieldName = fieldNames[fieldIndex].name;
+    nextToken(parser);
+
+    FilterInstruction operands;
+    memset(&operands, 0, sizeof(operands));
+
+    if (isKeyword(token, "between")) {
+        nextToken(parser);
+        if (!parseOperand(parser, field, fieldName, &operands.number, operands.text)) {
+            return;
+        }
+        if (!isKeyword(token, "and")) {
+            parseError(parser, "Expected 'and' in 'between', found %s at position %d",
+                       describeToken(token), token->position);
+            return;
+        }
+        nextToken(parser);
+        if (!parseOperand(parser, field, fieldName, &operands.highNumber, operands.highText)) {
+            return;
+        }
+        FilterInstruction* instruction = emit(parser, FOP_BETWEEN);
+        if (instruction != NULL) {
+            instruction->field = (unsigned char)field;
+            instruction->number = operands.number;
+            instruction->highNumber = operands.highNumber;
+            strcpy(instruction->text, operands.text);
+            strcpy(instruction->highText, operands.highText);
+        }
+        return;
+    }
+
+    if (token->kind != TOKEN_OPERATOR) {
+        parseError(parser, "Expected an operator after '%s', found %s at position %d",
+                   fieldName, describeToken(token), token->position);
+        return;
+    }
+
+    if (strcmp(token->text, "~") == 0) {
+        if (field == FILTER_FIELD_AGE) {
+            parseError(parser, "Operator '~' needs a text field, not '%s' (position %d)",
+                       fieldName, token->position);
+            return;
+        }
+        nextToken(parser);
+        if (!parseOperand(parser, field, fieldName, &operands.number, operands.text)) {
+            return;
+        }
+        FilterInstruction* instruction = emit(parser, FOP_CONTAINS);
+        if (instruction != NULL) {
+            instruction->field = (unsigned char)field;
+            foldSearchKey(instruction->text, operands.text, MAX_NAME_LENGTH);
+        }
+        return;
+    }
+
+    static const struct {
+        const char* text;
+        FilterComparison comparison;
+    } comparisons[] = {
+        {"==", CMP_EQ}, {"!=", CMP_NE}, {"<", CMP_LT}, {"<=", CMP_LE}, {">", CMP_GT}, {">=", CMP_GE}
+    };
+    int comparisonIndex = -1;
+    for (size_t i = 0; i < sizeof(comparisons) / sizeof(comparisons[0]); i++) {
+        if (strcmp(token->text, comparisons[i].text) == 0) {
+            comparisonIndex = (int)i;
+            break;
+        }
+    }
+    if (comparisonIndex < 0) {
+        parseError(parser, "Unknown operator '%s' at position %d", token->text, token->position);
+        return;
+    }
+    nextToken(parser);
+    if (!parseOperand(parser, field, fieldName, &operands.number, operands.text)) {
+        return;
+    }
+    FilterInstruction* instruction = emit(parser, FOP_COMPARE);
+    if (instruction != NULL) {
+        instruction->field = (unsigned char)field;
+        instruction->comparison = (unsigned char)comparisons[comparisonIndex].comparison;
+        instruction->number = operands.number;
+        strcpy(instruction->text, operands.text);
+    }
+}
+
+static void parseOr(Parser* parser);
+
+static void parseUnary(Parser* parser) {
+    Token* token = &parser->token;
+
+    if (isKeyword(token, "not")) {
+        nextToken(parser);
+        parseUnary(parser);
+        emit(parser, FOP_NOT);
+    } else if (token->kind == TOKEN_LPAREN) {
+        int position = token->position;
+        nextToken(parser);
+        parseOr(parser);
+        if (token->kind != TOKEN_RPAREN) {
+            parseError(parser, "Missing ')' for '(' at position %d", position);
+            return;
+        }
+        nextToken(parser);
+    } else {
+        parsePredicate(parser);
+    }
+}
+
+static void parseAnd(Parser* parser) {
+    parseUnary(parser);
+    while (!parser->failed && isKeyword(&parser->token, "and")) {
+        nextToken(parser);
+        parseUnary(parser);
+        emit(parser, FOP_AND);
+    }
+}
+
+static void parseOr(Parser* parser) {
+    parseAnd(parser);
+    while (!parser->failed && isKeyword(&parser->token, "or")) {
+        nextToken(parser);
+        parseAnd(parser);
+        emit(parser, FOP_OR);
+    }
+}
+
+/* ---- ID bounds for index pushdown ---- */
+
+typedef struct {
+    const char* low;   /* NULL when unbounded */
+    const char* high;
+} IdRange;
+
+static const char* tighterLow(const char* first, const char* second) {
+    if (first == NULL) return second;
+    if (second == NULL) return first;
+    return compareIds(first, second) >= 0 ? first : second;
+}
+
+static const char* tighterHigh(const char* first, const char* second) {
+    if (first == NULL) return second;
+    if (second == NULL) return first;
+    return compareIds(first, second) <= 0 ? first : second;
+}
+
+static const char* looserLow(const char* first, const char* second) {
+    if (first == NULL || second == NULL) return NULL;
+    return compareIds(first, second) <= 0 ? first : second;
+}
+
+static const char* looserHigh(const char* first, const char* second) {
+    if (first == NULL || second == NULL) return NULL;
+    return compareIds(first, second) >= 0 ? first : second;
+}
+
+/**
+ * Derive the ID range implied by the whole program: predicates on id
+ * bound it, "and" intersects ranges, "or" takes their union and "not"
+ * drops the bound
+ */
+static void computeIdBounds(FilterProgram* program) {
+    IdRange stack[FILTER_MAX_INSTRUCTIONS];
+    int top = 0;
+
+    for (int i = 0; i < program->count; i++) {
+        const FilterInstruction* instruction = &program->code[i];
+        IdRange range = {NULL, NULL};
+
+        switch (instruction->opcode) {
+            case FOP_COMPARE:
+                if (instruction->field == FILTER_FIELD_ID) {
+                    switch (instruction->comparison) {
+                        case CMP_EQ: range.low = range.high = instruction->text; break;
+                        case CMP_GT: case CMP_GE: range.low = instruction->text; break;
+                        case CMP_LT: case CMP_LE: range.high = instruction->text; break;
+                        default: break;
+                    }
+                }
+                stack[top++] = range;
+                break;
+            case FOP_BETWEEN:
+                if (instruction->field == FILTER_FIELD_ID) {
+                    range.low = instruction->text;
+                    range.high = instruction->highText;
+                }
+                stack[top++] = range;
+                break;
+            case FOP_CONTAINS:
+                stack[top++] = range;
+                break;
+            case FOP_AND:
+                top--;
+                stack[top - 1].low = tighterLow(stack[top - 1].low, stack[top].low);
+                stack[top - 1].high = tighterHigh(stack[top - 1].high, stack[top].high);
+                break;
+            case FOP_OR:
+                top--;
+                stack[top - 1].low = looserLow(stack[top - 1].low, stack[top].low);
+                stack[top - 1].high = looserHigh(stack[top - 1].high, stack[top].high);
+                break;
+            case FOP_NOT:
+                stack[top - 1] = range;
+                break;
+        }
+    }
+
+    program->hasLow = stack[0].low != NULL;
+    program->hasHigh = stack[0].high != NULL;
+    if (program->hasLow) strcpy(program->low, stack[0].low);
+    if (program->hasHigh) strcpy(program->high, stack[0].high);
+}
+
+FilterProgram* compileFilter(const char* text, char* error, size_t errorSize) {
+    FilterProgram* program = (FilterProgram*)trackedMalloc(sizeof(FilterProgram), MEM_SEARCH_RESULTS);
+    if (program == NULL) {
+        snprintf(error, errorSize, "Out of memory");
+        return NULL;
+    }
+    program->count = 0;
+
+    Parser parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.text = text;
+    parser.program = program;
+    parser.error = error;
+    parser.errorSize = errorSize;
+
+    nextToken(&parser);
+    if (parser.token.kind == TOKEN_END && !parser.failed) {
+        parseError(&parser, "Empty filter expression");
+    }
+    parseOr(&parser);
+    if (!parser.failed && parser.token.kind != TOKEN_END) {
+        parseError(&parser, "Unexpected %s at position %d",
+                   describeToken(&parser.token), parser.token.position);
+    }
+
+    if (parser.failed) {
+        trackedFree(program);
+        return NULL;
+    }
+
+    computeIdBounds(program);
+    return program;
+}
+
+/* ---- Evaluation ---- */
+
+static const char* fieldText(const Student* student, FilterField field) {
+    switch (field) {
+        case FILTER_FIELD_ID: return student->id;
+        case FILTER_FIELD_NAME: return student->name;
+        case FILTER_FIELD_COURSE: return student->course;
+        default: return student->grades;
+    }
+}
+
+/**
+ * Order the field of a student against an operand: negative, zero or
+ * positive like strcmp
+ */
+static int compareField(FilterField field, const Student* student, const char* text, int number) {
+    switch (field) {
+        case FILTER_FIELD_AGE: return (student->age > number) - (student->age < number);
+        case FILTER_FIELD_ID: return compareIds(student->id, text);
+        default: return strcmp(fieldText(student, field), text);
+    }
+}
+
+static bool evaluatePredicate(const FilterInstruction* instruction, const Student* student) {
+    FilterField field = (FilterField)instruction->field;
+
+    if (instruction->opcode == FOP_CONTAINS) {
+        if (field == FILTER_FIELD_NAME) {
+            return strstr(student->nameKey, instruction->text) != NULL;
+        }
+        char key[MAX_NAME_LENGTH];
+        foldSearchKey(key, fieldText(student, field), MAX_NAME_LENGTH);
+        return strstr(key, instruction->text) != NULL;
+    }
+
+    int order = compareField(field, student, instruction->text, instruction->number);
+    if (instruction->opcode == FOP_BETWEEN) {
+        return order >= 0 &&
+               compareField(field, student, instruction->highText, instruction->highNumber) <= 0;
+    }
+
+    switch (instruction->comparison) {
+        case CMP_EQ: return order == 0;
+        case CMP_NE: return order != 0;
+        case CMP_LT: return order < 0;
+        case CMP_LE: return order <= 0;
+        case CMP_GT: return order > 0;
+        default: return order >= 0;
+    }
+}
+
+bool filterMatches(const FilterProgram* program, const Student* student) {
+    bool stack[FILTER_MAX_INSTRUCTIONS];
+    int top = 0;
+
+    for (int i = 0; i < program->count; i++) {
+        const FilterInstruction* instruction = &program->code[i];
+        switch (instruction->opcode) {
+            case FOP_AND:
+                top--;
+                stack[top - 1] = stack[top - 1] && stack[top];
+                break;
+            case FOP_OR:
+                top--;
+                stack[top - 1] = stack[top - 1] || stack[top];
+                break;
+            case FOP_NOT:
+                stack[top - 1] = !stack[top - 1];
+                break;
+            default:
+                stack[top++] = evaluatePredicate(instruction, student);
+                break;
+        }
+    }
+    return stack[0];
+}
+
+bool filterIdBounds(const FilterProgram* program, const char** low, const char** high) {
+    *low = program->hasLow ? program->low : NULL;
+    *high = program->hasHigh ? program->high : NULL;
+    return program->hasLow || program->hasHigh;
+}
+
+/**
+ * Append a match to a growing result array
+ */
+static bool appendResult(Student*** results, int* count, int* capacity, Student* student) {
+    if (*count == *capacity) {
+        int newCapacity = *capacity == 0 ? 16 : *capacity * 2;
+        Student** grown = (Student**)trackedRealloc(*results, sizeof(Student*) * (size_t)newCapacity,
+                                                    MEM_SEARCH_RESULTS);
+        if (grown == NULL) {
+            return false;
+        }
+        *results = grown;
+        *capacity = newCapacity;
+    }
+    (*results)[(*count)++] = student;
+    return true;
+}
+
+Student** searchStudentsByFilter(Student* head, const FilterProgram* program, int* count) {
+    STATS_BEGIN(timer);
+
+    Student** results = NULL;
+    int capacity = 0;
+    bool ok = true;
+    *count = 0;
+
+    const char* low;
+    const char* high;
+    const IdIndex* index = getAttachedIdIndex();
+
+    if (index != NULL && filterIdBounds(program, &low, &high)) {
+        // Visit only the ID range every match must fall in
+        const IdIndexNode* node = low != NULL ? idIndexSeek(index, low) : idIndexFirst(index);
+        for (; node != NULL && ok; node = idIndexNext(node)) {
+            Student* student = idIndexStudent(node);
+            if (high != NULL && compareIds(student->id, high) > 0) {
+                break;
+            }
+            if (filterMatches(program, student)) {
+                ok = appendResult(&results, count, &capacity, student);
+            }
+        }
+    } else {
+        for (Student* current = head; current != NULL && ok; current = current->next) {
+            if (!current->deleted && filterMatches(program, current)) {
+                ok = appendResult(&results, count, &capacity, current);
+            }
+        }
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Error: Memory allocation failed for filter results.\n");
+        trackedFree(results);
+        results = NULL;
+        *count = 0;
+    }
+
+    STATS_END(STAT_FILTER, timer);
+    return results;
+}
+
+void freeFilter(FilterProgram* program) {
+    trackedFree(program);
+}
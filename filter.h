@@ -0,0 +1,80 @@
+/**
+ * @file filter.h
+ * @brief Header file containing the student filter expression language
+ *
+ * Filters combine predicates over the student fields, for example
+ *
+ *   course == "Physics" and age between 18 and 21 and name ~ "son"
+ *
+ * Fields are id, name, course, grades (strings) and age (number).
+ * Comparisons are ==, !=, <, <=, >, >= and "between LOW and HIGH"
+ * (inclusive); "~" tests whether a string field contains the text,
+ * ignoring case and accents. Predicates combine with and, or, not and
+ * parentheses. IDs compare in natural order ("S2" before "S10").
+ *
+ * An expression is parsed and type-checked once into a flat postfix
+ * program, which is then evaluated over each record with a small stack
+ * machine. Bounds on id from the top-level "and" chain are pushed down
+ * to the ID index, so only the records in that ID range are evaluated.
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stddef.h>
+#include "student.h"
+
+#define FILTER_MAX_INSTRUCTIONS 64  /* Longest compiled program */
+#define MAX_FILTER_LENGTH 256       /* Longest expression read from the menu */
+
+/* Compiled filter expression */
+typedef struct FilterProgram FilterProgram;
+
+/**
+ * @brief Parse and type-check a filter expression
+ * @param text Expression to compile
+ * @param error Buffer for a message describing why compilation failed
+ * @param errorSize Size of the error buffer
+ * @return Compiled program (free with freeFilter), or NULL on error
+ */
+FilterProgram* compileFilter(const char* text, char* error, size_t errorSize);
+
+/**
+ * @brief Evaluate a compiled filter on one student
+ * @param program Compiled filter
+ * @param student Student to test
+ * @return true if the student matches
+ */
+bool filterMatches(const FilterProgram* program, const Student* student);
+
+/**
+ * @brief Get the range of IDs that every match must fall in
+ * @param program Compiled filter
+ * @param low Set to the lowest possible ID, or NULL if unbounded
+ * @param high Set to the highest possible ID, or NULL if unbounded
+ * @return true if at least one bound is known
+ */
+bool filterIdBounds(const FilterProgram* program, const char** low, const char** high);
+
+/**
+ * @brief Find the students matching a filter
+ *
+ * With an ID index attached and ID bounds in the filter, only the index
+ * range is visited and results come in ID order; otherwise the list is
+ * scanned and results keep list order.
+ *
+ * @param head Pointer to the head of the linked list
+ * @param program Compiled filter
+ * @param count Pointer to store the count of matching students
+ * @return Array of pointers to the matching students (free with
+ *         freeSearchResults), or NULL if none were found
+ */
+Student** searchStudentsByFilter(Student* head, const FilterProgram* program, int* count);
+
+/**
+ * @brief Free a compiled filter
+ * @param program Program to free
+ */
+void freeFilter(FilterProgram* program);
+
+#endif /* FILTER_H */
@@ -0,0 +1,185 @@
+/**
+ * @file fuzzy.c
+ * @brief Implementation of typo-tolerant (approximate) name search
+ */
+
+#include "fuzzy.h"
+#include "memtrack.h"
+#include "stats.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned bigramSlot(unsigned char first, unsigned char second) {
+    return ((unsigned)first * 31u + (unsigned)second) & (FUZZY_BIGRAM_SLOTS - 1);
+}
+
+bool compileFuzzyPattern(FuzzyPattern* pattern, const char* query, int maxDistance) {
+    size_t length = strlen(query);
+
+    if (length == 0 || length > MAX_NAME_LENGTH - 1 ||
+        maxDistance < 0 || maxDistance > MAX_FUZZY_DISTANCE) {
+        return false;
+    }
+
+    memset(pattern, 0, sizeof(FuzzyPattern));
+    pattern->length = (int)length;
+    pattern->maxDistance = maxDistance;
+
+    for (size_t i = 0; i < length; i++) {
+        pattern->peq[(unsigned char)query[i]] |= 1ULL << i;
+    }
+
+    // Count filter (q-gram lemma, q = 2): a substring within k edits of
+    // the query still contains at least (m - 1) - 2k of its bigrams
+    for (size_t i = 0; i + 1 < length; i++) {
+        unsigned slot = bigramSlot((unsigned char)query[i], (unsigned char)query[i + 1]);
+        pattern->bigramPositions[slot] |= 1ULL << i;
+    }
+    pattern->minSharedBigrams = ((int)length - 1) - 2 * maxDistance;
+
+    return true;
+}
+
+/**
+ * Cheap rejection of names that cannot contain a match. Bigram hash
+ * collisions can only add positions, so the filter never drops a match.
+ */
+static bool passesFilters(const FuzzyPattern* pattern, const char* text, size_t textLength) {
+    if ((int)textLength < pattern->length - pattern->maxDistance) {
+        return false;
+    }
+    if (pattern->minSharedBigrams <= 0) {
+        return true;
+    }
+
+    uint64_t shared = 0;
+    for (size_t i = 0; i + 1 < textLength; i++) {
+        shared |= pattern->bigramPositions[bigramSlot((unsigned char)text[i], (unsigned char)text[i + 1])];
+    }
+    return __builtin_popcountll(shared) >= pattern->minSharedBigrams;
+}
+
+int fuzzyMatchDistance(const FuzzyPattern* pattern, const char* text, size_t textLength) {
+    if (!passesFilters(pattern, text, textLength)) {
+        return -1;
+    }
+
+    // Myers' algorithm with the text start left free, so the best score
+    // over all end positions is the distance to the best substring
+    uint64_t highBit = 1ULL << (pattern->length - 1);
+    uint64_t positive = ~0ULL;  // Vertical +1 deltas
+    uint64_t negative = 0;      // Vertical -1 deltas
+    int score = pattern->length;
+    int best = score;
+
+    for (size_t i = 0; i < textLength; i++) {
+        uint64_t equal = pattern->peq[(unsigned char)text[i]];
+        uint64_t xv = equal | negative;
+        uint64_t xh = (((equal & positive) + positive) ^ positive) | equal;
+        uint64_t horizontalPositive = negative | ~(xh | positive);
+        uint64_t horizontalNegative = positive & xh;
+
+        if (horizontalPositive & highBit) {
+            score++;
+        } else if (horizontalNegative & highBit) {
+            score--;
+        }
+
+        horizontalPositive <<= 1;
+        horizontalNegative <<= 1;
+        positive = horizontalNegative | ~(xv | horizontalPositive);
+        negative = horizontalPositive & xv;
+
+        if (score < best) {
+            best = score;
+            if (best == 0) break;
+        }
+    }
+
+    return best <= pattern->maxDistance ? best : -1;
+}
+
+static int compareMatches(const void* a, const void* b) {
+    const FuzzyMatch* first = (const FuzzyMatch*)a;
+    const FuzzyMatch* second = (const FuzzyMatch*)b;
+    return first->distance - second->distance;
+}
+
+void sortFuzzyMatches(FuzzyMatch* matches, int count) {
+    // Distances are 0..MAX_FUZZY_DISTANCE, so a counting pass keeps the
+    // roster order stable, which qsort would not guarantee
+    int buckets[MAX_FUZZY_DISTANCE + 2] = {0};
+    for (int i = 0; i < count; i++) {
+        buckets[matches[i].distance + 1]++;
+    }
+    for (int d = 1; d <= MAX_FUZZY_DISTANCE + 1; d++) {
+        buckets[d] += buckets[d - 1];
+    }
+
+    FuzzyMatch* sorted = (FuzzyMatch*)trackedMalloc(sizeof(FuzzyMatch) * count, MEM_SEARCH_RESULTS);
+    if (sorted == NULL) {
+        // Fall back to an unstable sort rather than leaving results unranked
+        qsort(matches, count, sizeof(FuzzyMatch), compareMatches);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        sorted[buckets[matches[i].distance]++] = matches[i];
+    }
+    memcpy(matches, sorted, sizeof(FuzzyMatch) * count);
+    trackedFree(sorted);
+}
+
+FuzzyMatch* searchStudentsByNameFuzzy(Student* head, const char* name, int maxDistance, int* count) {
+    STATS_BEGIN(timer);
+    FuzzyPattern pattern;
+    char key[MAX_NAME_LENGTH];
+    *count = 0;
+
+    // Typos are counted on the folded keys, so case and accents are free
+    foldSearchKey(key, name, MAX_NAME_LENGTH);
+    if (!compileFuzzyPattern(&pattern, key, maxDistance)) {
+        return NULL;
+    }
+
+    int capacity = 16;
+    FuzzyMatch* matches = (FuzzyMatch*)trackedMalloc(sizeof(FuzzyMatch) * capacity, MEM_SEARCH_RESULTS);
+    if (matches == NULL) {
+        return NULL;
+    }
+
+    for (Student* current = head; current != NULL; current = current->next) {
+        if (current->deleted) continue;
+        int distance = fuzzyMatchDistance(&pattern, current->nameKey, strlen(current->nameKey));
+        if (distance < 0) continue;
+
+        if (*count == capacity) {
+            capacity *= 2;
+            FuzzyMatch* grown = (FuzzyMatch*)trackedRealloc(matches, sizeof(FuzzyMatch) * capacity, MEM_SEARCH_RESULTS);
+            if (grown == NULL) {
+                trackedFree(matches);
+                *count = 0;
+                return NULL;
+            }
+            matches = grown;
+        }
+        matches[*count].student = current;
+        matches[*count].distance = distance;
+        (*count)++;
+    }
+
+    if (*count == 0) {
+        trackedFree(matches);
+        STATS_END(STAT_SEARCH_FUZZY, timer);
+        return NULL;
+    }
+
+    sortFuzzyMatches(matches, *count);
+    STATS_END(STAT_SEARCH_FUZZY, timer);
+    return matches;
+}
+
+void freeFuzzyMatches(FuzzyMatch* matches) {
+    trackedFree(matches);
+}
@@ -0,0 +1,80 @@
+/**
+ * @file fuzzy.h
+ * @brief Header file containing typo-tolerant (approximate) name search
+ *
+ * A query matches a name when some substring of the name is within the
+ * maximum edit distance of the query, so "jonh" finds "John Doe". The
+ * query and names are compared as folded search keys (see foldSearchKey),
+ * and the distance is computed with Myers' bit-parallel algorithm (one machine
+ * word per pattern); names that cannot match are rejected first by a
+ * length check and a bigram counting filter.
+ */
+
+#ifndef FUZZY_H
+#define FUZZY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "student.h"
+
+#define MAX_FUZZY_DISTANCE 2     /* Largest supported edit distance */
+#define FUZZY_BIGRAM_SLOTS 1024  /* Size of the bigram filter table */
+
+/* A query prepared for repeated matching */
+typedef struct {
+    uint64_t peq[256];                      /* Bit mask of query positions per character */
+    uint64_t bigramPositions[FUZZY_BIGRAM_SLOTS]; /* Query bigram positions per bigram hash */
+    int length;                             /* Query length in bytes */
+    int maxDistance;                        /* Largest accepted edit distance */
+    int minSharedBigrams;                   /* Bigrams any match must share with the query */
+} FuzzyPattern;
+
+/* A matching student and its edit distance from the query */
+typedef struct {
+    Student* student;
+    int distance;
+} FuzzyMatch;
+
+/**
+ * @brief Prepare a query for matching
+ * @param pattern Pattern to fill in
+ * @param query Text to search for (1 to MAX_NAME_LENGTH - 1 bytes)
+ * @param maxDistance Largest accepted edit distance (0 to MAX_FUZZY_DISTANCE)
+ * @return true if the pattern was prepared, false if the arguments are out of range
+ */
+bool compileFuzzyPattern(FuzzyPattern* pattern, const char* query, int maxDistance);
+
+/**
+ * @brief Compute the edit distance between the query and the best matching
+ *        substring of a name
+ * @param pattern Prepared query
+ * @param text Name to match against
+ * @param textLength Length of the name in bytes
+ * @return Edit distance, or -1 if it exceeds the pattern's maximum
+ */
+int fuzzyMatchDistance(const FuzzyPattern* pattern, const char* text, size_t textLength);
+
+/**
+ * @brief Search for students whose name approximately contains a query
+ * @param head Pointer to the head of the linked list
+ * @param name Name to search for
+ * @param maxDistance Largest accepted edit distance (0 to MAX_FUZZY_DISTANCE)
+ * @param count Pointer to store the count of matching students
+ * @return Matches ranked by distance (free with freeFuzzyMatches), or NULL if none
+ */
+FuzzyMatch* searchStudentsByNameFuzzy(Student* head, const char* name, int maxDistance, int* count);
+
+/**
+ * @brief Rank matches by distance, keeping roster order among equal distances
+ * @param matches Matches to sort
+ * @param count Number of matches
+ */
+void sortFuzzyMatches(FuzzyMatch* matches, int count);
+
+/**
+ * @brief Free a match array returned by a fuzzy search
+ * @param matches Array to free (the students themselves are not freed)
+ */
+void freeFuzzyMatches(FuzzyMatch* matches);
+
+#endif /* FUZZY_H */
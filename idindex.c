@@ -0,0 +1,312 @@
+/**
+ * @file idindex.c
+ * @brief Implementation of the ordered student ID index (skip list)
+ */
+
+#include "idindex.h"
+#include "memtrack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+
+#define MAX_LEVEL 16   /* Enough for 4^16 students with p = 1/4 */
+
+struct IdIndexNode {
+    Student* student;
+    int level;                       /* Number of forward pointers */
+    struct IdIndexNode* forward[];   /* Next node on each level */
+};
+
+struct IdIndex {
+    IdIndexNode* header;   /* Sentinel holding MAX_LEVEL forward pointers */
+    int level;             /* Highest level currently in use */
+    int count;
+    int duplicates;        /* Students left out because their ID was already indexed */
+    uint64_t random;       /* xorshift state for node levels */
+};
+
+int compareIds(const char* first, const char* second) {
+    const unsigned char* a = (const unsigned char*)first;
+    const unsigned char* b = (const unsigned char*)second;
+
+    while (*a != '\0' && *b != '\0') {
+        if (isdigit(*a) && isdigit(*b)) {
+            // Compare digit runs by value: skip leading zeros, then a
+            // longer run is larger, and equal lengths compare digit-wise
+            while (*a == '0') a++;
+            while (*b == '0') b++;
+            const unsigned char* runA = a;
+            const unsigned char* runB = b;
+            while (isdigit(*a)) a++;
+            while (isdigit(*b)) b++;
+
+            long lengthA = a - runA;
+            long lengthB = b - runB;
+            if (lengthA != lengthB) {
+                return lengthA < lengthB ? -1 : 1;
+            }
+            int digits = memcmp(runA, runB, (size_t)lengthA);
+            if (digits != 0) {
+                return digits;
+            }
+            continue;
+        }
+
+        if (*a != *b) {
+            return *a < *b ? -1 : 1;
+        }
+        a++;
+        b++;
+    }
+
+    if (*a != *b) {
+        return *a < *b ? -1 : 1;
+    }
+    // Equal in natural order; fall back to bytes so the order stays total
+    return strcmp(first, second);
+}
+
+static int randomLevel(IdIndex* index) {
+    // xorshift64, two random bits per level give p = 1/4
+    uint64_t x = index->random;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    index->random = x;
+
+    int level = 1;
+    while (level < MAX_LEVEL && (x & 3) == 0) {
+        level++;
+        x >>= 2;
+    }
+    return level;
+}
+
+static IdIndexNode* createNode(Student* student, int level) {
+    IdIndexNode* node = (IdIndexNode*)trackedMalloc(sizeof(IdIndexNode) + sizeof(IdIndexNode*) * level,
+                                                    MEM_INDEXES);
+    if (node == NULL) {
+        return NULL;
+    }
+    node->student = student;
+    node->level = level;
+    for (int i = 0; i < level; i++) {
+        node->forward[i] = NULL;
+    }
+    return node;
+}
+
+/**
+ * Find the last node below the key on every level
+ */
+static void findPredecessors(const IdIndex* index, const char* id, IdIndexNode** update) {
+    IdIndexNode* current = index->header;
+    for (int i = index->level - 1; i >= 0; i--) {
+        while (current->forward[i] != NULL && compareIds(current->forward[i]->student->id, id) < 0) {
+            current = current->forward[i];
+        }
+        update[i] = current;
+    }
+}
+
+static void linkNode(IdIndex* index, IdIndexNode* node, IdIndexNode** update) {
+    if (node->level > index->level) {
+        for (int i = index->level; i < node->level; i++) {
+            update[i] = index->header;
+        }
+        index->level = node->level;
+    }
+    for (int i = 0; i < node->level; i++) {
+        node->forward[i] = update[i]->forward[i];
+        update[i]->forward[i] = node;
+    }
+    index->count++;
+}
+
+IdIndex* createIdIndex(void) {
+    IdIndex* index = (IdIndex*)trackedMalloc(sizeof(IdIndex), MEM_INDEXES);
+    if (index == NULL) {
+        fprintf(stderr, "Memory allocation failed for ID index\n");
+        return NULL;
+    }
+
+    index->header = createNode(NULL, MAX_LEVEL);
+    if (index->header == NULL) {
+        trackedFree(index);
+        fprintf(stderr, "Memory allocation failed for ID index\n");
+        return NULL;
+    }
+    index->level = 1;
+    index->count = 0;
+    index->duplicates = 0;
+    index->random = 0x9E3779B97F4A7C15ULL;
+    return index;
+}
+
+IdIndex* buildIdIndex(Student* head) {
+    IdIndex* index = createIdIndex();
+    if (index == NULL) {
+        return NULL;
+    }
+
+    // While records arrive in ID order (as saved files are), append them
+    // through the last node of every level instead of searching from the
+    // top; the first out-of-order record switches to regular inserts
+    IdIndexNode* last[MAX_LEVEL];
+    const char* lastId = NULL;
+    bool sorted = true;
+    for (int i = 0; i < MAX_LEVEL; i++) {
+        last[i] = index->header;
+    }
+
+    for (Student* current = head; current != NULL; current = current->next) {
+        if (current->deleted) continue;
+        if (sorted && lastId != NULL && compareIds(current->id, lastId) <= 0) {
+            sorted = false;
+        }
+
+        if (!sorted) {
+            // Duplicates are skipped: lookups keep returning the first one,
+            // and saves fall back to list order so the others are kept
+            if (!idIndexInsert(index, current) && idIndexFind(index, current->id) != NULL) {
+                fprintf(stderr, "Warning: Student ID %s appears more than once; "
+                        "searches by ID find only the first.\n", current->id);
+                index->duplicates++;
+            }
+            continue;
+        }
+
+        IdIndexNode* node = createNode(current, randomLevel(index));
+        if (node == NULL) {
+            freeIdIndex(index);
+            return NULL;
+        }
+        linkNode(index, node, last);
+        for (int i = 0; i < node->level; i++) {
+            last[i] = node;
+        }
+        lastId = current->id;
+    }
+
+    return index;
+}
+
+bool idIndexInsert(IdIndex* index, Student* student) {
+    IdIndexNode* update[MAX_LEVEL];
+    findPredecessors(index, student->id, update);
+
+    IdIndexNode* next = update[0]->forward[0];
+    if (next != NULL && strcmp(next->student->id, student->id) == 0) {
+        return false;
+    }
+
+    IdIndexNode* node = createNode(student, randomLevel(index));
+    if (node == NULL) {
+        return false;
+    }
+    linkNode(index, node, update);
+    return true;
+}
+
+bool idIndexRemove(IdIndex* index, const char* id) {
+    IdIndexNode* update[MAX_LEVEL];
+    findPredecessors(index, id, update);
+
+    IdIndexNode* node = update[0]->forward[0];
+    if (node == NULL || strcmp(node->student->id, id) != 0) {
+        return false;
+    }
+
+    for (int i = 0; i < node->level; i++) {
+        update[i]->forward[i] = node->forward[i];
+    }
+    while (index->level > 1 && index->header->forward[index->level - 1] == NULL) {
+        index->level--;
+    }
+    index->count--;
+    trackedFree(node);
+    return true;
+}
+
+Student* idIndexFind(const IdIndex* index, const char* id) {
+    const IdIndexNode* node = idIndexSeek(index, id);
+    if (node != NULL && strcmp(node->student->id, id) == 0) {
+        return node->student;
+    }
+    return NULL;
+}
+
+int idIndexCount(const IdIndex* index) {
+    return index->count;
+}
+
+int idIndexDuplicates(const IdIndex* index) {
+    return index->duplicates;
+}
+
+const IdIndexNode* idIndexFirst(const IdIndex* index) {
+    return index->header->forward[0];
+}
+
+const IdIndexNode* idIndexSeek(const IdIndex* index, const char* id) {
+    const IdIndexNode* current = index->header;
+    for (int i = index->level - 1; i >= 0; i--) {
+        while (current->forward[i] != NULL && compareIds(current->forward[i]->student->id, id) < 0) {
+            current = current->forward[i];
+        }
+    }
+    return current->forward[0];
+}
+
+const IdIndexNode* idIndexNext(const IdIndexNode* node) {
+    return node->forward[0];
+}
+
+Student* idIndexStudent(const IdIndexNode* node) {
+    return node->student;
+}
+
+Student** idIndexRange(const IdIndex* index, const char* low, const char* high, int* count) {
+    *count = 0;
+
+    // First, count the students in range
+    const IdIndexNode* start = idIndexSeek(index, low);
+    for (const IdIndexNode* node = start; node != NULL; node = node->forward[0]) {
+        if (compareIds(node->student->id, high) > 0) break;
+        (*count)++;
+    }
+
+    if (*count == 0) {
+        return NULL;
+    }
+
+    Student** results = (Student**)trackedMalloc(sizeof(Student*) * (*count), MEM_SEARCH_RESULTS);
+    if (results == NULL) {
+        *count = 0;
+        return NULL;
+    }
+
+    const IdIndexNode* node = start;
+    for (int i = 0; i < *count; i++) {
+        results[i] = node->student;
+        node = node->forward[0];
+    }
+    return results;
+}
+
+void freeIdIndex(IdIndex* index) {
+    if (index == NULL) {
+        return;
+    }
+
+    IdIndexNode* node = index->header->forward[0];
+    while (node != NULL) {
+        IdIndexNode* next = node->forward[0];
+        trackedFree(node);
+        node = next;
+    }
+    trackedFree(index->header);
+    trackedFree(index);
+}
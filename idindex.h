@@ -0,0 +1,132 @@
+/**
+ * @file idindex.h
+ * @brief Header file containing the ordered student ID index
+ *
+ * The index is a skip list keyed by Student.id in natural order
+ * ("S2" sorts before "S10"). It gives O(log n) lookup, insert and
+ * delete, in-order iteration and ID range scans over the students of
+ * the linked list, without changing the list itself.
+ */
+
+#ifndef IDINDEX_H
+#define IDINDEX_H
+
+#include "student.h"
+
+/* Opaque handle for an ID index */
+typedef struct IdIndex IdIndex;
+
+/* Position in an ID index, used for in-order iteration */
+typedef struct IdIndexNode IdIndexNode;
+
+/**
+ * @brief Compare two student IDs in natural order
+ *
+ * Runs of digits are compared by numeric value, so "S999" sorts before
+ * "S1000". IDs that only differ in leading zeros are ordered by strcmp.
+ *
+ * @param first First ID
+ * @param second Second ID
+ * @return Negative, zero or positive like strcmp
+ */
+int compareIds(const char* first, const char* second);
+
+/**
+ * @brief Create an empty ID index
+ * @return New index, or NULL if allocation failed
+ */
+IdIndex* createIdIndex(void);
+
+/**
+ * @brief Build an ID index over every student of a linked list
+ * @param head Pointer to the head of the linked list
+ * @return New index, or NULL if allocation failed
+ */
+IdIndex* buildIdIndex(Student* head);
+
+/**
+ * @brief Insert a student into the index
+ * @param index ID index
+ * @param student Student to insert
+ * @return true if inserted, false if the ID is already indexed or allocation failed
+ */
+bool idIndexInsert(IdIndex* index, Student* student);
+
+/**
+ * @brief Remove a student ID from the index
+ * @param index ID index
+ * @param id ID to remove
+ * @return true if the ID was indexed, false otherwise
+ */
+bool idIndexRemove(IdIndex* index, const char* id);
+
+/**
+ * @brief Find a student by ID
+ * @param index ID index
+ * @param id ID to look up
+ * @return Pointer to the student, or NULL if not found
+ */
+Student* idIndexFind(const IdIndex* index, const char* id);
+
+/**
+ * @brief Get the number of indexed students
+ * @param index ID index
+ * @return Number of students
+ */
+int idIndexCount(const IdIndex* index);
+
+/**
+ * @brief Get the number of students buildIdIndex left out because their
+ *        ID was already indexed
+ * @param index ID index
+ * @return Number of duplicate students not in the index
+ */
+int idIndexDuplicates(const IdIndex* index);
+
+/**
+ * @brief Get the position of the lowest ID
+ * @param index ID index
+ * @return First position, or NULL if the index is empty
+ */
+const IdIndexNode* idIndexFirst(const IdIndex* index);
+
+/**
+ * @brief Get the position of the lowest ID that is not below a key
+ * @param index ID index
+ * @param id Key to seek to
+ * @return Position, or NULL if every ID is below the key
+ */
+const IdIndexNode* idIndexSeek(const IdIndex* index, const char* id);
+
+/**
+ * @brief Advance to the next ID in order
+ * @param node Current position
+ * @return Next position, or NULL at the end
+ */
+const IdIndexNode* idIndexNext(const IdIndexNode* node);
+
+/**
+ * @brief Get the student at a position
+ * @param node Position
+ * @return Student at the position
+ */
+Student* idIndexStudent(const IdIndexNode* node);
+
+/**
+ * @brief Collect the students whose IDs fall in an inclusive range, in ID order
+ * @param index ID index
+ * @param low Lowest ID to include
+ * @param high Highest ID to include
+ * @param count Pointer to store the number of students found
+ * @return Array of pointers to the students (free with freeSearchResults),
+ *         or NULL if none were found
+ */
+Student** idIndexRange(const IdIndex* index, const char* low, const char* high, int* count);
+
+/**
+ * @brief Free an ID index (the indexed students are not freed)
+ * @param index Index to free (NULL is ignored)
+ */
+void freeIdIndex(IdIndex* index);
+
+#endif /* IDINDEX_H */
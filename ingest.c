@@ -0,0 +1,313 @@
+/**
+ * @file ingest.c
+ * @brief Implementation of the streaming ingest pipeline
+ */
+
+#define _GNU_SOURCE  /* For F_SETPIPE_SZ */
+#include "ingest.h"
+#include "fileio.h"
+#include "memtrack.h"
+#include "stats.h"
+#include "txn.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define INGEST_LINE_LENGTH 256   /* Same line limit as loadStudentsFromFile */
+#define SPIN_LIMIT 64            /* Empty polls before yielding */
+#define YIELD_LIMIT 128          /* Polls before sleeping between them */
+#define WAIT_SLEEP_NANOS 100000  /* Sleep between polls of an idle ring */
+#define PROGRESS_NANOS 5000000000ULL  /* Progress line interval on long feeds */
+
+typedef struct {
+    char* data;
+    size_t length;
+} IngestBuffer;
+
+/*
+ * The reader owns head and the parser owns tail; each only reads the
+ * other's position. Slot head % INGEST_RING_SLOTS is filled by the reader
+ * and becomes visible to the parser when head is advanced.
+ */
+typedef struct {
+    IngestBuffer slots[INGEST_RING_SLOTS];
+    unsigned head;          /* Buffers published by the reader */
+    unsigned tail;          /* Buffers released by the parser */
+    bool finished;          /* Set by the reader after its last publish */
+    bool readFailed;
+    int fd;
+    uint64_t bytes;
+    uint64_t readerWaits;
+} IngestRing;
+
+/* Parser state carried from one buffer to the next */
+typedef struct {
+    Student** head;
+    Student* tail;
+    char partial[INGEST_LINE_LENGTH];  /* Start of a line split across buffers */
+    size_t partialLength;
+    bool overlong;                     /* Skipping the rest of a line that is too long */
+    IngestReport* report;
+} IngestParser;
+
+/**
+ * Wait a little longer each time the ring is found full or empty:
+ * spin first, then yield, then sleep so an idle feed costs no CPU
+ */
+static void backoff(int* polls) {
+    if (*polls < SPIN_LIMIT) {
+        // Busy poll
+    } else if (*polls < YIELD_LIMIT) {
+        sched_yield();
+    } else {
+        struct timespec pause = {0, WAIT_SLEEP_NANOS};
+        nanosleep(&pause, NULL);
+    }
+    (*polls)++;
+}
+
+static void* readerThread(void* argument) {
+    IngestRing* ring = (IngestRing*)argument;
+    unsigned head = ring->head;
+
+    for (;;) {
+        // Backpressure: wait for the parser to release a buffer
+        int polls = 0;
+        while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == INGEST_RING_SLOTS) {
+            if (polls == 0) ring->readerWaits++;
+            backoff(&polls);
+        }
+
+        IngestBuffer* buffer = &ring->slots[head % INGEST_RING_SLOTS];
+        ssize_t count;
+        do {
+            count = read(ring->fd, buffer->data, INGEST_BUFFER_SIZE);
+        } while (count < 0 && errno == EINTR);
+
+        if (count <= 0) {
+            if (count < 0) {
+                fprintf(stderr, "Error: Could not read the ingest stream: %s\n", strerror(errno));
+                ring->readFailed = true;
+            }
+            __atomic_store_n(&ring->finished, true, __ATOMIC_RELEASE);
+            return NULL;
+        }
+
+        buffer->length = (size_t)count;
+        __atomic_fetch_add(&ring->bytes, (uint64_t)count, __ATOMIC_RELAXED);
+        head++;
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Apply one complete line: modify the student with its ID, or append it
+ */
+static void applyLine(IngestParser* parser, char* line) {
+    if (line[0] == '\0' || line[0] == '#') {
+        return;
+    }
+
+    Student* record = parseStudentLine(line);
+    if (record == NULL) {
+        parser->report->malformed++;
+        return;
+    }
+
+    if (studentIdExists(*parser->head, record->id)) {
+        updateStudent(*parser->head, record);
+        freeStudent(record);
+        parser->report->updated++;
+    } else {
+        appendStudent(parser->head, &parser->tail, record);
+        parser->report->added++;
+    }
+}
+
+/**
+ * Split a buffer into lines, joining the first one with the partial
+ * line left over from the previous buffer
+ */
+static void parseBuffer(IngestParser* parser, char* data, size_t length) {
+    size_t offset = 0;
+
+    while (offset < length) {
+        char* end = memchr(data + offset, '\n', length - offset);
+        size_t lineLength = (end != NULL ? (size_t)(end - data) : length) - offset;
+
+        if (parser->overlong) {
+            // Drop the remainder of a line longer than the limit
+        } else if (parser->partialLength + lineLength >= INGEST_LINE_LENGTH) {
+            parser->overlong = true;
+        } else if (end != NULL && parser->partialLength == 0) {
+            // Common case: the whole line is in this buffer
+            *end = '\0';
+            applyLine(parser, data + offset);
+        } else {
+            memcpy(parser->partial + parser->partialLength, data + offset, lineLength);
+            parser->partialLength += lineLength;
+            if (end != NULL) {
+                parser->partial[parser->partialLength] = '\0';
+                applyLine(parser, parser->partial);
+                parser->partialLength = 0;
+            }
+        }
+
+        if (end == NULL) {
+            break;
+        }
+        if (parser->overlong) {
+            parser->report->malformed++;
+            parser->overlong = false;
+            parser->partialLength = 0;
+        }
+        offset = (size_t)(end - data) + 1;
+    }
+}
+
+/**
+ * Apply the buffer as one transaction, so the journal gets one write and
+ * one fsync per buffer rather than per line. A failed commit is rolled
+ * back, leaving the list as the journal has it.
+ */
+static bool applyBuffer(IngestParser* parser, IngestBuffer* buffer, const char* journalFile) {
+    STATS_BEGIN(timer);
+    beginTransaction();
+    parseBuffer(parser, buffer->data, buffer->length);
+    bool committed = commitTransaction(journalFile);
+    if (!committed) {
+        rollbackTransaction(parser->head);
+    }
+    STATS_END(STAT_INGEST, timer);
+    return committed;
+}
+
+bool ingestStream(int fd, Student** head, const char* journalFile, IngestReport* report) {
+    memset(report, 0, sizeof(IngestReport));
+
+    if (transactionActive()) {
+        fprintf(stderr, "Error: Can't ingest while a transaction is open.\n");
+        return false;
+    }
+
+    IngestRing ring;
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = fd;
+
+    bool ok = true;
+    for (int i = 0; i < INGEST_RING_SLOTS; i++) {
+        ring.slots[i].data = (char*)trackedMalloc(INGEST_BUFFER_SIZE, MEM_IO_BUFFERS);
+        ok = ok && ring.slots[i].data != NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Memory allocation failed for the ingest ring.\n");
+        for (int i = 0; i < INGEST_RING_SLOTS; i++) trackedFree(ring.slots[i].data);
+        return false;
+    }
+
+#ifdef F_SETPIPE_SZ
+    // Larger pipe buffer so each read can return more data (pipes only)
+    fcntl(fd, F_SETPIPE_SZ, INGEST_BUFFER_SIZE);
+#endif
+
+    IngestParser parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.head = head;
+    parser.report = report;
+    parser.tail = *head;
+    while (parser.tail != NULL && parser.tail->next != NULL) {
+        parser.tail = parser.tail->next;
+    }
+
+    uint64_t start = statsNow();
+    pthread_t reader;
+    if (pthread_create(&reader, NULL, readerThread, &ring) != 0) {
+        fprintf(stderr, "Error: Could not start the ingest reader thread.\n");
+        for (int i = 0; i < INGEST_RING_SLOTS; i++) trackedFree(ring.slots[i].data);
+        return false;
+    }
+
+    // This thread is the parser: consume buffers until the reader is done
+    unsigned tail = 0;
+    int polls = 0;
+    uint64_t lastProgress = start;
+    for (;;) {
+        unsigned published = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);
+        if (tail == published) {
+            // Check finished before re-reading head: a publish that
+            // precedes the final flag is then always seen
+            if (__atomic_load_n(&ring.finished, __ATOMIC_ACQUIRE) &&
+                tail == __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+            if (polls == 0) report->parserWaits++;
+            backoff(&polls);
+            continue;
+        }
+        polls = 0;
+
+        if (ok && !applyBuffer(&parser, &ring.slots[tail % INGEST_RING_SLOTS], journalFile)) {
+            // Keep draining so the reader is never left blocked on a full ring
+            ok = false;
+        }
+        report->buffers++;
+        tail++;
+        __atomic_store_n(&ring.tail, tail, __ATOMIC_RELEASE);
+
+        // Unbounded feeds never reach the final report
+        uint64_t now = statsNow();
+        if (now - lastProgress >= PROGRESS_NANOS) {
+            fprintf(stderr, "Ingest: %llu line(s) applied, %.1f MB/s\n",
+                    (unsigned long long)(report->added + report->updated),
+                    (double)__atomic_load_n(&ring.bytes, __ATOMIC_RELAXED) / 1e6 /
+                    ((double)(now - start) / 1e9));
+            lastProgress = now;
+        }
+    }
+
+    pthread_join(reader, NULL);
+
+    // A final line without a newline still counts
+    if (ok && parser.partialLength > 0 && !parser.overlong) {
+        beginTransaction();
+        parser.partial[parser.partialLength] = '\0';
+        applyLine(&parser, parser.partial);
+        ok = commitTransaction(journalFile);
+        if (!ok) {
+            rollbackTransaction(head);
+        }
+    }
+
+    report->nanos = statsNow() - start;
+    report->bytes = ring.bytes;
+    report->readerWaits = ring.readerWaits;
+    report->ok = ok && !ring.readFailed;
+
+    for (int i = 0; i < INGEST_RING_SLOTS; i++) {
+        trackedFree(ring.slots[i].data);
+    }
+    return report->ok;
+}
+
+void printIngestReport(FILE* out, const IngestReport* report) {
+    double seconds = (double)report->nanos / 1e9;
+    uint64_t lines = report->added + report->updated;
+
+    fprintf(out, "Ingested %llu line(s): %llu added, %llu updated, %llu malformed\n",
+            (unsigned long long)lines, (unsigned long long)report->added,
+            (unsigned long long)report->updated, (unsigned long long)report->malformed);
+    fprintf(out, "Read %llu bytes in %llu buffer(s) over %.2fs", (unsigned long long)report->bytes,
+            (unsigned long long)report->buffers, seconds);
+    if (seconds > 0.0) {
+        fprintf(out, ": %.1f MB/s, %.0f lines/s", (double)report->bytes / 1e6 / seconds,
+                (double)lines / seconds);
+    }
+    fprintf(out, "\nRing full (reader waited): %llu, ring empty (parser waited): %llu\n",
+            (unsigned long long)report->readerWaits, (unsigned long long)report->parserWaits);
+}
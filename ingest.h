@@ -0,0 +1,58 @@
+/**
+ * @file ingest.h
+ * @brief Header file containing the streaming ingest pipeline
+ *
+ * Roster updates arrive as data file lines (id,name,age,course,grades) on
+ * a pipe, a FIFO or any other stream. A reader thread reads the stream
+ * into a fixed ring of large buffers and a parser thread applies the
+ * lines to the list: an existing ID is modified, a new one is appended.
+ * Blank lines and lines starting with '#' are skipped.
+ *
+ * The ring is single-producer/single-consumer and lock-free: each side
+ * only writes its own position and publishes it with release ordering.
+ * When the ring is full the reader stops reading, so a fast producer is
+ * held back by the pipe instead of growing memory. The changes of every
+ * consumed buffer are committed to the journal as one transaction.
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "student.h"
+
+#define INGEST_BUFFER_SIZE (1 << 20)  /* Bytes per ring buffer */
+#define INGEST_RING_SLOTS 4           /* Buffers in the ring (bounds memory) */
+
+/* Counters reported after an ingest run */
+typedef struct {
+    uint64_t bytes;          /* Bytes read from the stream */
+    uint64_t buffers;        /* Ring buffers consumed */
+    uint64_t added;          /* Lines that added a student */
+    uint64_t updated;        /* Lines that modified an existing student */
+    uint64_t malformed;      /* Lines that could not be parsed */
+    uint64_t readerWaits;    /* Times the reader found the ring full */
+    uint64_t parserWaits;    /* Times the parser found the ring empty */
+    uint64_t nanos;          /* Wall time from start to end of stream */
+    bool ok;                 /* false if reading or a journal commit failed */
+} IngestReport;
+
+/**
+ * @brief Apply a stream of student lines to the list until end of stream
+ * @param fd File descriptor to read (a pipe, FIFO or regular file)
+ * @param head Pointer to the head of the linked list (updated in place)
+ * @param journalFile Journal that each consumed buffer is committed to
+ * @param report Filled with the counters of the run
+ * @return true if the whole stream was read and committed
+ */
+bool ingestStream(int fd, Student** head, const char* journalFile, IngestReport* report);
+
+/**
+ * @brief Print the counters and throughput of an ingest run
+ * @param out Stream to print to
+ * @param report Counters of the run
+ */
+void printIngestReport(FILE* out, const IngestReport* report);
+
+#endif /* INGEST_H */
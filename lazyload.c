@@ -0,0 +1,653 @@
+/**
+ * @file lazyload.c
+ * @brief Implementation of the lazy (on-demand) student file reader
+ */
+
+#include "lazyload.h"
+#include "fileio.h"
+#include "stats.h"
+#include "memtrack.h"
+#include "fuzzy.h"
+#include "utils.h"
+#include "idindex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define SCAN_BUFFER_SIZE (1 << 20)  /* Bytes read per chunk while indexing */
+#define LINE_BUFFER_SIZE 256        /* Same line limit as loadStudentsFromFile */
+#define FIELD_SEPARATORS 4          /* Commas in a well-formed record line */
+
+/**
+ * One indexed record. Entries are kept in file order, followed by
+ * students added to the overlay (which have no file offset).
+ */
+typedef struct {
+    char id[ID_LENGTH];  /* Student ID, truncated like the full parser does */
+    long offset;         /* Byte offset of the record's line, or -1 for overlay records */
+    Student* record;     /* Materialized record, NULL until first access */
+    bool deleted;        /* true once deleted through the overlay */
+} LazyEntry;
+
+struct LazyStudentFile {
+    FILE* file;          /* Open data file used to materialize records */
+    LazyEntry* entries;  /* Index entries in file order */
+    int entryCount;
+    int entryCapacity;
+    int* slots;          /* Open-addressing hash table of entry indexes (-1 = empty) */
+    int slotCount;       /* Always a power of two */
+    int liveCount;       /* Entries that are not deleted */
+    bool changed;        /* true once the overlay differs from the file */
+};
+
+static uint32_t hashId(const char* id) {
+    // FNV-1a, good enough for short ID strings
+    uint32_t hash = 2166136261u;
+    while (*id != '\0') {
+        hash ^= (unsigned char)*id++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int findEntry(const LazyStudentFile* file, const char* id) {
+    uint32_t mask = (uint32_t)file->slotCount - 1;
+    uint32_t slot = hashId(id) & mask;
+
+    while (file->slots[slot] != -1) {
+        int index = file->slots[slot];
+        if (strcmp(file->entries[index].id, id) == 0) {
+            return index;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+static bool growSlots(LazyStudentFile* file) {
+    int newCount = file->slotCount * 2;
+    int* newSlots = (int*)trackedMalloc(sizeof(int) * newCount, MEM_INDEXES);
+    if (newSlots == NULL) {
+        return false;
+    }
+    memset(newSlots, -1, sizeof(int) * newCount);
+
+    // Re-insert the first entry for every ID, keeping lookup semantics
+    uint32_t mask = (uint32_t)newCount - 1;
+    for (int i = 0; i < file->slotCount; i++) {
+        int index = file->slots[i];
+        if (index == -1) continue;
+        uint32_t slot = hashId(file->entries[index].id) & mask;
+        while (newSlots[slot] != -1) {
+            slot = (slot + 1) & mask;
+        }
+        newSlots[slot] = index;
+    }
+
+    trackedFree(file->slots);
+    file->slots = newSlots;
+    file->slotCount = newCount;
+    return true;
+}
+
+static bool appendEntry(LazyStudentFile* file, const char* id, long offset, Student* record) {
+    if (file->entryCount == file->entryCapacity) {
+        int newCapacity = file->entryCapacity * 2;
+        LazyEntry* newEntries = (LazyEntry*)trackedRealloc(file->entries, sizeof(LazyEntry) * newCapacity, MEM_INDEXES);
+        if (newEntries == NULL) {
+            return false;
+        }
+        file->entries = newEntries;
+        file->entryCapacity = newCapacity;
+    }
+
+    // Keep the table at most half full so probe sequences stay short
+    if ((file->entryCount + 1) * 2 > file->slotCount && !growSlots(file)) {
+        return false;
+    }
+
+    LazyEntry* entry = &file->entries[file->entryCount];
+    strncpy(entry->id, id, ID_LENGTH - 1);
+    entry->id[ID_LENGTH - 1] = '\0';
+    entry->offset = offset;
+    entry->record = record;
+    entry->deleted = false;
+
+    // Duplicate IDs stay in the entry list but lookups return the first one,
+    // matching searchStudentById on a fully loaded list
+    if (findEntry(file, entry->id) == -1) {
+        uint32_t mask = (uint32_t)file->slotCount - 1;
+        uint32_t slot = hashId(entry->id) & mask;
+        while (file->slots[slot] != -1) {
+            slot = (slot + 1) & mask;
+        }
+        file->slots[slot] = file->entryCount;
+    }
+
+    file->entryCount++;
+    file->liveCount++;
+    return true;
+}
+
+/**
+ * Extract the ID of a record line if the line looks like a full record.
+ * Only the bytes up to the first comma are copied; the rest of the line
+ * is just scanned for field separators.
+ */
+static bool extractLineId(const char* line, size_t length, char* id) {
+    size_t idLength = 0;
+    int separators = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        if (line[i] == ',') {
+            if (separators == 0) idLength = i;
+            separators++;
+        }
+    }
+
+    if (separators < FIELD_SEPARATORS || idLength == 0) {
+        return false;
+    }
+    if (idLength > ID_LENGTH - 1) {
+        idLength = ID_LENGTH - 1;
+    }
+    memcpy(id, line, idLength);
+    id[idLength] = '\0';
+    return true;
+}
+
+static bool buildIndex(LazyStudentFile* file) {
+    char* buffer = (char*)trackedMalloc(SCAN_BUFFER_SIZE, MEM_IO_BUFFERS);
+    if (buffer == NULL) {
+        return false;
+    }
+
+    size_t carried = 0;    // Bytes of an unfinished line kept at the buffer start
+    long bufferStart = 0;  // File offset of buffer[0]
+    bool ok = true;
+    char id[ID_LENGTH];
+
+    while (ok) {
+        size_t bytesRead = fread(buffer + carried, 1, SCAN_BUFFER_SIZE - carried, file->file);
+        size_t available = carried + bytesRead;
+        if (available == 0) break;
+
+        size_t lineStart = 0;
+        char* newline;
+        while ((newline = memchr(buffer + lineStart, '\n', available - lineStart)) != NULL) {
+            size_t lineEnd = (size_t)(newline - buffer);
+            if (extractLineId(buffer + lineStart, lineEnd - lineStart, id)) {
+                ok = appendEntry(file, id, bufferStart + (long)lineStart, NULL);
+                if (!ok) break;
+            }
+            lineStart = lineEnd + 1;
+        }
+        if (!ok) break;
+
+        if (bytesRead == 0) {
+            // Last line without a trailing newline
+            if (lineStart < available && extractLineId(buffer + lineStart, available - lineStart, id)) {
+                ok = appendEntry(file, id, bufferStart + (long)lineStart, NULL);
+            }
+            break;
+        }
+
+        // Move the partial line to the front; a line longer than the whole
+        // buffer cannot be a valid record, so it is dropped
+        carried = available - lineStart;
+        if (carried == SCAN_BUFFER_SIZE) {
+            carried = 0;
+        }
+        memmove(buffer, buffer + lineStart, carried);
+        bufferStart += (long)(available - carried);
+    }
+
+    trackedFree(buffer);
+    return ok;
+}
+
+/**
+ * Parse the record of a file entry. Consecutive entries are read without
+ * seeking, so a pass over entries in order is a sequential file read.
+ */
+static Student* parseEntry(LazyStudentFile* file, const LazyEntry* entry) {
+    char line[LINE_BUFFER_SIZE];
+
+    if (ftell(file->file) != entry->offset &&
+        fseek(file->file, entry->offset, SEEK_SET) != 0) {
+        return NULL;
+    }
+    if (fgets(line, sizeof(line), file->file) == NULL) {
+        return NULL;
+    }
+
+    // A record is only checked when it is first parsed
+    size_t length = strlen(line);
+    RecordStatus status = checkRecordChecksum(line, length);
+    if (status == RECORD_CORRUPT) {
+        fprintf(stderr, "Warning: The record of %s fails its checksum; it was skipped.\n", entry->id);
+        return NULL;
+    }
+    if (status == RECORD_OK) {
+        line[length - (line[length - 1] == '\n' ? 1 : 0) - RECORD_CHECKSUM_LENGTH] = '\0';
+    }
+    return parseStudentLine(line);
+}
+
+/**
+ * Parse the record of a file entry, dropping the entry from the index if
+ * the record is corrupt or unreadable, so every lookup then agrees that
+ * the ID is missing (and it can be added again)
+ */
+static Student* materializeEntry(LazyStudentFile* file, LazyEntry* entry) {
+    Student* student = parseEntry(file, entry);
+    if (student == NULL && !entry->deleted) {
+        entry->deleted = true;
+        file->liveCount--;
+    }
+    return student;
+}
+
+/**
+ * Read the name field of an unmaterialized record, as a folded search
+ * key, without parsing the remaining fields.
+ */
+static bool readEntryNameKey(LazyStudentFile* file, const LazyEntry* entry, char* key) {
+    char line[LINE_BUFFER_SIZE];
+
+    if (ftell(file->file) != entry->offset &&
+        fseek(file->file, entry->offset, SEEK_SET) != 0) {
+        return false;
+    }
+    if (fgets(line, sizeof(line), file->file) == NULL) {
+        return false;
+    }
+
+    char* fieldStart = strchr(line, ',');
+    if (fieldStart == NULL) return false;
+    fieldStart++;
+    char* fieldEnd = strchr(fieldStart, ',');
+    if (fieldEnd == NULL) return false;
+
+    // Apply the same truncation as the full parser
+    size_t length = (size_t)(fieldEnd - fieldStart);
+    if (length > MAX_NAME_LENGTH - 1) {
+        length = MAX_NAME_LENGTH - 1;
+    }
+    fieldStart[length] = '\0';
+    foldSearchKey(key, fieldStart, MAX_NAME_LENGTH);
+    return true;
+}
+
+LazyStudentFile* openStudentsFileLazy(const char* filename) {
+    FILE* handle = fopen(filename, "r");
+    if (handle == NULL) {
+        // File doesn't exist yet, which is okay for first run
+        return NULL;
+    }
+
+    LazyStudentFile* file = (LazyStudentFile*)trackedCalloc(1, sizeof(LazyStudentFile), MEM_INDEXES);
+    if (file == NULL) {
+        fclose(handle);
+        return NULL;
+    }
+    file->file = handle;
+    file->entryCapacity = 1024;
+    file->slotCount = 2048;
+    file->entries = (LazyEntry*)trackedMalloc(sizeof(LazyEntry) * file->entryCapacity, MEM_INDEXES);
+    file->slots = (int*)trackedMalloc(sizeof(int) * file->slotCount, MEM_INDEXES);
+
+    if (file->entries == NULL || file->slots == NULL) {
+        fprintf(stderr, "Memory allocation failed for lazy file index\n");
+        closeStudentsFileLazy(file);
+        return NULL;
+    }
+    memset(file->slots, -1, sizeof(int) * file->slotCount);
+
+    STATS_BEGIN(timer);
+    if (!buildIndex(file)) {
+        fprintf(stderr, "Error: Could not index file %s.\n", filename);
+        closeStudentsFileLazy(file);
+        return NULL;
+    }
+    STATS_END(STAT_LOAD, timer);
+
+    return file;
+}
+
+int lazyStudentCount(const LazyStudentFile* file) {
+    return file->liveCount;
+}
+
+bool lazyStudentIdExists(LazyStudentFile* file, const char* id) {
+    int index = findEntry(file, id);
+    if (index == -1 || file->entries[index].deleted) {
+        return false;
+    }
+
+    // Only a record that passes its checksum counts, as for lazyGetStudent
+    LazyEntry* entry = &file->entries[index];
+    if (entry->record == NULL) {
+        entry->record = materializeEntry(file, entry);
+    }
+    return entry->record != NULL;
+}
+
+Student* lazyGetStudent(LazyStudentFile* file, const char* id) {
+    STATS_BEGIN(timer);
+    Student* student = NULL;
+    int index = findEntry(file, id);
+
+    if (index != -1 && !file->entries[index].deleted) {
+        LazyEntry* entry = &file->entries[index];
+        if (entry->record == NULL) {
+            entry->record = materializeEntry(file, entry);
+        }
+        student = entry->record;
+    }
+
+    STATS_END(STAT_SEARCH_ID, timer);
+    return student;
+}
+
+Student** lazySearchStudentsByName(LazyStudentFile* file, const char* name, int* count) {
+    STATS_BEGIN(timer);
+    char key[MAX_NAME_LENGTH];
+    foldSearchKey(key, name, MAX_NAME_LENGTH);
+    *count = 0;
+
+    int capacity = 16;
+    Student** results = (Student**)trackedMalloc(sizeof(Student*) * capacity, MEM_SEARCH_RESULTS);
+    if (results == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < file->entryCount; i++) {
+        LazyEntry* entry = &file->entries[i];
+        if (entry->deleted) continue;
+
+        if (entry->record == NULL) {
+            char entryKey[MAX_NAME_LENGTH];
+            if (!readEntryNameKey(file, entry, entryKey) || strstr(entryKey, key) == NULL) continue;
+            entry->record = materializeEntry(file, entry);
+            if (entry->record == NULL) continue;
+        } else if (strstr(entry->record->nameKey, key) == NULL) {
+            continue;
+        }
+
+        if (*count == capacity) {
+            capacity *= 2;
+            Student** grown = (Student**)trackedRealloc(results, sizeof(Student*) * capacity, MEM_SEARCH_RESULTS);
+            if (grown == NULL) {
+                freeSearchResults(results);
+                *count = 0;
+                return NULL;
+            }
+            results = grown;
+        }
+        results[(*count)++] = entry->record;
+    }
+
+    STATS_END(STAT_SEARCH_NAME, timer);
+    if (*count == 0) {
+        freeSearchResults(results);
+        return NULL;
+    }
+    return results;
+}
+
+static int compareStudentPointers(const void* a, const void* b) {
+    return compareIds((*(Student* const*)a)->id, (*(Student* const*)b)->id);
+}
+
+Student** lazySearchStudentsByIdRange(LazyStudentFile* file, const char* low,
+                                      const char* high, int* count) {
+    STATS_BEGIN(timer);
+    *count = 0;
+
+    int capacity = 16;
+    Student** results = (Student**)trackedMalloc(sizeof(Student*) * capacity, MEM_SEARCH_RESULTS);
+    if (results == NULL) {
+        return NULL;
+    }
+
+    // The hash index has no order, so scan the compact entries and sort
+    // only the matches
+    for (int i = 0; i < file->entryCount; i++) {
+        LazyEntry* entry = &file->entries[i];
+        if (entry->deleted || compareIds(entry->id, low) < 0 || compareIds(entry->id, high) > 0) {
+            continue;
+        }
+        if (entry->record == NULL) {
+            entry->record = materializeEntry(file, entry);
+            if (entry->record == NULL) continue;
+        }
+
+        if (*count == capacity) {
+            capacity *= 2;
+            Student** grown = (Student**)trackedRealloc(results, sizeof(Student*) * capacity, MEM_SEARCH_RESULTS);
+            if (grown == NULL) {
+                freeSearchResults(results);
+                *count = 0;
+                return NULL;
+            }
+            results = grown;
+        }
+        results[(*count)++] = entry->record;
+    }
+
+    STATS_END(STAT_SEARCH_ID, timer);
+    if (*count == 0) {
+        freeSearchResults(results);
+        return NULL;
+    }
+    qsort(results, (size_t)*count, sizeof(Student*), compareStudentPointers);
+    return results;
+}
+
+FuzzyMatch* lazySearchStudentsByNameFuzzy(LazyStudentFile* file, const char* name,
+                                          int maxDistance, int* count) {
+    STATS_BEGIN(timer);
+    FuzzyPattern pattern;
+    char key[MAX_NAME_LENGTH];
+    *count = 0;
+
+    foldSearchKey(key, name, MAX_NAME_LENGTH);
+    if (!compileFuzzyPattern(&pattern, key, maxDistance)) {
+        return NULL;
+    }
+
+    int capacity = 16;
+    FuzzyMatch* matches = (FuzzyMatch*)trackedMalloc(sizeof(FuzzyMatch) * capacity, MEM_SEARCH_RESULTS);
+    if (matches == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < file->entryCount; i++) {
+        LazyEntry* entry = &file->entries[i];
+        if (entry->deleted) continue;
+
+        char entryKey[MAX_NAME_LENGTH];
+        const char* candidate = entryKey;
+        if (entry->record != NULL) {
+            candidate = entry->record->nameKey;
+        } else if (!readEntryNameKey(file, entry, entryKey)) {
+            continue;
+        }
+
+        int distance = fuzzyMatchDistance(&pattern, candidate, strlen(candidate));
+        if (distance < 0) continue;
+        if (entry->record == NULL) {
+            entry->record = materializeEntry(file, entry);
+            if (entry->record == NULL) continue;
+        }
+
+        if (*count == capacity) {
+            capacity *= 2;
+            FuzzyMatch* grown = (FuzzyMatch*)trackedRealloc(matches, sizeof(FuzzyMatch) * capacity, MEM_SEARCH_RESULTS);
+            if (grown == NULL) {
+                freeFuzzyMatches(matches);
+                *count = 0;
+                return NULL;
+            }
+            matches = grown;
+        }
+        matches[*count].student = entry->record;
+        matches[*count].distance = distance;
+        (*count)++;
+    }
+
+    STATS_END(STAT_SEARCH_FUZZY, timer);
+    if (*count == 0) {
+        freeFuzzyMatches(matches);
+        return NULL;
+    }
+    sortFuzzyMatches(matches, *count);
+    return matches;
+}
+
+Student** lazySearchStudentsByFilter(LazyStudentFile* file, const FilterProgram* program, int* count) {
+    STATS_BEGIN(timer);
+    const char* low;
+    const char* high;
+    filterIdBounds(program, &low, &high);
+    *count = 0;
+
+    int capacity = 16;
+    Student** results = (Student**)trackedMalloc(sizeof(Student*) * capacity, MEM_SEARCH_RESULTS);
+    if (results == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < file->entryCount; i++) {
+        LazyEntry* entry = &file->entries[i];
+        if (entry->deleted ||
+            (low != NULL && compareIds(entry->id, low) < 0) ||
+            (high != NULL && compareIds(entry->id, high) > 0)) {
+            continue;
+        }
+
+        if (entry->record == NULL) {
+            // Test a parsed copy and keep it only if it matches
+            Student* candidate = materializeEntry(file, entry);
+            if (candidate == NULL) continue;
+            if (!filterMatches(program, candidate)) {
+                freeStudent(candidate);
+                continue;
+            }
+            entry->record = candidate;
+        } else if (!filterMatches(program, entry->record)) {
+            continue;
+        }
+
+        if (*count == capacity) {
+            capacity *= 2;
+            Student** grown = (Student**)trackedRealloc(results, sizeof(Student*) * capacity, MEM_SEARCH_RESULTS);
+            if (grown == NULL) {
+                freeSearchResults(results);
+                *count = 0;
+                return NULL;
+            }
+            results = grown;
+        }
+        results[(*count)++] = entry->record;
+    }
+
+    STATS_END(STAT_FILTER, timer);
+    if (*count == 0) {
+        freeSearchResults(results);
+        return NULL;
+    }
+    return results;
+}
+
+bool lazyPutStudent(LazyStudentFile* file, Student* student) {
+    if (lazyStudentIdExists(file, student->id)) {
+        return false;
+    }
+
+    int index = findEntry(file, student->id);
+    if (index != -1) {
+        // Re-adding a deleted ID: keep the original entry so the next
+        // lookup sees the new record
+        LazyEntry* entry = &file->entries[index];
+        entry->record = student;
+        entry->offset = -1;
+        entry->deleted = false;
+        file->liveCount++;
+    } else if (!appendEntry(file, student->id, -1, student)) {
+        return false;
+    }
+
+    file->changed = true;
+    return true;
+}
+
+bool lazyDeleteStudent(LazyStudentFile* file, const char* id) {
+    int index = findEntry(file, id);
+    if (index == -1 || file->entries[index].deleted) {
+        return false;
+    }
+
+    LazyEntry* entry = &file->entries[index];
+    freeStudent(entry->record);
+    entry->record = NULL;
+    entry->deleted = true;
+    file->liveCount--;
+    file->changed = true;
+    return true;
+}
+
+bool lazyHasChanges(const LazyStudentFile* file) {
+    return file->changed;
+}
+
+Student* lazyMaterializeAll(LazyStudentFile* file) {
+    Student* head = NULL;
+    Student* tail = NULL;
+
+    for (int pass = 0; pass < 2; pass++) {
+        // File records first, then students added to the overlay
+        for (int i = 0; i < file->entryCount; i++) {
+            LazyEntry* entry = &file->entries[i];
+            if (entry->deleted || (entry->offset == -1) != (pass == 1)) continue;
+
+            Student* student = entry->record;
+            if (student == NULL) {
+                student = materializeEntry(file, entry);
+                if (student == NULL) continue;
+            }
+            entry->record = NULL;  // Ownership moves to the list
+
+            student->next = NULL;
+            if (tail == NULL) {
+                head = student;
+            } else {
+                tail->next = student;
+            }
+            tail = student;
+        }
+    }
+
+    closeStudentsFileLazy(file);
+    return head;
+}
+
+void closeStudentsFileLazy(LazyStudentFile* file) {
+    if (file == NULL) {
+        return;
+    }
+
+    if (file->entries != NULL) {
+        for (int i = 0; i < file->entryCount; i++) {
+            freeStudent(file->entries[i].record);
+        }
+    }
+    if (file->file != NULL) {
+        fclose(file->file);
+    }
+    trackedFree(file->entries);
+    trackedFree(file->slots);
+    trackedFree(file);
+}
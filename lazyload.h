@@ -0,0 +1,144 @@
+/**
+ * @file lazyload.h
+ * @brief Header file containing the lazy (on-demand) student file reader
+ *
+ * Opening a data file lazily only builds a compact index of student IDs
+ * and the byte offsets of their lines. Full Student records are parsed
+ * on first access and cached; additions and deletions are kept in an
+ * in-memory overlay until the whole roster is materialized.
+ */
+
+#ifndef LAZYLOAD_H
+#define LAZYLOAD_H
+
+#include "student.h"
+#include "fuzzy.h"
+#include "filter.h"
+
+/* Opaque handle for a lazily opened student data file */
+typedef struct LazyStudentFile LazyStudentFile;
+
+/**
+ * @brief Open a student data file and build its ID to offset index
+ * @param filename Name of the file to open
+ * @return Handle for the file, or NULL if the file doesn't exist
+ */
+LazyStudentFile* openStudentsFileLazy(const char* filename);
+
+/**
+ * @brief Get the number of live students (file records plus overlay)
+ * @param file Lazily opened file
+ * @return Number of students
+ */
+int lazyStudentCount(const LazyStudentFile* file);
+
+/**
+ * @brief Check if a student ID exists, parsing only that record (once)
+ *
+ * A record that fails its checksum is dropped from the index, so it
+ * counts as missing here and in lazyGetStudent alike.
+ *
+ * @param file Lazily opened file
+ * @param id ID to check
+ * @return true if ID exists, false otherwise
+ */
+bool lazyStudentIdExists(LazyStudentFile* file, const char* id);
+
+/**
+ * @brief Look up a student by ID, materializing the record on first access
+ * @param file Lazily opened file
+ * @param id ID of the student to look up
+ * @return Pointer to the cached student (owned by the file) or NULL if not found
+ */
+Student* lazyGetStudent(LazyStudentFile* file, const char* id);
+
+/**
+ * @brief Search for students by name, materializing only the matches
+ * @param file Lazily opened file
+ * @param name Name to search for
+ * @param count Pointer to store the count of matching students
+ * @return Array of pointers to matching students (free with freeSearchResults;
+ *         the students themselves stay owned by the file)
+ */
+Student** lazySearchStudentsByName(LazyStudentFile* file, const char* name, int* count);
+
+/**
+ * @brief Find the students whose IDs fall in an inclusive range
+ * @param file Lazily opened file
+ * @param low Lowest ID to include
+ * @param high Highest ID to include
+ * @param count Pointer to store the count of matching students
+ * @return Array of pointers to the students in ID order (free with
+ *         freeSearchResults), or NULL if none were found
+ */
+Student** lazySearchStudentsByIdRange(LazyStudentFile* file, const char* low,
+                                      const char* high, int* count);
+
+/**
+ * @brief Typo-tolerant name search, materializing only the matches
+ * @param file Lazily opened file
+ * @param name Name to search for
+ * @param maxDistance Largest accepted edit distance (0 to MAX_FUZZY_DISTANCE)
+ * @param count Pointer to store the count of matching students
+ * @return Matches ranked by distance (free with freeFuzzyMatches), or NULL if none
+ */
+FuzzyMatch* lazySearchStudentsByNameFuzzy(LazyStudentFile* file, const char* name,
+                                          int maxDistance, int* count);
+
+/**
+ * @brief Find the students matching a compiled filter
+ *
+ * Entries outside the filter's ID bounds are skipped without reading
+ * their lines; other records are parsed to be tested and only the
+ * matches are cached.
+ *
+ * @param file Lazily opened file
+ * @param program Compiled filter
+ * @param count Pointer to store the count of matching students
+ * @return Array of pointers to matching students in file order (free with
+ *         freeSearchResults), or NULL if none were found
+ */
+Student** lazySearchStudentsByFilter(LazyStudentFile* file, const FilterProgram* program, int* count);
+
+/**
+ * @brief Add a new student to the overlay
+ * @param file Lazily opened file
+ * @param student Student to add (ownership passes to the file)
+ * @return true if the student was added, false if the ID already exists
+ */
+bool lazyPutStudent(LazyStudentFile* file, Student* student);
+
+/**
+ * @brief Delete a student through the overlay
+ * @param file Lazily opened file
+ * @param id ID of the student to delete
+ * @return true if the student was found and deleted, false otherwise
+ */
+bool lazyDeleteStudent(LazyStudentFile* file, const char* id);
+
+/**
+ * @brief Check if the overlay holds any additions or deletions
+ * @param file Lazily opened file
+ * @return true if the roster differs from the file on disk
+ */
+bool lazyHasChanges(const LazyStudentFile* file);
+
+/**
+ * @brief Materialize every remaining record and build the full linked list
+ *
+ * Records keep their file order, followed by students added to the overlay.
+ * Cached records are moved into the list rather than copied. The file
+ * handle is closed and freed by this call.
+ *
+ * @param file Lazily opened file
+ * @return Head of the complete linked list
+ */
+Student* lazyMaterializeAll(LazyStudentFile* file);
+
+/**
+ * @brief Close the file and free the index and every cached record
+ * @param file Lazily opened file
+ */
+void closeStudentsFileLazy(LazyStudentFile* file);
+
+#endif /* LAZYLOAD_H */
@@ -12,19 +12,761 @@
 #include <stdbool.h>
 #include "student.h"
 #include "fileio.h"
+#include "lazyload.h"
 #include "ui.h"
 #include "utils.h"
+#include "stats.h"
+#include "batch.h"
+#include "memtrack.h"
+#include "idindex.h"
+#include "autosave.h"
+#include "txn.h"
+#include "shmroster.h"
+#include "filter.h"
+#include "shard.h"
+#include "ingest.h"
+#include "columnar.h"
+#include "asyncio.h"
+#include "reload.h"
+#include "trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#define DATA_FILE "students.dat"
-#define BACKUP_PREFIX "students_backup"
-#define BACKUP_EXT "dat"
+#define IO_BENCH_RUNS 3   /* Timed repetitions per case; the best is reported */
+
+/**
+ * Print the command line options
+ */
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "  --lazy              Index IDs at startup and parse records on demand\n");
+    fprintf(stderr, "  --stats             Record operation latency statistics\n");
+    fprintf(stderr, "  --stats-json FILE   Record statistics and write them as JSON on exit\n");
+    fprintf(stderr, "  --batch FILE        Run batch commands from FILE ('-' for stdin) and exit\n");
+    fprintf(stderr, "  --mem-budget MB     Stop with a report if memory use exceeds MB megabytes\n");
+    fprintf(stderr, "  --autosave SECONDS  Save changes in the background every SECONDS seconds\n");
+    fprintf(stderr, "  --shared            Share one in-memory roster with other local sessions\n");
+    fprintf(stderr, "  --watch             Reconcile with changes other sessions or tools make to the data file\n");
+    fprintf(stderr, "  --filter EXPR       Display the students matching EXPR and exit\n");
+    fprintf(stderr, "  --shards N          Split the data file into N hash-partitioned shards\n");
+    fprintf(stderr, "  --ingest SOURCE     Apply student lines streamed from SOURCE ('-' for stdin), save and exit\n");
+    fprintf(stderr, "  --verify [FILE]     Check the record and file checksums of the data (or FILE) and exit\n");
+    fprintf(stderr, "  --strict            Stop instead of skipping records that fail their checksums\n");
+    fprintf(stderr, "  --io BACKEND        Data file I/O backend: uring (default, falls back when unavailable) or blocking\n");
+    fprintf(stderr, "  --io-bench FILE     Time loading and saving FILE with each I/O backend and exit\n");
+    fprintf(stderr, "  --record TRACE      Record the menu operations of this session to TRACE\n");
+    fprintf(stderr, "  --replay TRACE [FILE]   Replay a recorded session headlessly against the data (or FILE) and time it\n");
+    fprintf(stderr, "  --export-columnar FILE  Write the roster as a columnar analytics file and exit\n");
+    fprintf(stderr, "  --columnar-report FILE  Print column statistics and aggregates of a columnar file and exit\n");
+}
+
+/**
+ * Run one main menu choice against the shared roster
+ * @return true when the program should exit
+ */
+static bool runSharedChoice(SharedRoster* roster, int choice) {
+    Student* copy;
+    
+    switch (choice) {
+        case 1: // Add a new student
+            handleSharedAddStudent(roster);
+            return false;
+            
+        case 2: // Modify student details
+            handleSharedModifyStudent(roster);
+            return false;
+            
+        case 3: // Delete a student
+            handleSharedDeleteStudent(roster);
+            return false;
+            
+        case 4: // Search for a student
+            handleSharedSearchStudent(roster);
+            return false;
+            
+        case 5: // Display a private copy of the roster in ID order
+            clearScreen();
+            printf("╔══════════════════════════════════════════════════╗\n");
+            printf("║               ALL STUDENTS LIST                  ║\n");
+            printf("╚══════════════════════════════════════════════════╝\n\n");
+            
+            copy = sharedCopyList(roster);
+            IdIndex* index = buildIdIndex(copy);
+            int count = displayStudentsInIdOrder(index);
+            printf("\nTotal number of students: %d\n", count);
+            freeIdIndex(index);
+            freeStudentList(copy);
+            waitForEnter();
+            return false;
+            
+        case 6: // Reports and statistics
+            copy = sharedCopyList(roster);
+            handleReports(copy);
+            freeStudentList(copy);
+            return false;
+            
+        case 7: // Save and exit; every session saves the same roster
+            copy = sharedCopyList(roster);
+            if (saveStudentsWithBackup(DATA_FILE, copy, BACKUP_PREFIX, BACKUP_EXT)) {
+                truncateJournal(JOURNAL_FILE);
+            }
+            freeStudentList(copy);
+            return true;
+            
+        default:
+            printf("Invalid choice. Please enter a number between 1 and 7.\n");
+            waitForEnter();
+            return false;
+    }
+}
+
+/**
+ * Run one main menu choice against the full roster, or a lazily opened
+ * file for the choices it serves without materializing
+ * @return true when the program should exit
+ */
+static bool runMenuChoice(int choice, Student** studentList, LazyStudentFile* lazyFile) {
+    switch (choice) {
+        case 1: // Add a new student
+            if (lazyFile != NULL) {
+                handleLazyAddStudent(lazyFile);
+            } else {
+                *studentList = handleAddStudent(*studentList);
+            }
+            break;
+            
+        case 2: // Modify student details
+            handleModifyStudent(*studentList);
+            break;
+            
+        case 3: // Delete a student
+            if (lazyFile != NULL) {
+                handleLazyDeleteStudent(lazyFile);
+            } else {
+                *studentList = handleDeleteStudent(*studentList);
+            }
+            break;
+            
+        case 4: // Search for a student
+            if (lazyFile != NULL) {
+                handleLazySearchStudent(lazyFile);
+            } else {
+                handleSearchStudent(*studentList);
+            }
+            break;
+            
+        case 5: // Display all students
+            clearScreen();
+            printf("╔══════════════════════════════════════════════════╗\n");
+            printf("║               ALL STUDENTS LIST                  ║\n");
+            printf("╚══════════════════════════════════════════════════╝\n\n");
+            
+            int count = displayStudentsInIdOrder(getAttachedIdIndex());
+            printf("\nTotal number of students: %d\n", count);
+            waitForEnter();
+            break;
+            
+        case 6: // Reports and statistics
+            handleReports(*studentList);
+            break;
+            
+        case 7: // Save and exit
+            stopAutosave();
+            if (saveStudentsWithBackup(DATA_FILE, *studentList, BACKUP_PREFIX, BACKUP_EXT)) {
+                truncateJournal(JOURNAL_FILE);
+            }
+            return true;
+            
+        default:
+            printf("Invalid choice. Please enter a number between 1 and 7.\n");
+            waitForEnter();
+    }
+    return false;
+}
+
+/**
+ * Load the roster from its shards when they are on disk, and from the
+ * single data file otherwise (including before its first sharded save)
+ */
+static Student* loadRoster(void) {
+    ShardSet* shards = getAttachedShardSet();
+    if (shards != NULL && doesFileExist(SHARD_MANIFEST)) {
+        return loadShardSet(shards);
+    }
+    return loadStudentsFromFile(DATA_FILE);
+}
+
+/**
+ * Display the students matching a filter expression; lazy mode only
+ * parses the records inside the filter's ID bounds
+ * @return Process exit status
+ */
+static int runFilterQuery(const char* text, bool lazyMode) {
+    char error[128];
+    FilterProgram* program = compileFilter(text, error, sizeof(error));
+    if (program == NULL) {
+        fprintf(stderr, "Invalid filter: %s\n", error);
+        return 1;
+    }
+    
+    int count = 0;
+    Student** results;
+    if (lazyMode && journalIsEmpty(JOURNAL_FILE)) {
+        LazyStudentFile* file = openStudentsFileLazy(DATA_FILE);
+        results = file != NULL ? lazySearchStudentsByFilter(file, program, &count) : NULL;
+        displayStudentArray(results, count);
+        freeSearchResults(results);
+        if (file != NULL) {
+            closeStudentsFileLazy(file);
+        }
+    } else {
+        Student* list = loadRoster();
+        IdIndex* index = buildIdIndex(list);
+        attachIdIndex(index);
+        replayJournal(JOURNAL_FILE, &list);
+        results = searchStudentsByFilter(list, program, &count);
+        displayStudentArray(results, count);
+        freeSearchResults(results);
+        attachIdIndex(NULL);
+        freeIdIndex(index);
+        freeStudentList(list);
+    }
+    printf("Found %d student(s) matching %s.\n", count, text);
+    
+    freeFilter(program);
+    return 0;
+}
+
+/**
+ * Check the checksums of a data file, or of every shard when the roster
+ * is sharded and no file is named
+ * @return Process exit status
+ */
+static int runVerify(const char* filename) {
+    ShardSet* shards = getAttachedShardSet();
+    if (filename == NULL && shards != NULL && doesFileExist(SHARD_MANIFEST)) {
+        return verifyShardSet(shards, stdout) ? 0 : 1;
+    }
+    
+    if (filename == NULL) {
+        filename = DATA_FILE;
+    }
+    if (!doesFileExist(filename)) {
+        fprintf(stderr, "Error: There is no data file %s to verify.\n", filename);
+        return 1;
+    }
+    VerifyReport report;
+    bool intact = verifyStudentsFile(filename, stdout, &report);
+    printVerifyReport(stdout, &report);
+    return intact ? 0 : 1;
+}
+
+/**
+ * Write the roster, with committed journal changes applied, as a columnar file
+ * @return Process exit status
+ */
+static int runColumnarExport(const char* filename) {
+    Student* list = loadRoster();
+    IdIndex* index = buildIdIndex(list);
+    attachIdIndex(index);
+    replayJournal(JOURNAL_FILE, &list);
+    
+    bool ok = exportColumnar(filename, list);
+    if (ok) {
+        printf("Exported %d student(s) to %s.\n", idIndexCount(index), filename);
+    }
+    
+    attachIdIndex(NULL);
+    freeIdIndex(index);
+    freeStudentList(list);
+    return ok ? 0 : 1;
+}
+
+/**
+ * Drop the cached pages of a file so the next read comes from the disk
+ */
+static void evictFromPageCache(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+/**
+ * Time loading FILE with a cold and a warm page cache, and saving it,
+ * with each I/O backend
+ * @return Process exit status
+ */
+static int runIoBenchmark(const char* filename) {
+    struct stat info;
+    if (stat(filename, &info) != 0) {
+        fprintf(stderr, "Error: There is no data file %s to benchmark.\n", filename);
+        return 1;
+    }
+    char saveFile[256];
+    snprintf(saveFile, sizeof(saveFile), "%s.bench", filename);
+    double megabytes = (double)info.st_size / 1e6;
+    
+    printf("I/O benchmark on %s (%.1f MB), best of %d\n", filename, megabytes, IO_BENCH_RUNS);
+    printf("%-10s %20s %20s %20s\n", "Backend", "Cold load", "Warm load", "Save");
+    
+    // Runs alternate between the backends so drift affects both alike
+    IoBackend backends[] = {IO_BACKEND_BLOCKING, IO_BACKEND_URING};
+    ioBackend = IO_BACKEND_URING;
+    int backendCount = asyncIoUsesUring() ? 2 : 1;
+    uint64_t best[2][3];  /* Per backend: cold load, warm load, save */
+    memset(best, 0xff, sizeof(best));
+    bool ok = true;
+    
+    for (int run = 0; run < IO_BENCH_RUNS && ok; run++) {
+        for (int b = 0; b < backendCount && ok; b++) {
+            ioBackend = backends[b];
+            for (int c = 0; c < 2 && ok; c++) {
+                if (c == 0) evictFromPageCache(filename);
+                uint64_t start = statsNow();
+                Student* list = loadStudentsFromFile(filename);
+                uint64_t elapsed = statsNow() - start;
+                if (elapsed < best[b][c]) best[b][c] = elapsed;
+                
+                if (c == 1) {
+                    start = statsNow();
+                    ok = saveStudentsToFile(saveFile, list);
+                    elapsed = statsNow() - start;
+                    if (elapsed < best[b][2]) best[b][2] = elapsed;
+                }
+                freeStudentList(list);
+            }
+        }
+    }
+    
+    for (int b = 0; b < backendCount && ok; b++) {
+        ioBackend = backends[b];
+        printf("%-10s", asyncIoBackendName());
+        for (int c = 0; c < 3; c++) {
+            char cell[32];
+            snprintf(cell, sizeof(cell), "%.1f ms %5.0f MB/s", (double)best[b][c] / 1e6,
+                     megabytes / ((double)best[b][c] / 1e9));
+            printf(" %20s", cell);
+        }
+        printf("\n");
+    }
+    if (backendCount == 1) {
+        printf("%-10s %20s\n", "io_uring", "unavailable");
+    }
+    
+    unlink(saveFile);
+    ioBackend = IO_BACKEND_URING;
+    return ok ? 0 : 1;
+}
+
+/**
+ * Apply a stream of student lines to the roster, then save it
+ * @return Process exit status
+ */
+static int runIngest(const char* source) {
+    int fd = strcmp(source, "-") == 0 ? STDIN_FILENO : open(source, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open ingest source %s.\n", source);
+        return 1;
+    }
+    
+    Student* list = loadRoster();
+    IdIndex* index = buildIdIndex(list);
+    attachIdIndex(index);
+    replayJournal(JOURNAL_FILE, &list);
+    
+    IngestReport report;
+    bool ok = ingestStream(fd, &list, JOURNAL_FILE, &report);
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    printIngestReport(stdout, &report);
+    
+    // Every applied buffer is already journaled; saving folds them into the data file
+    if (ok && saveStudentsWithBackup(DATA_FILE, list, BACKUP_PREFIX, BACKUP_EXT)) {
+        truncateJournal(JOURNAL_FILE);
+    } else {
+        fprintf(stderr, "Committed changes remain in %s and are replayed on the next start.\n",
+                JOURNAL_FILE);
+        ok = false;
+    }
+    
+    attachIdIndex(NULL);
+    freeIdIndex(index);
+    freeStudentList(list);
+    return ok ? 0 : 1;
+}
+
+/**
+ * Replay a recorded session against a data file at full speed, with the
+ * screen output discarded, and report the time of each kind of operation
+ * @param traceFile Trace written by --record
+ * @param dataFile Data file to replay against, or NULL for the usual roster
+ * @return Process exit status
+ */
+static int runReplay(const char* traceFile, const char* dataFile) {
+    SessionTrace* trace = loadSessionTrace(traceFile);
+    if (trace == NULL) {
+        return 1;
+    }
+    
+    // Commits go to a scratch journal and saves to a scratch file, so the
+    // data file and the real journal are left as they are
+    char journal[] = "/tmp/student-replay-XXXXXX";
+    int fd = mkstemp(journal);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not create a scratch journal: %s\n", strerror(errno));
+        freeSessionTrace(trace);
+        return 1;
+    }
+    close(fd);
+    char scratch[sizeof(journal) + 4];
+    snprintf(scratch, sizeof(scratch), "%s.dat", journal);
+    
+    Student* list = dataFile != NULL ? loadStudentsFromFile(dataFile) : loadRoster();
+    IdIndex* index = buildIdIndex(list);
+    attachIdIndex(index);
+    uiJournalFile = journal;
+    uiHeadless = true;
+    
+    // The handlers still format their output; it just isn't shown
+    fflush(stdout);
+    int terminal = dup(STDOUT_FILENO);
+    int discard = open("/dev/null", O_WRONLY);
+    if (terminal >= 0 && discard >= 0) {
+        dup2(discard, STDOUT_FILENO);
+    }
+    if (discard >= 0) {
+        close(discard);
+    }
+    
+    ReplayTimings timings;
+    memset(&timings, 0, sizeof(timings));
+    static char noInput[1];
+    uint64_t start = statsNow();
+    for (size_t i = 0; i < trace->count; i++) {
+        TraceOperation* operation = &trace->operations[i];
+        inputStream = fmemopen(operation->input != NULL ? operation->input : noInput, operation->length, "r");
+        if (inputStream == NULL) {
+            continue;
+        }
+        
+        uint64_t begin = statsNow();
+        if (operation->choice == 7) {
+            // Save and exit writes the roster as the real save does, minus the backup
+            saveStudentsToFileInIdOrder(scratch, list, getAttachedIdIndex());
+        } else {
+            runMenuChoice(operation->choice, &list, NULL);
+        }
+        recordReplayTiming(&timings, operation->choice, statsNow() - begin);
+        
+        fclose(inputStream);
+        inputStream = NULL;
+    }
+    uint64_t total = statsNow() - start;
+    
+    fflush(stdout);
+    if (terminal >= 0) {
+        dup2(terminal, STDOUT_FILENO);
+        close(terminal);
+    }
+    uiHeadless = false;
+    uiJournalFile = JOURNAL_FILE;
+    unlink(journal);
+    unlink(scratch);
+    
+    printf("Replayed %s against %s.\n", traceFile, dataFile != NULL ? dataFile : DATA_FILE);
+    printReplayReport(stdout, &timings, total);
+    if (statsEnabled) {
+        printf("\n");
+        printStats(stdout);
+    }
+    
+    freeReplayTimings(&timings);
+    freeSessionTrace(trace);
+    attachIdIndex(NULL);
+    freeIdIndex(index);
+    freeStudentList(list);
+    return 0;
+}
 
 /**
  * Main function that drives the student management system
  */
-int main() {
-    // Load existing student data from file
-    Student* studentList = loadStudentsFromFile(DATA_FILE);
+int main(int argc, char* argv[]) {
+    bool lazyMode = false;
+    const char* statsJsonFile = NULL;
+    const char* batchFile = NULL;
+    int autosaveSeconds = 0;
+    bool sharedMode = false;
+    const char* filterText = NULL;
+    int shardOption = 0;
+    const char* ingestSource = NULL;
+    bool verifyMode = false;
+    const char* verifyFile = NULL;
+    const char* exportFile = NULL;
+    const char* reportFile = NULL;
+    const char* benchFile = NULL;
+    bool watchMode = false;
+    const char* recordFile = NULL;
+    const char* replayFile = NULL;
+    const char* replayData = NULL;
+    
+    // Parse command line options
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lazy") == 0) {
+            lazyMode = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+            statsJsonFile = argv[++i];
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batchFile = argv[++i];
+        } else if (strcmp(argv[i], "--mem-budget") == 0 && i + 1 < argc) {
+            long megabytes = atol(argv[++i]);
+            if (megabytes <= 0) {
+                fprintf(stderr, "Invalid memory budget: %s\n", argv[i]);
+                return 1;
+            }
+            setMemoryBudget((size_t)megabytes * 1024 * 1024);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filterText = argv[++i];
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shardOption = atoi(argv[++i]);
+            if (shardOption < 1 || shardOption > MAX_SHARDS) {
+                fprintf(stderr, "Invalid shard count: %s (1-%d)\n", argv[i], MAX_SHARDS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--ingest") == 0 && i + 1 < argc) {
+            ingestSource = argv[++i];
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verifyMode = true;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                verifyFile = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--strict") == 0) {
+            strictLoading = true;
+        } else if (strcmp(argv[i], "--io") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "uring") == 0) {
+                ioBackend = IO_BACKEND_URING;
+            } else if (strcmp(argv[i], "blocking") == 0) {
+                ioBackend = IO_BACKEND_BLOCKING;
+            } else {
+                fprintf(stderr, "Invalid I/O backend: %s (uring or blocking)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--io-bench") == 0 && i + 1 < argc) {
+            benchFile = argv[++i];
+        } else if (strcmp(argv[i], "--export-columnar") == 0 && i + 1 < argc) {
+            exportFile = argv[++i];
+        } else if (strcmp(argv[i], "--columnar-report") == 0 && i + 1 < argc) {
+            reportFile = argv[++i];
+        } else if (strcmp(argv[i], "--shared") == 0) {
+            sharedMode = true;
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            watchMode = true;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordFile = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFile = argv[++i];
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                replayData = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--autosave") == 0 && i + 1 < argc) {
+            autosaveSeconds = atoi(argv[++i]);
+            if (autosaveSeconds <= 0) {
+                fprintf(stderr, "Invalid autosave interval: %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (sharedMode && (lazyMode || autosaveSeconds > 0)) {
+        fprintf(stderr, "--shared can't be combined with --lazy or --autosave.\n");
+        return 1;
+    }
+    if (watchMode && (lazyMode || sharedMode)) {
+        fprintf(stderr, "--watch can't be combined with --lazy or --shared.\n");
+        return 1;
+    }
+    if (ingestSource != NULL && (lazyMode || sharedMode)) {
+        fprintf(stderr, "--ingest can't be combined with --lazy or --shared.\n");
+        return 1;
+    }
+    
+    if (benchFile != NULL) {
+        return runIoBenchmark(benchFile);
+    }
+    
+    // The report reads only the columnar file
+    if (reportFile != NULL) {
+        return printColumnarReport(reportFile, stdout) ? 0 : 1;
+    }
+    
+    // A manifest selects the sharded layout; --shards creates one
+    ShardSet* shardSet = openShardSet(SHARD_MANIFEST);
+    if (shardSet == NULL && doesFileExist(SHARD_MANIFEST)) {
+        return 1;
+    }
+    if (shardSet != NULL && shardOption > 0 && shardCount(shardSet) != shardOption) {
+        fprintf(stderr, "The roster is already split into %d shards.\n", shardCount(shardSet));
+        freeShardSet(shardSet);
+        return 1;
+    }
+    if (shardSet == NULL && shardOption > 0) {
+        shardSet = createShardSet(SHARD_MANIFEST, shardOption, DATA_FILE);
+    }
+    if (shardSet != NULL) {
+        if (lazyMode || sharedMode || autosaveSeconds > 0 || watchMode) {
+            fprintf(stderr, "A sharded roster can't be combined with --lazy, --shared, --autosave or --watch.\n");
+            freeShardSet(shardSet);
+            return 1;
+        }
+        attachShardSet(shardSet);
+    }
+    
+    if (verifyMode) {
+        int status = runVerify(verifyFile);
+        attachShardSet(NULL);
+        freeShardSet(shardSet);
+        return status;
+    }
+    
+    // Lazy mode parses records one at a time, so strict mode checks the whole file first
+    if (strictLoading && lazyMode && doesFileExist(DATA_FILE)) {
+        VerifyReport report;
+        if (!verifyStudentsFile(DATA_FILE, stderr, &report)) {
+            fprintf(stderr, "Strict loading: %s failed its integrity check; stopping.\n", DATA_FILE);
+            return 1;
+        }
+    }
+    
+    if (filterText != NULL) {
+        int status = runFilterQuery(filterText, lazyMode);
+        attachShardSet(NULL);
+        freeShardSet(shardSet);
+        if (statsJsonFile != NULL) {
+            writeStatsJson(statsJsonFile);
+        }
+        return status;
+    }
+    
+    if (exportFile != NULL) {
+        int status = runColumnarExport(exportFile);
+        attachShardSet(NULL);
+        freeShardSet(shardSet);
+        if (statsJsonFile != NULL) {
+            writeStatsJson(statsJsonFile);
+        }
+        return status;
+    }
+    
+    if (ingestSource != NULL) {
+        int status = runIngest(ingestSource);
+        attachShardSet(NULL);
+        freeShardSet(shardSet);
+        if (statsJsonFile != NULL) {
+            writeStatsJson(statsJsonFile);
+        }
+        return status;
+    }
+    
+    if (replayFile != NULL) {
+        int status = runReplay(replayFile, replayData);
+        attachShardSet(NULL);
+        freeShardSet(shardSet);
+        if (statsJsonFile != NULL) {
+            writeStatsJson(statsJsonFile);
+        }
+        return status;
+    }
+    
+    // Batch mode runs the commands against a fully loaded list and exits
+    if (batchFile != NULL) {
+        FILE* input = strcmp(batchFile, "-") == 0 ? stdin : fopen(batchFile, "r");
+        if (input == NULL) {
+            fprintf(stderr, "Error: Could not open batch file %s.\n", batchFile);
+            return 1;
+        }
+        
+        Student* batchList = loadRoster();
+        IdIndex* batchIndex = buildIdIndex(batchList);
+        attachIdIndex(batchIndex);
+        replayJournal(JOURNAL_FILE, &batchList);
+        int failures = runBatch(input, &batchList, DATA_FILE);
+        if (input != stdin) {
+            fclose(input);
+        }
+        attachIdIndex(NULL);
+        freeIdIndex(batchIndex);
+        freeStudentList(batchList);
+        attachShardSet(NULL);
+        freeShardSet(shardSet);
+        
+        if (statsJsonFile != NULL) {
+            writeStatsJson(statsJsonFile);
+        }
+        return failures == 0 ? 0 : 1;
+    }
+    
+    Student* studentList = NULL;
+    LazyStudentFile* lazyFile = NULL;
+    SharedRoster* sharedRoster = NULL;
+    
+    // Committed transactions not yet saved can only be replayed on the full roster
+    if (lazyMode && !journalIsEmpty(JOURNAL_FILE)) {
+        printf("The journal %s holds unsaved changes; loading the full roster.\n", JOURNAL_FILE);
+        lazyMode = false;
+    }
+    
+    // Load existing student data from file; lazy mode only indexes IDs and
+    // shared mode attaches to the roster of another session if there is one
+    if (sharedMode) {
+        sharedRoster = openSharedRoster(SHARED_ROSTER_NAME, DATA_FILE);
+        if (sharedRoster == NULL) {
+            return 1;
+        }
+        printf("Attached to shared roster %s (%d students, %d session(s)).\n", SHARED_ROSTER_NAME,
+               sharedStudentCount(sharedRoster), sharedSessionCount(sharedRoster));
+    } else if (lazyMode) {
+        lazyFile = openStudentsFileLazy(DATA_FILE);
+        
+        // With no data file there is nothing to index lazily; the roster
+        // starts empty in the list, indexed like a regular session
+        if (lazyFile == NULL) {
+            attachIdIndex(buildIdIndex(NULL));
+        }
+    } else {
+        studentList = loadRoster();
+        attachIdIndex(buildIdIndex(studentList));
+        
+        // The journal holds changes the file doesn't, so the baseline is taken first
+        if (watchMode && startLiveReload(DATA_FILE, studentList)) {
+            printf("Watching %s for changes made by other sessions.\n", DATA_FILE);
+        }
+        
+        int recovered = replayJournal(JOURNAL_FILE, &studentList);
+        if (recovered > 0) {
+            printf("Recovered %d committed transaction(s) from %s.\n", recovered, JOURNAL_FILE);
+        }
+    }
+    
+    if (autosaveSeconds > 0) {
+        startAutosave(DATA_FILE, autosaveSeconds);
+    }
+    if (recordFile != NULL && startTraceRecording(recordFile)) {
+        printf("Recording this session to %s.\n", recordFile);
+    }
     
     int choice;
     bool exitProgram = false;
@@ -34,72 +776,61 @@ int main() {
         clearScreen();
         displayMainMenu();
         
+        // Snapshots are taken while the menu waits; a lazily opened file
+        // has nothing in the list to snapshot until it is materialized
+        if (lazyFile == NULL) {
+            autosaveWaitForInput(studentList);
+        }
+        
+        // The trace holds each operation with the input its handler read
+        traceEndOperation();
         if (!getIntInput(&choice)) {
-            printf("Invalid input. Please enter a number between 1 and 6.\n");
+            printf("Invalid input. Please enter a number between 1 and 7.\n");
             waitForEnter();
             continue;
         }
+        traceBeginOperation(choice);
         
-        switch (choice) {
-            case 1: // Add a new student
-                studentList = handleAddStudent(studentList);
-                break;
-                
-            case 2: // Modify student details
-                handleModifyStudent(studentList);
-                break;
-                
-            case 3: // Delete a student
-                studentList = handleDeleteStudent(studentList);
-                break;
-                
-            case 4: // Search for a student
-                handleSearchStudent(studentList);
-                break;
-                
-            case 5: // Display all students
-                clearScreen();
-                printf("╔══════════════════════════════════════════════════╗\n");
-                printf("║               ALL STUDENTS LIST                  ║\n");
-                printf("╚══════════════════════════════════════════════════╝\n\n");
-                
-                int count = displayAllStudents(studentList);
-                printf("\nTotal number of students: %d\n", count);
-                waitForEnter();
-                break;
-                
-            case 6: // Save and exit
-                // Create a backup of the existing file if it exists
-                if (doesFileExist(DATA_FILE)) {
-                    char backupFilename[100];
-                    generateBackupFilename(backupFilename, BACKUP_PREFIX, BACKUP_EXT, sizeof(backupFilename));
-                    
-                    // Rename the existing file to the backup name
-                    if (rename(DATA_FILE, backupFilename) == 0) {
-                        printf("Created backup: %s\n", backupFilename);
-                    } else {
-                        fprintf(stderr, "Failed to create backup file.\n");
-                    }
-                }
-                
-                // Save current data
-                if (saveStudentsToFile(DATA_FILE, studentList)) {
-                    printf("Student data saved successfully to %s.\n", DATA_FILE);
-                } else {
-                    fprintf(stderr, "Failed to save student data.\n");
-                }
-                
+        if (sharedRoster != NULL) {
+            exitProgram = runSharedChoice(sharedRoster, choice);
+            continue;
+        }
+        
+        // Bring in what other sessions saved before acting on the roster
+        liveReloadTick(&studentList);
+        
+        // Lazy mode serves adds, deletes and searches from the index; modify,
+        // display, reports and save need the whole roster, so materialize it once
+        if (lazyFile != NULL && choice >= 2 && choice <= 7 && choice != 3 && choice != 4) {
+            if (choice == 7 && !lazyHasChanges(lazyFile)) {
+                closeStudentsFileLazy(lazyFile);
+                lazyFile = NULL;
+                printf("No changes to save.\n");
                 exitProgram = true;
-                break;
-                
-            default:
-                printf("Invalid choice. Please enter a number between 1 and 6.\n");
-                waitForEnter();
+                continue;
+            }
+            studentList = lazyMaterializeAll(lazyFile);
+            lazyFile = NULL;
+            attachIdIndex(buildIdIndex(studentList));
         }
+        
+        exitProgram = runMenuChoice(choice, &studentList, lazyFile);
     }
     
     // Free memory
+    stopTraceRecording();
+    stopLiveReload();
+    closeSharedRoster(sharedRoster);
+    IdIndex* index = getAttachedIdIndex();
+    attachIdIndex(NULL);
+    freeIdIndex(index);
     freeStudentList(studentList);
+    attachShardSet(NULL);
+    freeShardSet(shardSet);
+    
+    if (statsJsonFile != NULL && writeStatsJson(statsJsonFile)) {
+        printf("Statistics written to %s.\n", statsJsonFile);
+    }
     
     printf("\nThank you for using the Student Management System!\n");
     
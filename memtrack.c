@@ -0,0 +1,203 @@
+/**
+ * @file memtrack.c
+ * @brief Implementation of tracked allocation wrappers
+ */
+
+#include "memtrack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#ifdef __GLIBC__
+#include <malloc.h>  /* For malloc_usable_size() */
+#endif
+
+/**
+ * Header stored in front of every tracked block. Its size is a multiple
+ * of 16 so the memory handed out keeps malloc's alignment.
+ */
+typedef union {
+    struct {
+        size_t size;          /* Bytes requested by the caller */
+        size_t overhead;      /* Header plus allocator slack for this block */
+        MemCategory category;
+    } info;
+    max_align_t align;
+} BlockHeader;
+
+typedef struct {
+    size_t liveBytes;
+    size_t peakBytes;
+    size_t liveObjects;
+    size_t peakObjects;
+    size_t overheadBytes;   /* Header and allocator slack of live blocks */
+} CategoryUsage;
+
+static CategoryUsage usage[MEM_CATEGORY_COUNT];
+static size_t totalLive = 0;   /* Requested plus overhead bytes of all categories */
+static size_t totalPeak = 0;
+static size_t budget = 0;
+
+/* Guards the counters; shards are loaded and saved by several threads */
+static pthread_mutex_t accountingLock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* categoryNames[MEM_CATEGORY_COUNT] = {
+    "records", "indexes", "search results", "I/O buffers", "transactions"
+};
+
+static size_t blockOverhead(void* base, size_t size) {
+#ifdef __GLIBC__
+    return malloc_usable_size(base) - size;
+#else
+    (void)base;
+    return sizeof(BlockHeader);
+#endif
+}
+
+/**
+ * Stop the program when an allocation would exceed the budget. Running
+ * out of the budget is treated like running out of memory on a small VM:
+ * report where the memory went and exit before the system starts swapping.
+ */
+static void checkBudget(size_t extraBytes) {
+    if (budget == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&accountingLock);
+    size_t live = totalLive;
+    bool exceeded = live + extraBytes > budget;
+    pthread_mutex_unlock(&accountingLock);
+
+    if (exceeded) {
+        fprintf(stderr, "Error: Memory budget of %zu bytes exceeded (%zu bytes live, %zu requested).\n",
+                budget, live, extraBytes);
+        printMemoryReport(stderr);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void account(const BlockHeader* header) {
+    CategoryUsage* category = &usage[header->info.category];
+    size_t bytes = header->info.size + header->info.overhead;
+
+    pthread_mutex_lock(&accountingLock);
+    category->liveBytes += header->info.size;
+    category->overheadBytes += header->info.overhead;
+    category->liveObjects++;
+    if (category->liveBytes > category->peakBytes) {
+        category->peakBytes = category->liveBytes;
+    }
+    if (category->liveObjects > category->peakObjects) {
+        category->peakObjects = category->liveObjects;
+    }
+
+    totalLive += bytes;
+    if (totalLive > totalPeak) {
+        totalPeak = totalLive;
+    }
+    pthread_mutex_unlock(&accountingLock);
+}
+
+static void unaccount(const BlockHeader* header) {
+    CategoryUsage* category = &usage[header->info.category];
+
+    pthread_mutex_lock(&accountingLock);
+    category->liveBytes -= header->info.size;
+    category->overheadBytes -= header->info.overhead;
+    category->liveObjects--;
+    totalLive -= header->info.size + header->info.overhead;
+    pthread_mutex_unlock(&accountingLock);
+}
+
+void* trackedMalloc(size_t size, MemCategory category) {
+    checkBudget(size + sizeof(BlockHeader));
+
+    BlockHeader* header = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+    if (header == NULL) {
+        return NULL;
+    }
+
+    header->info.size = size;
+    header->info.overhead = blockOverhead(header, size);
+    header->info.category = category;
+    account(header);
+    return header + 1;
+}
+
+void* trackedCalloc(size_t count, size_t size, MemCategory category) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    void* ptr = trackedMalloc(count * size, category);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void* trackedRealloc(void* ptr, size_t size, MemCategory category) {
+    if (ptr == NULL) {
+        return trackedMalloc(size, category);
+    }
+
+    BlockHeader* header = (BlockHeader*)ptr - 1;
+    if (size > header->info.size) {
+        checkBudget(size - header->info.size);
+    }
+
+    BlockHeader saved = *header;
+    BlockHeader* resized = (BlockHeader*)realloc(header, sizeof(BlockHeader) + size);
+    if (resized == NULL) {
+        return NULL;
+    }
+
+    unaccount(&saved);
+    resized->info.size = size;
+    resized->info.overhead = blockOverhead(resized, size);
+    resized->info.category = category;
+    account(resized);
+    return resized + 1;
+}
+
+void trackedFree(void* ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    BlockHeader* header = (BlockHeader*)ptr - 1;
+    unaccount(header);
+    free(header);
+}
+
+void setMemoryBudget(size_t bytes) {
+    budget = bytes;
+}
+
+size_t memoryLiveBytes(void) {
+    pthread_mutex_lock(&accountingLock);
+    size_t live = totalLive;
+    pthread_mutex_unlock(&accountingLock);
+    return live;
+}
+
+void printMemoryReport(FILE* out) {
+    size_t overhead = 0;
+
+    fprintf(out, "%-18s %14s %12s %14s %12s\n", "Category", "Live bytes", "Live objs", "Peak bytes", "Peak objs");
+    for (int i = 0; i < MEM_CATEGORY_COUNT; i++) {
+        fprintf(out, "%-18s %14zu %12zu %14zu %12zu\n", categoryNames[i],
+                usage[i].liveBytes, usage[i].liveObjects,
+                usage[i].peakBytes, usage[i].peakObjects);
+        overhead += usage[i].overheadBytes;
+    }
+    fprintf(out, "%-18s %14zu\n", "allocator overhead", overhead);
+    fprintf(out, "Total live: %zu bytes, peak: %zu bytes", totalLive, totalPeak);
+    if (budget != 0) {
+        fprintf(out, ", budget: %zu bytes", budget);
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,78 @@
+/**
+ * @file memtrack.h
+ * @brief Header file containing tracked allocation wrappers
+ *
+ * Allocations made through these wrappers are accounted by category,
+ * with live and peak bytes and object counts, so the footprint of the
+ * roster can be reported. An optional memory budget makes the program
+ * stop with a report as soon as an allocation would exceed it.
+ */
+
+#ifndef MEMTRACK_H
+#define MEMTRACK_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* What an allocation is used for */
+typedef enum {
+    MEM_RECORDS,         /* Student records */
+    MEM_INDEXES,         /* Lookup structures over the records */
+    MEM_SEARCH_RESULTS,  /* Temporary result arrays returned by searches */
+    MEM_IO_BUFFERS,      /* Buffers used while reading and writing files */
+    MEM_TRANSACTIONS,    /* Undo log of the open transaction */
+    MEM_CATEGORY_COUNT   /* Number of categories */
+} MemCategory;
+
+/**
+ * @brief Allocate memory accounted to a category
+ * @param size Number of bytes to allocate
+ * @param category What the memory is used for
+ * @return Pointer to the memory, or NULL if allocation failed
+ */
+void* trackedMalloc(size_t size, MemCategory category);
+
+/**
+ * @brief Allocate zeroed memory accounted to a category
+ * @param count Number of elements
+ * @param size Size of each element
+ * @param category What the memory is used for
+ * @return Pointer to the memory, or NULL if allocation failed
+ */
+void* trackedCalloc(size_t count, size_t size, MemCategory category);
+
+/**
+ * @brief Resize memory obtained from the tracked allocators
+ * @param ptr Memory to resize (or NULL to allocate)
+ * @param size New size in bytes
+ * @param category What the memory is used for
+ * @return Pointer to the resized memory, or NULL if allocation failed
+ *         (the original memory is left untouched)
+ */
+void* trackedRealloc(void* ptr, size_t size, MemCategory category);
+
+/**
+ * @brief Free memory obtained from the tracked allocators
+ * @param ptr Memory to free (NULL is ignored)
+ */
+void trackedFree(void* ptr);
+
+/**
+ * @brief Set the memory budget enforced by the tracked allocators
+ * @param bytes Maximum live bytes (0 disables the budget)
+ */
+void setMemoryBudget(size_t bytes);
+
+/**
+ * @brief Get the number of live tracked bytes, including allocator overhead
+ * @return Live bytes
+ */
+size_t memoryLiveBytes(void);
+
+/**
+ * @brief Print live and peak usage per category
+ * @param out Stream to print to
+ */
+void printMemoryReport(FILE* out);
+
+#endif /* MEMTRACK_H */
@@ -0,0 +1,566 @@
+/**
+ * @file reload.c
+ * @brief Implementation of live reload of a data file changed on disk
+ */
+
+#include "reload.h"
+#include "fileio.h"
+#include "asyncio.h"
+#include "autosave.h"
+#include "crc32c.h"
+#include "memtrack.h"
+#include "stats.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BASELINE_MIN_CAPACITY 1024  /* Entries in the smallest baseline table, a power of two */
+#define EVENT_BUFFER_SIZE 4096      /* Bytes of inotify events read at a time */
+#define MIN_CHANGES 64              /* First size of the change list */
+
+/* Checksum of a record as the data file last held it; an empty ID marks a free entry */
+typedef struct {
+    char id[ID_LENGTH];
+    bool seen;            /* Found by the scan in progress */
+    uint32_t checksum;
+} BaselineEntry;
+
+/* A record whose checksum in the file differs from the baseline */
+typedef struct {
+    char id[ID_LENGTH];
+    bool inBaseline;      /* The file held the ID when last read */
+    bool inFile;          /* The file holds the ID now */
+    uint32_t oldChecksum;
+    uint32_t newChecksum;
+    size_t text;          /* Offset of the record text in FileScan.text */
+} FileChange;
+
+/* State of one scan of the data file */
+typedef struct {
+    IntegrityCheck check;
+    FileChange* changes;
+    size_t changeCount;
+    size_t changeCapacity;
+    char* text;           /* NUL-terminated record text of the changes */
+    size_t textLength;
+    size_t textCapacity;
+    uint64_t bytes;
+    bool outOfMemory;
+} FileScan;
+
+static bool enabled = false;
+static char dataFile[256];
+static const char* watchedName;  /* Name of the data file within its directory */
+static int watchFd = -1;
+static bool pending = false;     /* An event arrived that has not been reconciled */
+static struct stat synced;       /* Status of the file the baseline matches */
+static bool haveSynced = false;
+
+static BaselineEntry* baseline = NULL;
+static size_t baselineCapacity = 0;
+static size_t baselineCount = 0;
+
+static unsigned long reloadCount = 0;
+static unsigned long refusedCount = 0;
+static unsigned long long appliedCount = 0;
+static unsigned long long conflictCount = 0;
+static uint64_t lastNanos = 0;
+static uint64_t lastBytes = 0;
+static size_t lastChanges = 0;
+
+/**
+ * Checksum of a student's record text, the same as the file stores after it
+ */
+static uint32_t studentChecksum(const Student* student) {
+    char text[STUDENT_FIELDS_LENGTH + 1];
+    int length = formatStudentFields(text, student);
+    return crc32c(0, text, (size_t)length);
+}
+
+static size_t homeSlot(const char* id) {
+    return crc32c(0, id, strlen(id)) & (baselineCapacity - 1);
+}
+
+static BaselineEntry* findEntry(const char* id) {
+    size_t mask = baselineCapacity - 1;
+    for (size_t i = homeSlot(id); baseline[i].id[0] != '\0'; i = (i + 1) & mask) {
+        if (strcmp(baseline[i].id, id) == 0) {
+            return &baseline[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Claim the free entry an ID probes to; the ID must not be in the table
+ */
+static BaselineEntry* claimEntry(const char* id) {
+    size_t mask = baselineCapacity - 1;
+    size_t i = homeSlot(id);
+    while (baseline[i].id[0] != '\0') {
+        i = (i + 1) & mask;
+    }
+    memcpy(baseline[i].id, id, strlen(id) + 1);
+    baselineCount++;
+    return &baseline[i];
+}
+
+static bool resizeBaseline(size_t capacity) {
+    BaselineEntry* table = (BaselineEntry*)trackedCalloc(capacity, sizeof(BaselineEntry), MEM_INDEXES);
+    if (table == NULL) {
+        return false;
+    }
+
+    BaselineEntry* old = baseline;
+    size_t oldCapacity = baselineCapacity;
+    baseline = table;
+    baselineCapacity = capacity;
+    baselineCount = 0;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].id[0] != '\0') {
+            claimEntry(old[i].id)->checksum = old[i].checksum;
+        }
+    }
+    trackedFree(old);
+    return true;
+}
+
+static bool setEntry(const char* id, uint32_t checksum) {
+    BaselineEntry* entry = findEntry(id);
+    if (entry == NULL) {
+        // Keep the table at most three quarters full so probes stay short
+        if ((baselineCount + 1) * 4 > baselineCapacity * 3 && !resizeBaseline(baselineCapacity * 2)) {
+            return false;
+        }
+        entry = claimEntry(id);
+    }
+    entry->checksum = checksum;
+    entry->seen = false;
+    return true;
+}
+
+/**
+ * Free an entry, shifting later entries of its probe run back into the
+ * hole so every remaining ID is still found without tombstones
+ */
+static void removeEntry(BaselineEntry* entry) {
+    size_t mask = baselineCapacity - 1;
+    size_t hole = (size_t)(entry - baseline);
+
+    for (size_t i = (hole + 1) & mask; baseline[i].id[0] != '\0'; i = (i + 1) & mask) {
+        size_t home = homeSlot(baseline[i].id);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            baseline[hole] = baseline[i];
+            hole = i;
+        }
+    }
+    memset(&baseline[hole], 0, sizeof(BaselineEntry));
+    baselineCount--;
+}
+
+/**
+ * Take the roster as what the file holds
+ */
+static bool takeBaseline(const Student* head) {
+    size_t count = 0;
+    for (const Student* current = head; current != NULL; current = current->next) {
+        count += !current->deleted;
+    }
+
+    size_t capacity = BASELINE_MIN_CAPACITY;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    baseline = (BaselineEntry*)trackedCalloc(capacity, sizeof(BaselineEntry), MEM_INDEXES);
+    if (baseline == NULL) {
+        return false;
+    }
+    baselineCapacity = capacity;
+    baselineCount = 0;
+
+    for (const Student* current = head; current != NULL; current = current->next) {
+        if (!current->deleted && !setEntry(current->id, studentChecksum(current))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static FileChange* addChange(FileScan* scan, const char* id) {
+    if (scan->changeCount == scan->changeCapacity) {
+        size_t capacity = scan->changeCapacity == 0 ? MIN_CHANGES : scan->changeCapacity * 2;
+        FileChange* changes = (FileChange*)trackedRealloc(scan->changes, capacity * sizeof(FileChange),
+                                                          MEM_IO_BUFFERS);
+        if (changes == NULL) {
+            scan->outOfMemory = true;
+            return NULL;
+        }
+        scan->changes = changes;
+        scan->changeCapacity = capacity;
+    }
+
+    FileChange* change = &scan->changes[scan->changeCount++];
+    memset(change, 0, sizeof(FileChange));
+    memcpy(change->id, id, strlen(id) + 1);
+    return change;
+}
+
+static bool keepText(FileScan* scan, FileChange* change, const char* text, size_t length) {
+    if (scan->textLength + length + 1 > scan->textCapacity) {
+        size_t capacity = scan->textCapacity == 0 ? RECORD_LINE_LENGTH * MIN_CHANGES : scan->textCapacity;
+        while (scan->textLength + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        char* buffer = (char*)trackedRealloc(scan->text, capacity, MEM_IO_BUFFERS);
+        if (buffer == NULL) {
+            scan->outOfMemory = true;
+            return false;
+        }
+        scan->text = buffer;
+        scan->textCapacity = capacity;
+    }
+
+    change->text = scan->textLength;
+    memcpy(scan->text + scan->textLength, text, length);
+    scan->text[scan->textLength + length] = '\0';
+    scan->textLength += length + 1;
+    return true;
+}
+
+/**
+ * Copy the ID of a record as parseStudentLine would read it: separators
+ * before it are skipped and it is cut to fit
+ */
+static bool recordId(const char* line, size_t payload, char* id) {
+    size_t start = 0;
+    while (start < payload && line[start] == ',') {
+        start++;
+    }
+    size_t length = 0;
+    while (start + length < payload && line[start + length] != ',') {
+        length++;
+    }
+    if (length == 0) {
+        return false;
+    }
+    if (length > ID_LENGTH - 1) {
+        length = ID_LENGTH - 1;
+    }
+    memcpy(id, line + start, length);
+    id[length] = '\0';
+    return true;
+}
+
+/**
+ * Check one line and note it if its checksum differs from the baseline;
+ * unchanged records are not parsed
+ */
+static void scanLine(void* context, char* line, size_t length) {
+    FileScan* scan = (FileScan*)context;
+    size_t payload;
+
+    scan->bytes += length;
+    RecordStatus status = checkDataLine(&scan->check, line, length, &payload);
+    if (status != RECORD_OK && status != RECORD_UNCHECKED) {
+        return;
+    }
+
+    char id[ID_LENGTH];
+    if (!recordId(line, payload, id)) {
+        return;
+    }
+    uint32_t checksum = crc32c(0, line, payload);
+    BaselineEntry* entry = findEntry(id);
+    if (entry != NULL) {
+        entry->seen = true;
+        if (entry->checksum == checksum) {
+            return;
+        }
+    }
+
+    FileChange* change = addChange(scan, id);
+    if (change == NULL) {
+        return;
+    }
+    change->inBaseline = entry != NULL;
+    change->oldChecksum = entry != NULL ? entry->checksum : 0;
+    change->inFile = true;
+    change->newChecksum = checksum;
+    keepText(scan, change, line, payload);
+}
+
+/**
+ * Note the baseline records the scan did not find as deleted from the
+ * file, and clear the seen marks for the next scan
+ */
+static void sweepBaseline(FileScan* scan, bool noteDeleted) {
+    for (size_t i = 0; i < baselineCapacity; i++) {
+        BaselineEntry* entry = &baseline[i];
+        if (entry->id[0] == '\0') {
+            continue;
+        }
+        if (!entry->seen && noteDeleted) {
+            FileChange* change = addChange(scan, entry->id);
+            if (change != NULL) {
+                change->inBaseline = true;
+                change->oldChecksum = entry->checksum;
+            }
+        }
+        entry->seen = false;
+    }
+}
+
+static void reportConflict(const FileChange* change, const char* text, bool inRoster) {
+    if (!change->inFile) {
+        printf("Conflict on %s: %s no longer has this student; kept this session's unsaved change.\n",
+               change->id, dataFile);
+    } else if (!inRoster) {
+        printf("Conflict on %s: kept this session's unsaved deletion; %s holds: %s\n",
+               change->id, dataFile, text);
+    } else {
+        printf("Conflict on %s: kept this session's unsaved change; %s holds: %s\n",
+               change->id, dataFile, text);
+    }
+}
+
+/**
+ * Apply the changes to the roster where it still matches the baseline
+ */
+static void applyChanges(FileScan* scan, Student** head) {
+    int added = 0, updated = 0, removed = 0, conflicts = 0;
+    Student* tail = NULL;
+
+    for (size_t i = 0; i < scan->changeCount; i++) {
+        const FileChange* change = &scan->changes[i];
+        char* text = change->inFile ? scan->text + change->text : NULL;
+        Student* current = searchStudentById(*head, change->id);
+        uint32_t checksum = current != NULL ? studentChecksum(current) : 0;
+
+        // The roster may already hold the new version
+        if ((current != NULL) == change->inFile && (current == NULL || checksum == change->newChecksum)) {
+            continue;
+        }
+
+        // Otherwise it must hold the old one, or this session changed it too
+        bool unchanged = change->inBaseline ? current != NULL && checksum == change->oldChecksum
+                                            : current == NULL;
+        if (!unchanged) {
+            reportConflict(change, text, current != NULL);
+            conflicts++;
+            continue;
+        }
+
+        if (!change->inFile) {
+            removeStudent(head, change->id);
+            removed++;
+            continue;
+        }
+        Student* record = parseStudentLine(text);
+        if (record == NULL) {
+            continue;
+        }
+        if (current != NULL) {
+            updateStudent(*head, record);
+            freeStudent(record);
+            updated++;
+            continue;
+        }
+        if (tail == NULL) {
+            for (tail = *head; tail != NULL && tail->next != NULL; tail = tail->next) {
+            }
+        }
+        appendStudent(head, &tail, record);
+        added++;
+    }
+
+    appliedCount += (unsigned long long)(added + updated + removed);
+    conflictCount += (unsigned long long)conflicts;
+    if (added + updated + removed + conflicts > 0) {
+        printf("%s changed on disk: %d added, %d updated, %d removed, %d conflict(s).\n",
+               dataFile, added, updated, removed, conflicts);
+    }
+}
+
+/**
+ * Make the baseline match the file that was scanned
+ */
+static bool updateBaseline(const FileScan* scan) {
+    for (size_t i = 0; i < scan->changeCount; i++) {
+        const FileChange* change = &scan->changes[i];
+        if (change->inFile) {
+            if (!setEntry(change->id, change->newChecksum)) {
+                return false;
+            }
+        } else {
+            BaselineEntry* entry = findEntry(change->id);
+            if (entry != NULL) {
+                removeEntry(entry);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Scan the file and apply what changed; the file is left pending if it
+ * can't be opened, as while another session's save is renaming it
+ */
+static void reconcile(Student** head) {
+    struct stat info;
+    if (stat(dataFile, &info) != 0) {
+        return;
+    }
+    pending = false;
+    if (haveSynced && info.st_ino == synced.st_ino && info.st_size == synced.st_size &&
+        info.st_mtim.tv_sec == synced.st_mtim.tv_sec && info.st_mtim.tv_nsec == synced.st_mtim.tv_nsec) {
+        return;
+    }
+
+    AsyncReader* reader = openAsyncReader(dataFile);
+    if (reader == NULL) {
+        pending = true;
+        return;
+    }
+
+    // A snapshot written by this session's autosave only moves the baseline
+    bool ownSnapshot = autosaveWroteFile(&info);
+    uint64_t start = statsNow();
+    FileScan scan;
+    memset(&scan, 0, sizeof(scan));
+    beginIntegrityCheck(&scan.check, dataFile, stderr, RELOAD_REPORT_LIMIT);
+    bool read = readDataFileLines(reader, dataFile, scanLine, &scan);
+    closeAsyncReader(reader);
+    endIntegrityCheck(&scan.check);
+
+    // Records left out of a damaged or truncated file must not be taken as deleted
+    const IntegrityCheck* check = &scan.check;
+    bool intact = read && check->corrupt == 0 && (check->hasTrailer ? check->trailerOk : !check->checksummed);
+    sweepBaseline(&scan, intact);
+
+    if (!intact || scan.outOfMemory) {
+        fprintf(stderr, "%s changed on disk but %s; keeping the roster in memory.\n", dataFile,
+                scan.outOfMemory ? "there is not enough memory to compare it" : "it failed its integrity check");
+        refusedCount++;
+    } else {
+        if (!ownSnapshot) {
+            applyChanges(&scan, head);
+        }
+        if (updateBaseline(&scan)) {
+            synced = info;
+            haveSynced = true;
+        } else {
+            fprintf(stderr, "Error: Memory allocation failed while reloading %s.\n", dataFile);
+            haveSynced = false;
+        }
+        reloadCount++;
+        lastChanges = scan.changeCount;
+    }
+
+    trackedFree(scan.changes);
+    trackedFree(scan.text);
+    lastBytes = scan.bytes;
+    lastNanos = statsNow() - start;
+    if (statsEnabled) {
+        statsRecord(STAT_RELOAD, lastNanos);
+    }
+}
+
+/**
+ * Read the events queued on the watch and note whether the data file changed
+ */
+static void readEvents(void) {
+    char buffer[EVENT_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+
+    while ((length = read(watchFd, buffer, sizeof(buffer))) > 0) {
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            const struct inotify_event* event = (const struct inotify_event*)cursor;
+            if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && strcmp(event->name, watchedName) == 0)) {
+                pending = true;
+            }
+            cursor += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+bool startLiveReload(const char* filename, const Student* head) {
+    snprintf(dataFile, sizeof(dataFile), "%s", filename);
+
+    // Saves replace the file by renaming over it, so watch its directory
+    char directory[sizeof(dataFile)];
+    char* slash = strrchr(dataFile, '/');
+    if (slash == NULL) {
+        strcpy(directory, ".");
+        watchedName = dataFile;
+    } else {
+        size_t length = (size_t)(slash - dataFile);
+        memcpy(directory, dataFile, length == 0 ? 1 : length);
+        directory[length == 0 ? 1 : length] = '\0';
+        watchedName = slash + 1;
+    }
+
+    watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd < 0 || inotify_add_watch(watchFd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fprintf(stderr, "Error: Could not watch %s: %s\n", dataFile, strerror(errno));
+        stopLiveReload();
+        return false;
+    }
+    if (!takeBaseline(head)) {
+        fprintf(stderr, "Error: Memory allocation failed while watching %s.\n", dataFile);
+        stopLiveReload();
+        return false;
+    }
+
+    haveSynced = stat(dataFile, &synced) == 0;
+    pending = false;
+    enabled = true;
+    return true;
+}
+
+bool liveReloadEnabled(void) {
+    return enabled;
+}
+
+void liveReloadTick(Student** head) {
+    if (!enabled) {
+        return;
+    }
+
+    readEvents();
+    if (pending) {
+        reconcile(head);
+    }
+}
+
+void stopLiveReload(void) {
+    if (watchFd >= 0) {
+        close(watchFd);
+        watchFd = -1;
+    }
+    trackedFree(baseline);
+    baseline = NULL;
+    baselineCapacity = 0;
+    baselineCount = 0;
+    enabled = false;
+}
+
+void printLiveReloadReport(FILE* out) {
+    if (!enabled) {
+        fprintf(out, "Live reload is disabled (start with --watch to enable it).\n");
+        return;
+    }
+
+    fprintf(out, "Watching:            %s (%zu records in the baseline)\n", dataFile, baselineCount);
+    fprintf(out, "Reloads:             %lu (%lu not applied)\n", reloadCount, refusedCount);
+    fprintf(out, "Records applied:     %llu\n", appliedCount);
+    fprintf(out, "Conflicts:           %llu (this session's changes kept)\n", conflictCount);
+    if (reloadCount + refusedCount > 0) {
+        fprintf(out, "Last reload:         %zu changed record(s), %llu bytes scanned in %.1fms\n",
+                lastChanges, (unsigned long long)lastBytes, (double)lastNanos / 1e6);
+    }
+    fprintf(out, "Change pending:      %s\n", pending ? "yes" : "no");
+}
@@ -0,0 +1,73 @@
+/**
+ * @file reload.h
+ * @brief Header file containing live reload of a data file changed on disk
+ *
+ * The directory of the data file is watched with inotify. When another
+ * session or tool replaces or rewrites the file, the next menu command
+ * first reconciles the roster with it instead of working on a stale copy
+ * (and saving over the other writer's changes on exit).
+ *
+ * Reconciling is a three-way comparison by student ID of checksums of
+ * the record text: the baseline (what the file held when last read),
+ * the file now and the roster in memory. Checksummed records carry
+ * theirs, so the file is scanned without parsing; only records whose
+ * checksum differs from the baseline are parsed and applied. For each
+ * changed record:
+ *
+ *   roster equals the baseline     the change on disk is applied
+ *   roster equals the file         nothing to do
+ *   roster differs from both       conflict with an unsaved change of
+ *                                  this session, which is kept and reported
+ *
+ * A file that fails its integrity check (corrupt records, or a trailer
+ * that is missing or wrong, as after a partial write) is not applied.
+ */
+
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#include <stdio.h>
+#include "student.h"
+
+#define RELOAD_REPORT_LIMIT 10  /* Problems printed individually per reconcile */
+
+/**
+ * @brief Start watching a data file
+ *
+ * The roster counts as what the file holds, so call this after loading
+ * and before replaying the journal, whose changes are then unsaved ones.
+ *
+ * @param filename Data file to watch
+ * @param head Head of the roster loaded from it
+ * @return true if the file is watched
+ */
+bool startLiveReload(const char* filename, const Student* head);
+
+/**
+ * @brief Check if live reload has been started
+ * @return true if startLiveReload succeeded
+ */
+bool liveReloadEnabled(void);
+
+/**
+ * @brief Reconcile the roster with the data file if it changed on disk
+ *
+ * Does nothing unless an inotify event for the file has arrived, so it is
+ * cheap to call before every command.
+ *
+ * @param head Pointer to the head of the linked list (updated in place)
+ */
+void liveReloadTick(Student** head);
+
+/**
+ * @brief Stop watching and free the baseline
+ */
+void stopLiveReload(void);
+
+/**
+ * @brief Print the reconcile count, changes applied, conflicts and timing
+ * @param out Stream to print to
+ */
+void printLiveReloadReport(FILE* out);
+
+#endif /* RELOAD_H */
@@ -0,0 +1,106 @@
+/**
+ * @file schema.h
+ * @brief Header file containing the student record schema
+ *
+ * The stored fields of a student are listed once, in STUDENT_FIELDS, in
+ * data file order. The Student members, parsing and formatting data file
+ * records, comparing and copying students, and the display layouts are
+ * all expanded from this list at compile time. Each expansion is
+ * straight-line code with the field sizes as constants, so there is no
+ * per-field dispatch at run time.
+ *
+ * Adding a field is one more line here. createStudent and modifyStudent
+ * take the field values as separate parameters, so their callers (the
+ * menu prompts and the batch modify command) are extended by hand.
+ */
+
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * X(member, KIND, size, label, width)
+ *   member  Student member, also the data file column
+ *   KIND    TEXT (NUL-terminated char array) or INT
+ *   size    Array size of a TEXT field including the NUL; 0 for INT
+ *   label   Heading used by the display routines
+ *   width   Column width in the student table
+ */
+#define STUDENT_FIELDS(X)                              \
+    X(id,     TEXT, ID_LENGTH,         "ID",     7)    \
+    X(name,   TEXT, MAX_NAME_LENGTH,   "Name",   25)   \
+    X(age,    INT,  0,                 "Age",    3)    \
+    X(course, TEXT, MAX_COURSE_LENGTH, "Course", 19)   \
+    X(grades, TEXT, MAX_GRADES_LENGTH, "Grades", 11)
+
+#define SCHEMA_INT_DIGITS 11  /* Longest int as text: "-2147483648" */
+
+/* Number of fields */
+#define SCHEMA_COUNT_ONE(...) + 1
+#define STUDENT_FIELD_COUNT (0 STUDENT_FIELDS(SCHEMA_COUNT_ONE))
+
+/* Longest text of all fields joined by commas, without a terminator */
+#define SCHEMA_TEXT_LENGTH(member, kind, size, label, width) + SCHEMA_LENGTH_##kind(size)
+#define SCHEMA_LENGTH_TEXT(size) ((size) - 1)
+#define SCHEMA_LENGTH_INT(size) SCHEMA_INT_DIGITS
+#define STUDENT_FIELDS_LENGTH (0 STUDENT_FIELDS(SCHEMA_TEXT_LENGTH) + STUDENT_FIELD_COUNT - 1)
+
+/* Member declarations, for STUDENT_FIELDS(SCHEMA_MEMBER) inside a struct */
+#define SCHEMA_MEMBER(member, kind, size, label, width) SCHEMA_MEMBER_##kind(member, size)
+#define SCHEMA_MEMBER_TEXT(member, size) char member[size];
+#define SCHEMA_MEMBER_INT(member, size) int member;
+
+/* printf conversion of each kind */
+#define SCHEMA_SPEC_TEXT "s"
+#define SCHEMA_SPEC_INT "d"
+
+/* Column widths, for STUDENT_FIELDS(SCHEMA_WIDTH) inside an initializer */
+#define SCHEMA_WIDTH(member, kind, size, label, width) width,
+
+/**
+ * Copy text into a fixed-size field, truncating it to size - 1 bytes
+ */
+static inline void schemaSetText(char* field, const char* value, size_t size) {
+    size_t length = strnlen(value, size - 1);
+    memcpy(field, value, length);
+    field[length] = '\0';
+}
+
+static inline char* schemaAppendText(char* out, const char* field, size_t size) {
+    size_t length = strnlen(field, size - 1);
+    memcpy(out, field, length);
+    return out + length;
+}
+
+static inline char* schemaAppendInt(char* out, int value) {
+    char digits[SCHEMA_INT_DIGITS];
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) {
+        *out++ = '-';
+    }
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+/* Per-kind operations; field arguments are members, so sizeof is a constant */
+#define SCHEMA_SET_TEXT(field, value) schemaSetText((field), (value), sizeof(field))
+#define SCHEMA_SET_INT(field, value) ((field) = (value))
+#define SCHEMA_PARSE_TEXT(field, token) SCHEMA_SET_TEXT(field, token)
+#define SCHEMA_PARSE_INT(field, token) ((field) = atoi(token))
+#define SCHEMA_APPEND_TEXT(out, field) ((out) = schemaAppendText((out), (field), sizeof(field)))
+#define SCHEMA_APPEND_INT(out, field) ((out) = schemaAppendInt((out), (field)))
+#define SCHEMA_COPY_TEXT(to, from) memcpy((to), (from), sizeof(to))
+#define SCHEMA_COPY_INT(to, from) ((to) = (from))
+#define SCHEMA_COMPARE_TEXT(first, second) strcmp((first), (second))
+#define SCHEMA_COMPARE_INT(first, second) (((first) > (second)) - ((first) < (second)))
+
+#endif /* SCHEMA_H */
@@ -0,0 +1,617 @@
+/**
+ * @file shard.c
+ * @brief Implementation of the hash-sharded data file layout
+ */
+
+#include "shard.h"
+#include "crc32c.h"
+#include "fileio.h"
+#include "idindex.h"
+#include "memtrack.h"
+#include "stats.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SHARD_NAME_LENGTH 64
+#define SHARD_LINE_LENGTH 256
+#define SHARD_REPORT_LIMIT 10   /* Problems printed individually per shard */
+
+typedef struct {
+    char filename[SHARD_NAME_LENGTH];
+    int records;          /* Records in the file, per the manifest */
+    uint64_t checksum;    /* Checksum of the file contents, per the manifest */
+    bool dirty;           /* Holds changes not yet written */
+    bool failed;          /* Failed verification on load; never overwritten */
+} Shard;
+
+struct ShardSet {
+    char manifest[SHARD_NAME_LENGTH];
+    char legacyFile[SHARD_NAME_LENGTH];  /* Single data file to retire on first save */
+    int count;
+    bool fnvChecksums;    /* Manifest predates CRC32C and holds FNV-1a checksums */
+    Shard shards[MAX_SHARDS];
+};
+
+/* Result of one shard load or save, filled by a worker thread */
+typedef struct {
+    Student* head;
+    Student* tail;
+    const Student** students; /* Save: the shard's students in write order */
+    int records;
+    uint64_t checksum;    /* CRC32C of the whole file */
+    bool ok;
+    IntegrityCheck check; /* Load: per-record verification */
+    char filename[SHARD_NAME_LENGTH]; /* Save: file the shard was written to */
+} ShardWork;
+
+typedef struct {
+    ShardSet* set;
+    ShardWork* work;
+    int next;             /* Next shard to claim, taken atomically */
+} ShardJob;
+
+/* Checksum of manifests written before CRC32C; still accepted on load */
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t fnvChecksum(uint64_t hash, const char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+int shardOf(const ShardSet* set, const char* id) {
+    uint32_t hash = 2166136261u;
+    for (const char* p = id; *p != '\0'; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 16777619u;
+    }
+    return (int)(hash % (uint32_t)set->count);
+}
+
+static void shardFilename(char* buffer, int shard) {
+    snprintf(buffer, SHARD_NAME_LENGTH, SHARD_FILE_FORMAT, shard);
+}
+
+/**
+ * Pick the file a save writes a shard to: its usual name if nothing is
+ * there yet, otherwise whichever of the usual and alternate names the
+ * manifest does not list now, so the listed file stays intact until the
+ * new manifest replaces it
+ */
+static void nextShardFilename(char* buffer, const Shard* shard, int number) {
+    if (!doesFileExist(shard->filename)) {
+        snprintf(buffer, SHARD_NAME_LENGTH, "%s", shard->filename);
+        return;
+    }
+    shardFilename(buffer, number);
+    if (strcmp(buffer, shard->filename) == 0) {
+        snprintf(buffer, SHARD_NAME_LENGTH, SHARD_ALTERNATE_FORMAT, number);
+    }
+}
+
+ShardSet* createShardSet(const char* manifest, int count, const char* legacyFile) {
+    if (count < 1 || count > MAX_SHARDS) {
+        fprintf(stderr, "Error: Shard count must be between 1 and %d.\n", MAX_SHARDS);
+        return NULL;
+    }
+
+    ShardSet* set = (ShardSet*)trackedCalloc(1, sizeof(ShardSet), MEM_INDEXES);
+    if (set == NULL) {
+        return NULL;
+    }
+    snprintf(set->manifest, sizeof(set->manifest), "%s", manifest);
+    snprintf(set->legacyFile, sizeof(set->legacyFile), "%s", legacyFile);
+    set->count = count;
+    for (int i = 0; i < count; i++) {
+        shardFilename(set->shards[i].filename, i);
+        set->shards[i].dirty = true;
+    }
+    return set;
+}
+
+ShardSet* openShardSet(const char* manifest) {
+    FILE* file = fopen(manifest, "r");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    ShardSet* set = (ShardSet*)trackedCalloc(1, sizeof(ShardSet), MEM_INDEXES);
+    if (set == NULL) {
+        fclose(file);
+        return NULL;
+    }
+    snprintf(set->manifest, sizeof(set->manifest), "%s", manifest);
+
+    char line[SHARD_LINE_LENGTH];
+    int listed = 0;
+    bool ok = true;
+    bool sawChecksum = false;
+
+    while (ok && fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (strncmp(line, "shards ", 7) == 0) {
+            set->count = atoi(line + 7);
+            ok = set->count >= 1 && set->count <= MAX_SHARDS;
+            continue;
+        }
+        if (strncmp(line, "checksum ", 9) == 0) {
+            ok = strcmp(line + 9, "crc32c\n") == 0;
+            sawChecksum = true;
+            continue;
+        }
+
+        int index;
+        int records;
+        unsigned long long checksum;
+        char filename[SHARD_NAME_LENGTH];
+        if (set->count == 0 ||
+            sscanf(line, "%d,%63[^,],%d,%llx", &index, filename, &records, &checksum) != 4 ||
+            index < 0 || index >= set->count || strchr(filename, '/') != NULL) {
+            ok = false;
+            break;
+        }
+        Shard* shard = &set->shards[index];
+        strcpy(shard->filename, filename);
+        shard->records = records;
+        shard->checksum = checksum;
+        listed++;
+    }
+    fclose(file);
+    set->fnvChecksums = !sawChecksum;
+
+    if (!ok || set->count == 0 || listed != set->count) {
+        fprintf(stderr, "Error: Shard manifest %s is malformed.\n", manifest);
+        trackedFree(set);
+        return NULL;
+    }
+    return set;
+}
+
+int shardCount(const ShardSet* set) {
+    return set->count;
+}
+
+void shardMarkDirty(ShardSet* set, const char* id) {
+    set->shards[shardOf(set, id)].dirty = true;
+}
+
+int shardDirtyCount(const ShardSet* set) {
+    int dirty = 0;
+    for (int i = 0; i < set->count; i++) {
+        if (set->shards[i].dirty) dirty++;
+    }
+    return dirty;
+}
+
+/**
+ * Run a worker function over every shard, with at most one thread per CPU
+ */
+static void runShardWorkers(ShardJob* job, void* (*worker)(void*)) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 && cpus < job->set->count ? (int)cpus : job->set->count;
+    pthread_t ids[MAX_SHARDS];
+    int started = 0;
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&ids[i], NULL, worker, job) != 0) {
+            break;
+        }
+        started++;
+    }
+    // Without any thread, do the work on the calling thread
+    if (started == 0) {
+        worker(job);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+}
+
+static int claimShard(ShardJob* job) {
+    return __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Read a whole shard file, check it against the manifest and parse it.
+ * A shard failing the manifest checksum still yields the records that
+ * pass their own checksums, but it is not marked ok.
+ */
+static void loadShard(const ShardSet* set, const Shard* shard, int number, ShardWork* work) {
+    work->ok = false;
+
+    FILE* file = fopen(shard->filename, "r");
+    if (file == NULL) {
+        // A shard that never held a record may not have been written
+        work->ok = shard->records == 0;
+        if (!work->ok) {
+            fprintf(stderr, "Error: Shard %d file %s is missing.\n", number, shard->filename);
+        }
+        return;
+    }
+
+    struct stat info;
+    char* buffer = NULL;
+    size_t length = 0;
+    if (fstat(fileno(file), &info) == 0) {
+        length = (size_t)info.st_size;
+        buffer = (char*)trackedMalloc(length + 1, MEM_IO_BUFFERS);
+    }
+    if (buffer == NULL || fread(buffer, 1, length, file) != length) {
+        fprintf(stderr, "Error: Could not read shard %d file %s.\n", number, shard->filename);
+        trackedFree(buffer);
+        fclose(file);
+        return;
+    }
+    fclose(file);
+    buffer[length] = '\0';
+
+    // The checksum is kept as CRC32C even when an older manifest is checked with FNV-1a
+    work->checksum = crc32c(0, buffer, length);
+    bool matches = set->fnvChecksums ? fnvChecksum(FNV_OFFSET_BASIS, buffer, length) == shard->checksum
+                                     : work->checksum == shard->checksum;
+
+    beginIntegrityCheck(&work->check, shard->filename, stderr, SHARD_REPORT_LIMIT);
+    char* line = buffer;
+    while (*line != '\0') {
+        char* end = strchr(line, '\n');
+        size_t lineLength = end != NULL ? (size_t)(end - line) + 1 : strlen(line);
+        size_t payload;
+
+        RecordStatus status = checkDataLine(&work->check, line, lineLength, &payload);
+        if (status == RECORD_OK || status == RECORD_UNCHECKED) {
+            line[payload] = '\0';
+            Student* student = parseStudentLine(line);
+            if (student != NULL) {
+                if (work->tail == NULL) {
+                    work->head = student;
+                } else {
+                    work->tail->next = student;
+                }
+                work->tail = student;
+                work->records++;
+            }
+        }
+
+        if (end == NULL) break;
+        line = end + 1;
+    }
+    endIntegrityCheck(&work->check);
+    trackedFree(buffer);
+
+    if (!matches && !work->check.checksummed) {
+        // Without record checksums nothing in the file can be trusted
+        fprintf(stderr, "Error: Shard %d file %s fails its checksum; it was not loaded.\n",
+                number, shard->filename);
+        freeStudentList(work->head);
+        work->head = NULL;
+        work->tail = NULL;
+        work->records = 0;
+        return;
+    }
+    if (!matches) {
+        fprintf(stderr, "Error: Shard %d file %s fails its checksum; its %d verified record(s) "
+                        "were loaded but it will not be overwritten.\n",
+                number, shard->filename, work->records);
+        return;
+    }
+    work->ok = true;
+}
+
+static void* loadWorker(void* argument) {
+    ShardJob* job = (ShardJob*)argument;
+    int shard;
+    while ((shard = claimShard(job)) < job->set->count) {
+        loadShard(job->set, &job->set->shards[shard], shard, &job->work[shard]);
+    }
+    return NULL;
+}
+
+Student* loadShardSet(ShardSet* set) {
+    STATS_BEGIN(timer);
+    ShardWork* work = (ShardWork*)trackedCalloc((size_t)set->count, sizeof(ShardWork), MEM_IO_BUFFERS);
+    if (work == NULL) {
+        return NULL;
+    }
+
+    ShardJob job = {set, work, 0};
+    runShardWorkers(&job, loadWorker);
+
+    // Chain the shard lists together in shard order
+    Student* head = NULL;
+    Student* tail = NULL;
+    for (int i = 0; i < set->count; i++) {
+        set->shards[i].failed = !work[i].ok;
+        if (work[i].ok) {
+            set->shards[i].checksum = work[i].checksum;
+        }
+        if (set->shards[i].failed && strictLoading) {
+            fprintf(stderr, "Strict loading: shard %d (%s) failed its integrity check; stopping.\n",
+                    i, set->shards[i].filename);
+            exit(EXIT_FAILURE);
+        }
+        enforceStrictLoading(&work[i].check);
+        if (work[i].head == NULL) continue;
+        if (tail == NULL) {
+            head = work[i].head;
+        } else {
+            tail->next = work[i].head;
+        }
+        tail = work[i].tail;
+    }
+
+    // Every checksum in the manifest is CRC32C once it is rewritten
+    set->fnvChecksums = false;
+
+    trackedFree(work);
+    STATS_END(STAT_LOAD, timer);
+    return head;
+}
+
+/**
+ * Write the shard's students and trailer to a file the manifest does not
+ * list yet, computing the checksum of what is written, and sync it
+ */
+static void saveShard(const Shard* shard, int number, ShardWork* work) {
+    work->ok = false;
+    nextShardFilename(work->filename, shard, number);
+
+    FILE* file = fopen(work->filename, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not open file %s for writing.\n", work->filename);
+        return;
+    }
+
+    uint32_t checksum = 0;
+    char line[SHARD_LINE_LENGTH];
+    bool written = true;
+    for (int i = 0; i < work->records && written; i++) {
+        int length = formatStudentRecord(line, sizeof(line), work->students[i]);
+        checksum = crc32c(checksum, line, (size_t)length);
+        written = fwrite(line, 1, (size_t)length, file) == (size_t)length;
+    }
+
+    // The manifest checksum covers the trailer as well
+    int length = formatFileTrailer(line, sizeof(line), checksum, (uint64_t)work->records);
+    checksum = crc32c(checksum, line, (size_t)length);
+    written = written && fwrite(line, 1, (size_t)length, file) == (size_t)length;
+
+    // The new manifest may only list the file once its contents are durable
+    written = written && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if ((fclose(file) != 0) | !written) {
+        fprintf(stderr, "Error: Could not write shard %d file %s.\n", number, work->filename);
+        unlink(work->filename);
+        return;
+    }
+    work->checksum = checksum;
+    work->ok = true;
+}
+
+static void* saveWorker(void* argument) {
+    ShardJob* job = (ShardJob*)argument;
+    int shard;
+    while ((shard = claimShard(job)) < job->set->count) {
+        const Shard* target = &job->set->shards[shard];
+        if (target->dirty && !target->failed) {
+            saveShard(target, shard, &job->work[shard]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Replace the manifest through a synced temporary file, so a crash leaves
+ * either the old or the new manifest
+ */
+static bool writeManifest(const ShardSet* set) {
+    char temporary[SHARD_NAME_LENGTH + 8];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", set->manifest);
+
+    FILE* file = fopen(temporary, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not open file %s for writing.\n", temporary);
+        return false;
+    }
+    fprintf(file, "# Student data shard manifest\nshards %d\nchecksum crc32c\n", set->count);
+    for (int i = 0; i < set->count; i++) {
+        const Shard* shard = &set->shards[i];
+        fprintf(file, "%d,%s,%d,%016llx\n", i, shard->filename, shard->records,
+                (unsigned long long)shard->checksum);
+    }
+    bool written = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if ((fclose(file) != 0) | !written || rename(temporary, set->manifest) != 0) {
+        fprintf(stderr, "Error: Could not write shard manifest %s.\n", set->manifest);
+        unlink(temporary);
+        return false;
+    }
+    return true;
+}
+
+static void assignStudent(const ShardSet* set, ShardWork* work, const Student* student, bool fill) {
+    int shard = shardOf(set, student->id);
+    if (!set->shards[shard].dirty) {
+        return;
+    }
+    if (fill) {
+        work[shard].students[work[shard].records] = student;
+    }
+    work[shard].records++;
+}
+
+/**
+ * Hand each dirty shard the students it owns, in ID order when an index
+ * without duplicates is attached. The first pass counts them and the second fills the arrays.
+ */
+static bool partitionStudents(const ShardSet* set, const Student* head, ShardWork* work) {
+    IdIndex* index = getAttachedIdIndex();
+    if (index != NULL && idIndexDuplicates(index) > 0) {
+        index = NULL;   /* It left out duplicate IDs, so take every record in list order */
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        bool fill = pass == 1;
+        if (fill) {
+            for (int i = 0; i < set->count; i++) {
+                if (work[i].records > 0) {
+                    work[i].students = (const Student**)trackedMalloc(
+                        sizeof(Student*) * (size_t)work[i].records, MEM_IO_BUFFERS);
+                    if (work[i].students == NULL) {
+                        return false;
+                    }
+                }
+                work[i].records = 0;
+            }
+        }
+
+        if (index != NULL) {
+            for (const IdIndexNode* node = idIndexFirst(index); node != NULL; node = idIndexNext(node)) {
+                assignStudent(set, work, idIndexStudent(node), fill);
+            }
+        } else {
+            for (const Student* current = head; current != NULL; current = current->next) {
+                if (current->deleted) continue;
+                assignStudent(set, work, current, fill);
+            }
+        }
+    }
+    return true;
+}
+
+bool saveShardSet(ShardSet* set, const Student* head) {
+    bool ok = true;
+
+    for (int i = 0; i < set->count; i++) {
+        if (set->shards[i].dirty && set->shards[i].failed) {
+            fprintf(stderr, "Error: Shard %d (%s) failed verification when loaded; its changes "
+                            "were not saved. Restore it from a backup first.\n",
+                    i, set->shards[i].filename);
+            ok = false;
+        }
+    }
+    if (shardDirtyCount(set) == 0) {
+        printf("No shard has changes to save.\n");
+        return ok;
+    }
+
+    STATS_BEGIN(timer);
+    ShardWork* work = (ShardWork*)trackedCalloc((size_t)set->count, sizeof(ShardWork), MEM_IO_BUFFERS);
+    if (work == NULL || !partitionStudents(set, head, work)) {
+        fprintf(stderr, "Error: Memory allocation failed for shard save.\n");
+        if (work != NULL) {
+            for (int i = 0; i < set->count; i++) trackedFree((void*)work[i].students);
+        }
+        trackedFree(work);
+        return false;
+    }
+
+    ShardJob job = {set, work, 0};
+    runShardWorkers(&job, saveWorker);
+
+    // Point the manifest at the new files; the previous entries are kept
+    // in case the manifest can't be replaced
+    Shard previous[MAX_SHARDS];
+    memcpy(previous, set->shards, sizeof(previous));
+    int written = 0;
+    int unwritten = 0;
+    for (int i = 0; i < set->count; i++) {
+        Shard* shard = &set->shards[i];
+        if (shard->dirty && !shard->failed) {
+            if (work[i].ok) {
+                strcpy(shard->filename, work[i].filename);
+                shard->records = work[i].records;
+                shard->checksum = work[i].checksum;
+                shard->dirty = false;
+                written++;
+            } else {
+                unwritten++;
+                ok = false;
+            }
+        }
+        trackedFree((void*)work[i].students);
+    }
+
+    // Replacing the manifest commits the new shard files all at once, and
+    // only when every changed shard is on disk; on a first save a shard
+    // that failed would otherwise be listed without a file
+    if (written > 0 && (unwritten > 0 || !writeManifest(set))) {
+        // nextShardFilename never reuses a file that exists, so each one
+        // written here is new
+        for (int i = 0; i < set->count; i++) {
+            if (work[i].ok) {
+                unlink(work[i].filename);
+            }
+        }
+        memcpy(set->shards, previous, sizeof(previous));
+        written = 0;
+        ok = false;
+    }
+
+    // Files the manifest no longer lists become the backups
+    for (int i = 0; i < set->count && written > 0; i++) {
+        const char* old = previous[i].filename;
+        if (work[i].ok && strcmp(work[i].filename, old) != 0 && doesFileExist(old)) {
+            char prefix[SHARD_NAME_LENGTH];
+            char backup[100];
+            snprintf(prefix, sizeof(prefix), "%s_shard%02d", BACKUP_PREFIX, i);
+            generateBackupFilename(backup, prefix, BACKUP_EXT, sizeof(backup));
+            if (rename(old, backup) == 0) {
+                printf("Created backup: %s\n", backup);
+            }
+        }
+    }
+    trackedFree(work);
+
+    // The single data file is superseded once every shard is on disk
+    if (ok && set->legacyFile[0] != '\0' && doesFileExist(set->legacyFile)) {
+        char backupFilename[100];
+        generateBackupFilename(backupFilename, BACKUP_PREFIX, BACKUP_EXT, sizeof(backupFilename));
+        if (rename(set->legacyFile, backupFilename) == 0) {
+            printf("Created backup: %s\n", backupFilename);
+        }
+        set->legacyFile[0] = '\0';
+    }
+
+    STATS_END(STAT_SAVE, timer);
+    printf("Saved %d of %d shard(s) to %s.\n", written, set->count, set->manifest);
+    return ok;
+}
+
+bool verifyShardSet(const ShardSet* set, FILE* out) {
+    bool ok = true;
+
+    for (int i = 0; i < set->count; i++) {
+        const Shard* shard = &set->shards[i];
+        if (!doesFileExist(shard->filename)) {
+            if (shard->records > 0) {
+                fprintf(out, "%s: missing, but the manifest lists %d record(s)\n",
+                        shard->filename, shard->records);
+                ok = false;
+            }
+            continue;
+        }
+
+        VerifyReport report;
+        if (!verifyStudentsFile(shard->filename, out, &report)) {
+            ok = false;
+        }
+        printVerifyReport(out, &report);
+        if (!set->fnvChecksums && report.wholeChecksum != shard->checksum) {
+            fprintf(out, "%s: does not match its manifest checksum\n", shard->filename);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void freeShardSet(ShardSet* set) {
+    trackedFree(set);
+}
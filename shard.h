@@ -0,0 +1,131 @@
+/**
+ * @file shard.h
+ * @brief Header file containing the hash-sharded data file layout
+ *
+ * A sharded roster is split over several data files, each owning the
+ * students whose ID hashes to it. A manifest lists the shard files with
+ * their record counts and checksums:
+ *
+ *   # Student data shard manifest
+ *   shards 4
+ *   checksum crc32c
+ *   0,students.00.dat,250112,000000009f3c2a61
+ *   ...
+ *
+ * Shards are loaded and verified in parallel, one worker thread per CPU.
+ * A shard whose checksum does not match is reported and never overwritten,
+ * so corruption stays confined to that file; only its records that pass
+ * their own checksums are loaded. Manifests without a checksum line hold
+ * FNV-1a checksums from before CRC32C and are still verified. Saves
+ * rewrite only the shards holding changed students. Each is written and
+ * synced under the name the manifest does not list (alternating between
+ * students.NN.dat and students.NN.alt.dat), then the manifest is replaced,
+ * which commits them together; only then do the previous files become
+ * backups. A crash at any point leaves a manifest whose files all match.
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "student.h"
+
+#define SHARD_MANIFEST "students.manifest"  /* Default shard manifest */
+#define SHARD_FILE_FORMAT "students.%02d.dat" /* Name of shard N */
+#define SHARD_ALTERNATE_FORMAT "students.%02d.alt.dat" /* Name a save alternates with */
+#define MAX_SHARDS 64                       /* Largest supported shard count */
+
+/* Opaque handle for a sharded roster layout */
+typedef struct ShardSet ShardSet;
+
+/**
+ * @brief Read a shard manifest
+ * @param manifest Name of the manifest file
+ * @return Shard set, or NULL if there is no manifest or it is malformed
+ */
+ShardSet* openShardSet(const char* manifest);
+
+/**
+ * @brief Start a new sharded layout that is written on the first save
+ *
+ * Every shard starts dirty, so the first save writes all of them. If
+ * legacyFile exists, it is renamed to a backup by that save.
+ *
+ * @param manifest Name of the manifest file to create
+ * @param count Number of shards (1 to MAX_SHARDS)
+ * @param legacyFile Single data file being split into shards
+ * @return Shard set, or NULL if count is out of range
+ */
+ShardSet* createShardSet(const char* manifest, int count, const char* legacyFile);
+
+/**
+ * @brief Get the number of shards
+ * @param set Shard set
+ * @return Number of shards
+ */
+int shardCount(const ShardSet* set);
+
+/**
+ * @brief Get the shard that owns a student ID
+ * @param set Shard set
+ * @param id Student ID
+ * @return Shard number
+ */
+int shardOf(const ShardSet* set, const char* id);
+
+/**
+ * @brief Record that the shard owning a student ID has unsaved changes
+ * @param set Shard set
+ * @param id ID of the added, deleted or modified student
+ */
+void shardMarkDirty(ShardSet* set, const char* id);
+
+/**
+ * @brief Get the number of shards with unsaved changes
+ * @param set Shard set
+ * @return Number of dirty shards
+ */
+int shardDirtyCount(const ShardSet* set);
+
+/**
+ * @brief Load and verify every shard in parallel
+ *
+ * Shards failing their checksum are reported on stderr, and only their
+ * records that pass their own checksums are loaded. With strictLoading
+ * set, any failure stops the program instead.
+ * The students of each shard keep their file order, and shards follow
+ * each other in shard order.
+ *
+ * @param set Shard set
+ * @return Head of the loaded linked list, or NULL if no students were loaded
+ */
+Student* loadShardSet(ShardSet* set);
+
+/**
+ * @brief Write the dirty shards in parallel, then the manifest
+ *
+ * Each rewritten shard file is first renamed to a timestamped backup.
+ * Records are written in ID order when an ID index is attached.
+ *
+ * @param set Shard set
+ * @param head Pointer to the head of the linked list
+ * @return true if every dirty shard and the manifest were written
+ */
+bool saveShardSet(ShardSet* set, const Student* head);
+
+/**
+ * @brief Verify every shard file and its manifest checksum
+ * @param set Shard set
+ * @param out Stream the results are printed to
+ * @return true if every shard is intact
+ */
+bool verifyShardSet(const ShardSet* set, FILE* out);
+
+/**
+ * @brief Free a shard set
+ * @param set Shard set to free
+ */
+void freeShardSet(ShardSet* set);
+
+#endif /* SHARD_H */
@@ -0,0 +1,715 @@
+/**
+ * @file shmroster.c
+ * @brief Implementation of the shared-memory roster
+ */
+
+#include "shmroster.h"
+#include "fileio.h"
+#include "idindex.h"
+#include "memtrack.h"
+#include "stats.h"
+#include "txn.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SHARED_MAGIC 0x53544d32u      /* "STM2": header with a session table */
+#define NO_SLOT 0u                    /* Slot reference meaning "none" */
+#define TOMBSTONE 0xffffffffu         /* Hash entry of a deleted student */
+#define ATTACH_TIMEOUT_MS 5000        /* How long to wait for another session to finish creating */
+#define MAX_SESSIONS 64               /* Sessions that can be attached at once */
+
+/* One student; links are slot numbers plus one, so 0 means "none" */
+typedef struct {
+    STUDENT_FIELDS(SCHEMA_MEMBER)
+    char nameKey[MAX_NAME_LENGTH];
+    uint32_t next;
+    uint32_t previous;
+} SharedSlot;
+
+/* Start of the segment; the slots and then the hash table follow it */
+typedef struct {
+    uint32_t magic;
+    uint32_t slotSize;       /* sizeof(SharedSlot), which follows the schema */
+    uint32_t ready;          /* Set last by the creating session */
+    pthread_rwlock_t lock;
+    uint32_t capacity;       /* Number of slots */
+    uint32_t hashSize;       /* Number of hash entries, a power of two */
+    uint32_t count;          /* Live students */
+    uint32_t used;           /* Slots handed out at least once */
+    uint32_t tombstones;     /* Deleted entries in the hash table */
+    uint32_t head;           /* First student, in roster order */
+    uint32_t tail;
+    uint32_t freeList;       /* Deleted slots, linked through next */
+    uint32_t sessions;       /* Attached sessions */
+    uint64_t generation;     /* Bumped by every change */
+    pid_t pids[MAX_SESSIONS]; /* Process of each attached session, 0 if free */
+} SharedHeader;
+
+struct SharedRoster {
+    char name[64];
+    size_t size;
+    SharedHeader* header;
+    SharedSlot* slots;
+    uint32_t* hash;
+};
+
+static size_t headerSize(void) {
+    // Keep the slots on their own cache line
+    return (sizeof(SharedHeader) + 63) & ~(size_t)63;
+}
+
+static size_t segmentSize(uint32_t capacity, uint32_t hashSize) {
+    return headerSize() + sizeof(SharedSlot) * (size_t)capacity + sizeof(uint32_t) * (size_t)hashSize;
+}
+
+static void locateArrays(SharedRoster* roster) {
+    char* base = (char*)roster->header;
+    roster->slots = (SharedSlot*)(base + headerSize());
+    roster->hash = (uint32_t*)(base + headerSize() + sizeof(SharedSlot) * (size_t)roster->header->capacity);
+}
+
+static uint32_t hashId(const char* id) {
+    uint32_t hash = 2166136261u;
+    for (const char* p = id; *p != '\0'; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static SharedSlot* slotAt(SharedRoster* roster, uint32_t reference) {
+    return &roster->slots[reference - 1];
+}
+
+/**
+ * Find the hash entry holding an ID
+ * @return Index into the hash table, or -1 if the ID is not present
+ */
+static long findEntry(SharedRoster* roster, const char* id) {
+    uint32_t mask = roster->header->hashSize - 1;
+    for (uint32_t i = hashId(id) & mask; ; i = (i + 1) & mask) {
+        uint32_t reference = roster->hash[i];
+        if (reference == NO_SLOT) {
+            return -1;
+        }
+        if (reference != TOMBSTONE && strcmp(slotAt(roster, reference)->id, id) == 0) {
+            return (long)i;
+        }
+    }
+}
+
+static SharedSlot* findSlot(SharedRoster* roster, const char* id) {
+    long entry = findEntry(roster, id);
+    return entry < 0 ? NULL : slotAt(roster, roster->hash[entry]);
+}
+
+static void insertEntry(SharedRoster* roster, const char* id, uint32_t reference) {
+    uint32_t mask = roster->header->hashSize - 1;
+    uint32_t i = hashId(id) & mask;
+    while (roster->hash[i] != NO_SLOT && roster->hash[i] != TOMBSTONE) {
+        i = (i + 1) & mask;
+    }
+    if (roster->hash[i] == TOMBSTONE) {
+        roster->header->tombstones--;
+    }
+    roster->hash[i] = reference;
+}
+
+/**
+ * Rebuild the hash table from the roster once deletions have left too
+ * many tombstones for probes to stay short
+ */
+static void rebuildHash(SharedRoster* roster) {
+    memset(roster->hash, 0, sizeof(uint32_t) * roster->header->hashSize);
+    roster->header->tombstones = 0;
+    for (uint32_t reference = roster->header->head; reference != NO_SLOT;
+         reference = slotAt(roster, reference)->next) {
+        insertEntry(roster, slotAt(roster, reference)->id, reference);
+    }
+}
+
+#define SLOT_TO_STUDENT(member, kind, size, label, width) \
+    SCHEMA_COPY_##kind(student->member, slot->member);
+#define STUDENT_TO_SLOT(member, kind, size, label, width) \
+    SCHEMA_COPY_##kind(slot->member, student->member);
+
+static void copySlotToStudent(const SharedSlot* slot, Student* student) {
+    STUDENT_FIELDS(SLOT_TO_STUDENT)
+    memcpy(student->nameKey, slot->nameKey, MAX_NAME_LENGTH);
+    student->deleted = false;
+    student->next = NULL;
+}
+
+static void copyStudentToSlot(const Student* student, SharedSlot* slot) {
+    STUDENT_FIELDS(STUDENT_TO_SLOT)
+    memcpy(slot->nameKey, student->nameKey, MAX_NAME_LENGTH);
+}
+
+/**
+ * Take a free slot, link it at the tail and index its ID. The caller
+ * holds the write lock and has checked that the ID is new.
+ */
+static bool appendSlot(SharedRoster* roster, const Student* student) {
+    SharedHeader* header = roster->header;
+    uint32_t reference;
+
+    if (header->freeList != NO_SLOT) {
+        reference = header->freeList;
+        header->freeList = slotAt(roster, reference)->next;
+    } else if (header->used < header->capacity) {
+        reference = ++header->used;
+    } else {
+        return false;
+    }
+
+    SharedSlot* slot = slotAt(roster, reference);
+    copyStudentToSlot(student, slot);
+    slot->next = NO_SLOT;
+    slot->previous = header->tail;
+    if (header->tail != NO_SLOT) {
+        slotAt(roster, header->tail)->next = reference;
+    } else {
+        header->head = reference;
+    }
+    header->tail = reference;
+    header->count++;
+
+    insertEntry(roster, slot->id, reference);
+    return true;
+}
+
+/**
+ * Drop the sessions whose process is gone, such as one that crashed
+ * without closing the roster. The caller holds the write lock.
+ * @return Number of sessions dropped
+ */
+static int pruneSessions(SharedHeader* header) {
+    int pruned = 0;
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        if (header->pids[i] != 0 && kill(header->pids[i], 0) != 0 && errno == ESRCH) {
+            header->pids[i] = 0;
+            header->sessions--;
+            pruned++;
+        }
+    }
+    return pruned;
+}
+
+/**
+ * Record this process in the session table. The caller holds the write
+ * lock, or is creating the segment.
+ */
+static bool registerSession(SharedHeader* header) {
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        if (header->pids[i] == 0) {
+            header->pids[i] = getpid();
+            header->sessions++;
+            return true;
+        }
+    }
+    fprintf(stderr, "Error: The shared roster already has %d sessions attached.\n", MAX_SESSIONS);
+    return false;
+}
+
+static void initializeLock(pthread_rwlock_t* lock) {
+    pthread_rwlockattr_t attributes;
+    pthread_rwlockattr_init(&attributes);
+    pthread_rwlockattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_rwlock_init(lock, &attributes);
+    pthread_rwlockattr_destroy(&attributes);
+}
+
+/**
+ * Size, map and fill a segment this session has just created
+ */
+static bool createSegment(SharedRoster* roster, int fd, const char* dataFile) {
+    STATS_BEGIN(timer);
+
+    // Parse the file once, in this session only
+    Student* list = loadStudentsFromFile(dataFile);
+    IdIndex* index = buildIdIndex(list);
+    attachIdIndex(index);
+    replayJournal(JOURNAL_FILE, &list);
+    attachIdIndex(NULL);
+    freeIdIndex(index);
+
+    uint32_t count = 0;
+    for (Student* current = list; current != NULL; current = current->next) {
+        if (!current->deleted) count++;
+    }
+
+    uint32_t capacity = count * 2 > SHARED_MIN_CAPACITY ? count * 2 : SHARED_MIN_CAPACITY;
+    uint32_t hashSize = 1;
+    while (hashSize < capacity * 2) {
+        hashSize <<= 1;
+    }
+
+    // Pages of a new segment read as zero, so the empty hash table and
+    // unused slots cost no memory until they are written
+    roster->size = segmentSize(capacity, hashSize);
+    if (ftruncate(fd, (off_t)roster->size) != 0) {
+        fprintf(stderr, "Error: Could not size shared roster: %s\n", strerror(errno));
+        freeStudentList(list);
+        return false;
+    }
+    roster->header = (SharedHeader*)mmap(NULL, roster->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (roster->header == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map shared roster: %s\n", strerror(errno));
+        freeStudentList(list);
+        return false;
+    }
+
+    SharedHeader* header = roster->header;
+    header->magic = SHARED_MAGIC;
+    header->slotSize = sizeof(SharedSlot);
+    header->capacity = capacity;
+    header->hashSize = hashSize;
+    initializeLock(&header->lock);
+    registerSession(header);
+    locateArrays(roster);
+
+    for (Student* current = list; current != NULL; current = current->next) {
+        if (!current->deleted) appendSlot(roster, current);
+    }
+    freeStudentList(list);
+
+    __atomic_store_n(&header->ready, 1, __ATOMIC_RELEASE);
+    STATS_END(STAT_LOAD, timer);
+    return true;
+}
+
+/**
+ * Map a segment created by another session, waiting for it to be filled
+ */
+static bool attachSegment(SharedRoster* roster, int fd) {
+    struct stat info;
+    int waited = 0;
+
+    // The creator sizes the segment and then sets ready once it is filled
+    for (;;) {
+        if (fstat(fd, &info) != 0) {
+            fprintf(stderr, "Error: Could not inspect shared roster: %s\n", strerror(errno));
+            return false;
+        }
+        if ((size_t)info.st_size >= sizeof(SharedHeader)) {
+            if (roster->header == NULL) {
+                roster->size = (size_t)info.st_size;
+                roster->header = (SharedHeader*)mmap(NULL, roster->size, PROT_READ | PROT_WRITE,
+                                                     MAP_SHARED, fd, 0);
+                if (roster->header == MAP_FAILED) {
+                    roster->header = NULL;
+                    fprintf(stderr, "Error: Could not map shared roster: %s\n", strerror(errno));
+                    return false;
+                }
+            }
+            if (__atomic_load_n(&roster->header->ready, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+        }
+        if (waited >= ATTACH_TIMEOUT_MS) {
+            fprintf(stderr, "Error: Shared roster %s was never initialized; remove /dev/shm%s.\n",
+                    roster->name, roster->name);
+            return false;
+        }
+        usleep(10000);
+        waited += 10;
+    }
+
+    if (roster->header->magic != SHARED_MAGIC ||
+        roster->size < segmentSize(roster->header->capacity, roster->header->hashSize)) {
+        fprintf(stderr, "Error: %s is not a student roster segment.\n", roster->name);
+        return false;
+    }
+    if (roster->header->slotSize != sizeof(SharedSlot)) {
+        fprintf(stderr, "Error: %s was created by a build with different student fields.\n",
+                roster->name);
+        return false;
+    }
+    locateArrays(roster);
+
+    // Sessions that died without closing would keep the segment alive forever
+    pthread_rwlock_wrlock(&roster->header->lock);
+    int pruned = pruneSessions(roster->header);
+    bool registered = registerSession(roster->header);
+    pthread_rwlock_unlock(&roster->header->lock);
+
+    if (pruned > 0) {
+        printf("Dropped %d session(s) of %s that exited without closing it.\n", pruned, roster->name);
+    }
+    return registered;
+}
+
+SharedRoster* openSharedRoster(const char* name, const char* dataFile) {
+    SharedRoster* roster = (SharedRoster*)trackedCalloc(1, sizeof(SharedRoster), MEM_INDEXES);
+    if (roster == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed for the shared roster.\n");
+        return NULL;
+    }
+    snprintf(roster->name, sizeof(roster->name), "%s", name);
+
+    // Exactly one session wins the exclusive create; the rest attach
+    bool created = true;
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        created = false;
+        fd = shm_open(name, O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open shared roster %s: %s\n", name, strerror(errno));
+        trackedFree(roster);
+        return NULL;
+    }
+
+    bool ok = created ? createSegment(roster, fd, dataFile) : attachSegment(roster, fd);
+    close(fd);
+
+    if (!ok) {
+        if (roster->header != NULL) {
+            munmap(roster->header, roster->size);
+        }
+        if (created) {
+            shm_unlink(name);
+        }
+        trackedFree(roster);
+        return NULL;
+    }
+    return roster;
+}
+
+int sharedStudentCount(SharedRoster* roster) {
+    pthread_rwlock_rdlock(&roster->header->lock);
+    int count = (int)roster->header->count;
+    pthread_rwlock_unlock(&roster->header->lock);
+    return count;
+}
+
+int sharedSessionCount(SharedRoster* roster) {
+    pthread_rwlock_rdlock(&roster->header->lock);
+    int sessions = (int)roster->header->sessions;
+    pthread_rwlock_unlock(&roster->header->lock);
+    return sessions;
+}
+
+bool sharedStudentIdExists(SharedRoster* roster, const char* id) {
+    pthread_rwlock_rdlock(&roster->header->lock);
+    bool exists = findEntry(roster, id) >= 0;
+    pthread_rwlock_unlock(&roster->header->lock);
+    return exists;
+}
+
+bool sharedGetStudent(SharedRoster* roster, const char* id, Student* student) {
+    STATS_BEGIN(timer);
+    pthread_rwlock_rdlock(&roster->header->lock);
+    SharedSlot* slot = findSlot(roster, id);
+    if (slot != NULL) {
+        copySlotToStudent(slot, student);
+    }
+    pthread_rwlock_unlock(&roster->header->lock);
+    STATS_END(STAT_SEARCH_ID, timer);
+    return slot != NULL;
+}
+
+bool sharedAddStudent(SharedRoster* roster, const Student* student) {
+    STATS_BEGIN(timer);
+    bool added = false;
+
+    pthread_rwlock_wrlock(&roster->header->lock);
+    if (findEntry(roster, student->id) < 0) {
+        added = appendSlot(roster, student);
+        if (!added) {
+            fprintf(stderr, "Error: The shared roster is full (%u students).\n", roster->header->capacity);
+        } else {
+            roster->header->generation++;
+        }
+    }
+    pthread_rwlock_unlock(&roster->header->lock);
+
+    STATS_END(STAT_ADD, timer);
+    return added;
+}
+
+bool sharedModifyStudent(SharedRoster* roster, const char* id, const char* name, int age,
+                         const char* course, const char* grades) {
+    STATS_BEGIN(timer);
+
+    pthread_rwlock_wrlock(&roster->header->lock);
+    SharedSlot* slot = findSlot(roster, id);
+    if (slot != NULL) {
+        // Same setters as modifyStudent, so both rosters store a field alike
+        if (name != NULL) {
+            SCHEMA_SET_TEXT(slot->name, name);
+            foldSearchKey(slot->nameKey, slot->name, MAX_NAME_LENGTH);
+        }
+        if (age != -1) {
+            SCHEMA_SET_INT(slot->age, age);
+        }
+        if (course != NULL) {
+            SCHEMA_SET_TEXT(slot->course, course);
+        }
+        if (grades != NULL) {
+            SCHEMA_SET_TEXT(slot->grades, grades);
+        }
+        roster->header->generation++;
+    }
+    pthread_rwlock_unlock(&roster->header->lock);
+
+    STATS_END(STAT_MODIFY, timer);
+    return slot != NULL;
+}
+
+bool sharedDeleteStudent(SharedRoster* roster, const char* id) {
+    STATS_BEGIN(timer);
+    SharedHeader* header = roster->header;
+
+    pthread_rwlock_wrlock(&header->lock);
+    long entry = findEntry(roster, id);
+    if (entry >= 0) {
+        uint32_t reference = roster->hash[entry];
+        SharedSlot* slot = slotAt(roster, reference);
+
+        // Unlink from the roster order
+        if (slot->previous != NO_SLOT) {
+            slotAt(roster, slot->previous)->next = slot->next;
+        } else {
+            header->head = slot->next;
+        }
+        if (slot->next != NO_SLOT) {
+            slotAt(roster, slot->next)->previous = slot->previous;
+        } else {
+            header->tail = slot->previous;
+        }
+
+        roster->hash[entry] = TOMBSTONE;
+        header->tombstones++;
+        slot->next = header->freeList;
+        header->freeList = reference;
+        header->count--;
+        header->generation++;
+
+        if (header->tombstones > header->hashSize / 4) {
+            rebuildHash(roster);
+        }
+    }
+    pthread_rwlock_unlock(&header->lock);
+
+    STATS_END(STAT_DELETE, timer);
+    return entry >= 0;
+}
+
+typedef bool (*SlotFilter)(const SharedSlot* slot, const void* context);
+
+/**
+ * Copy every student that passes a filter, in roster order, into one
+ * block holding the pointer array followed by the copies
+ */
+static Student** copyMatchingStudents(SharedRoster* roster, SlotFilter filter,
+                                      const void* context, int* count) {
+    *count = 0;
+    pthread_rwlock_rdlock(&roster->header->lock);
+
+    for (uint32_t reference = roster->header->head; reference != NO_SLOT;
+         reference = slotAt(roster, reference)->next) {
+        if (filter(slotAt(roster, reference), context)) {
+            (*count)++;
+        }
+    }
+
+    Student** results = NULL;
+    if (*count > 0) {
+        results = (Student**)trackedMalloc((sizeof(Student*) + sizeof(Student)) * (size_t)*count,
+                                           MEM_SEARCH_RESULTS);
+    }
+    if (results != NULL) {
+        Student* copies = (Student*)(results + *count);
+        int index = 0;
+        for (uint32_t reference = roster->header->head; reference != NO_SLOT;
+             reference = slotAt(roster, reference)->next) {
+            const SharedSlot* slot = slotAt(roster, reference);
+            if (filter(slot, context)) {
+                copySlotToStudent(slot, &copies[index]);
+                results[index] = &copies[index];
+                index++;
+            }
+        }
+    } else {
+        *count = 0;
+    }
+
+    pthread_rwlock_unlock(&roster->header->lock);
+    return results;
+}
+
+static bool nameContains(const SharedSlot* slot, const void* context) {
+    return strstr(slot->nameKey, (const char*)context) != NULL;
+}
+
+Student** sharedSearchStudentsByName(SharedRoster* roster, const char* name, int* count) {
+    STATS_BEGIN(timer);
+    char key[MAX_NAME_LENGTH];
+    foldSearchKey(key, name, MAX_NAME_LENGTH);
+
+    Student** results = copyMatchingStudents(roster, nameContains, key, count);
+    STATS_END(STAT_SEARCH_NAME, timer);
+    return results;
+}
+
+typedef struct {
+    const char* low;
+    const char* high;
+} IdRange;
+
+static bool idInRange(const SharedSlot* slot, const void* context) {
+    const IdRange* range = (const IdRange*)context;
+    return compareIds(slot->id, range->low) >= 0 && compareIds(slot->id, range->high) <= 0;
+}
+
+static int compareStudentIds(const void* a, const void* b) {
+    return compareIds((*(Student* const*)a)->id, (*(Student* const*)b)->id);
+}
+
+Student** sharedSearchStudentsByIdRange(SharedRoster* roster, const char* low,
+                                        const char* high, int* count) {
+    IdRange range = {low, high};
+    Student** results = copyMatchingStudents(roster, idInRange, &range, count);
+    if (results != NULL) {
+        qsort(results, *count, sizeof(Student*), compareStudentIds);
+    }
+    return results;
+}
+
+static bool slotMatchesFilter(const SharedSlot* slot, const void* context) {
+    const FilterProgram* program = (const FilterProgram*)context;
+    const char* low;
+    const char* high;
+    filterIdBounds(program, &low, &high);
+    if ((low != NULL && compareIds(slot->id, low) < 0) ||
+        (high != NULL && compareIds(slot->id, high) > 0)) {
+        return false;
+    }
+
+    Student student;
+    copySlotToStudent(slot, &student);
+    return filterMatches(program, &student);
+}
+
+Student** sharedSearchStudentsByFilter(SharedRoster* roster, const FilterProgram* program, int* count) {
+    STATS_BEGIN(timer);
+    Student** results = copyMatchingStudents(roster, slotMatchesFilter, program, count);
+    STATS_END(STAT_FILTER, timer);
+    return results;
+}
+
+FuzzyMatch* sharedSearchStudentsByNameFuzzy(SharedRoster* roster, const char* name,
+                                            int maxDistance, int* count) {
+    STATS_BEGIN(timer);
+    FuzzyPattern pattern;
+    char key[MAX_NAME_LENGTH];
+    *count = 0;
+
+    foldSearchKey(key, name, MAX_NAME_LENGTH);
+    if (!compileFuzzyPattern(&pattern, key, maxDistance)) {
+        return NULL;
+    }
+
+    pthread_rwlock_rdlock(&roster->header->lock);
+
+    for (uint32_t reference = roster->header->head; reference != NO_SLOT;
+         reference = slotAt(roster, reference)->next) {
+        const char* nameKey = slotAt(roster, reference)->nameKey;
+        if (fuzzyMatchDistance(&pattern, nameKey, strlen(nameKey)) >= 0) {
+            (*count)++;
+        }
+    }
+
+    // The matches and the copies they point to share one block
+    FuzzyMatch* matches = NULL;
+    if (*count > 0) {
+        matches = (FuzzyMatch*)trackedMalloc((sizeof(FuzzyMatch) + sizeof(Student)) * (size_t)*count,
+                                             MEM_SEARCH_RESULTS);
+    }
+    if (matches != NULL) {
+        Student* copies = (Student*)(matches + *count);
+        int index = 0;
+        for (uint32_t reference = roster->header->head; reference != NO_SLOT;
+             reference = slotAt(roster, reference)->next) {
+            const SharedSlot* slot = slotAt(roster, reference);
+            int distance = fuzzyMatchDistance(&pattern, slot->nameKey, strlen(slot->nameKey));
+            if (distance >= 0) {
+                copySlotToStudent(slot, &copies[index]);
+                matches[index].student = &copies[index];
+                matches[index].distance = distance;
+                index++;
+            }
+        }
+    } else {
+        *count = 0;
+    }
+
+    pthread_rwlock_unlock(&roster->header->lock);
+
+    if (matches != NULL) {
+        sortFuzzyMatches(matches, *count);
+    }
+    STATS_END(STAT_SEARCH_FUZZY, timer);
+    return matches;
+}
+
+Student* sharedCopyList(SharedRoster* roster) {
+    Student* head = NULL;
+    Student* tail = NULL;
+
+    pthread_rwlock_rdlock(&roster->header->lock);
+    for (uint32_t reference = roster->header->head; reference != NO_SLOT;
+         reference = slotAt(roster, reference)->next) {
+        Student* copy = (Student*)trackedMalloc(sizeof(Student), MEM_RECORDS);
+        if (copy == NULL) {
+            fprintf(stderr, "Memory allocation failed while copying the shared roster\n");
+            break;
+        }
+        copySlotToStudent(slotAt(roster, reference), copy);
+        if (tail != NULL) {
+            tail->next = copy;
+        } else {
+            head = copy;
+        }
+        tail = copy;
+    }
+    pthread_rwlock_unlock(&roster->header->lock);
+
+    return head;
+}
+
+void closeSharedRoster(SharedRoster* roster) {
+    if (roster == NULL) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&roster->header->lock);
+    pid_t self = getpid();
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        if (roster->header->pids[i] == self) {
+            roster->header->pids[i] = 0;
+            roster->header->sessions--;
+            break;
+        }
+    }
+    pruneSessions(roster->header);
+    bool last = roster->header->sessions == 0;
+    pthread_rwlock_unlock(&roster->header->lock);
+
+    munmap(roster->header, roster->size);
+    if (last) {
+        shm_unlink(roster->name);
+    }
+    trackedFree(roster);
+}
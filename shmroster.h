@@ -0,0 +1,162 @@
+/**
+ * @file shmroster.h
+ * @brief Header file containing the shared-memory roster
+ *
+ * The roster lives in a named POSIX shared-memory segment, so several
+ * sessions on the same machine work on one in-memory copy. The first
+ * session creates the segment and loads the data file into it; later
+ * sessions map it without parsing anything and see every change at once.
+ *
+ * Records are stored in fixed slots linked by slot numbers rather than
+ * pointers, since each process maps the segment at its own address. A
+ * hash table over the IDs, also in the segment, answers lookups, and a
+ * process-shared read-write lock guards every access. Functions that
+ * return students hand out private copies, never pointers into the
+ * segment.
+ */
+
+#ifndef SHMROSTER_H
+#define SHMROSTER_H
+
+#include "student.h"
+#include "fuzzy.h"
+#include "filter.h"
+
+#define SHARED_ROSTER_NAME "/student_mgmt_roster"  /* Name of the shared-memory segment */
+#define SHARED_MIN_CAPACITY (1u << 16)             /* Fewest slots a new segment gets */
+
+/* Opaque handle for a mapped shared roster */
+typedef struct SharedRoster SharedRoster;
+
+/**
+ * @brief Attach to the shared roster, creating and loading it if needed
+ *
+ * A new segment is filled from the data file (plus any journaled
+ * transactions) and gets room for twice as many students, or at least
+ * SHARED_MIN_CAPACITY. Sessions whose process has exited without
+ * closing the roster are dropped from its session table on attach.
+ *
+ * @param name Name of the shared-memory segment
+ * @param dataFile Data file to load when the segment is created
+ * @return Handle for the roster, or NULL if it couldn't be created or mapped
+ */
+SharedRoster* openSharedRoster(const char* name, const char* dataFile);
+
+/**
+ * @brief Get the number of students in the shared roster
+ * @param roster Shared roster
+ * @return Number of students
+ */
+int sharedStudentCount(SharedRoster* roster);
+
+/**
+ * @brief Get the number of sessions attached to the shared roster
+ * @param roster Shared roster
+ * @return Number of attached sessions, including this one
+ */
+int sharedSessionCount(SharedRoster* roster);
+
+/**
+ * @brief Check if a student ID exists in the shared roster
+ * @param roster Shared roster
+ * @param id ID to check
+ * @return true if ID exists, false otherwise
+ */
+bool sharedStudentIdExists(SharedRoster* roster, const char* id);
+
+/**
+ * @brief Copy a student out of the shared roster
+ * @param roster Shared roster
+ * @param id ID of the student
+ * @param student Where to store the copy (its next pointer is set to NULL)
+ * @return true if the student was found, false otherwise
+ */
+bool sharedGetStudent(SharedRoster* roster, const char* id, Student* student);
+
+/**
+ * @brief Add a student to the shared roster
+ * @param roster Shared roster
+ * @param student Student to copy in
+ * @return true if added, false if the ID exists or the roster is full
+ */
+bool sharedAddStudent(SharedRoster* roster, const Student* student);
+
+/**
+ * @brief Modify a student in the shared roster
+ * @param roster Shared roster
+ * @param id ID of the student to modify
+ * @param name New name (NULL to keep the current one)
+ * @param age New age (-1 to keep the current one)
+ * @param course New course (NULL to keep the current one)
+ * @param grades New grades (NULL to keep the current ones)
+ * @return true if the student was found and modified, false otherwise
+ */
+bool sharedModifyStudent(SharedRoster* roster, const char* id, const char* name, int age,
+                         const char* course, const char* grades);
+
+/**
+ * @brief Delete a student from the shared roster
+ * @param roster Shared roster
+ * @param id ID of the student to delete
+ * @return true if the student was found and deleted, false otherwise
+ */
+bool sharedDeleteStudent(SharedRoster* roster, const char* id);
+
+/**
+ * @brief Search the shared roster by name (partial, case- and accent-insensitive)
+ * @param roster Shared roster
+ * @param name Name to search for
+ * @param count Pointer to store the count of matching students
+ * @return Pointers to copies of the matches, freed together with
+ *         freeSearchResults, or NULL if none were found
+ */
+Student** sharedSearchStudentsByName(SharedRoster* roster, const char* name, int* count);
+
+/**
+ * @brief Find the students of the shared roster whose IDs fall in an inclusive range
+ * @param roster Shared roster
+ * @param low Lowest ID to include
+ * @param high Highest ID to include
+ * @param count Pointer to store the count of matching students
+ * @return Pointers to copies of the matches in ID order, freed together
+ *         with freeSearchResults, or NULL if none were found
+ */
+Student** sharedSearchStudentsByIdRange(SharedRoster* roster, const char* low,
+                                        const char* high, int* count);
+
+/**
+ * @brief Typo-tolerant name search of the shared roster
+ * @param roster Shared roster
+ * @param name Name to search for
+ * @param maxDistance Largest accepted edit distance (0 to MAX_FUZZY_DISTANCE)
+ * @param count Pointer to store the count of matching students
+ * @return Matches ranked by distance, pointing to copies freed together
+ *         with freeFuzzyMatches, or NULL if none were found
+ */
+FuzzyMatch* sharedSearchStudentsByNameFuzzy(SharedRoster* roster, const char* name,
+                                            int maxDistance, int* count);
+
+/**
+ * @brief Find the students of the shared roster matching a compiled filter
+ * @param roster Shared roster
+ * @param program Compiled filter
+ * @param count Pointer to store the count of matching students
+ * @return Pointers to copies of the matches in roster order, freed
+ *         together with freeSearchResults, or NULL if none were found
+ */
+Student** sharedSearchStudentsByFilter(SharedRoster* roster, const FilterProgram* program, int* count);
+
+/**
+ * @brief Copy the whole shared roster into a private linked list
+ * @param roster Shared roster
+ * @return Head of the copied list (free with freeStudentList)
+ */
+Student* sharedCopyList(SharedRoster* roster);
+
+/**
+ * @brief Detach from the shared roster; the last live session removes the segment
+ * @param roster Shared roster
+ */
+void closeSharedRoster(SharedRoster* roster);
+
+#endif /* SHMROSTER_H */
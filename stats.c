@@ -0,0 +1,179 @@
+/**
+ * @file stats.c
+ * @brief Implementation of operation latency instrumentation
+ */
+
+#include "stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/*
+ * Log-linear buckets in the style of HDR histograms: values below
+ * SUB_BUCKETS get one bucket each, and every power of two above that is
+ * split into SUB_BUCKETS equal buckets, bounding the relative error of
+ * a reported value by 1 / (2 * SUB_BUCKETS).
+ */
+#define SUB_BUCKET_BITS 5
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define BUCKET_COUNT ((64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS)
+
+typedef struct {
+    uint64_t buckets[BUCKET_COUNT];
+    uint64_t count;
+    uint64_t total;  /* Sum of all durations, for the mean */
+    uint64_t max;
+} Histogram;
+
+bool statsEnabled = false;
+
+static Histogram histograms[STAT_OP_COUNT];
+
+/* Records may come from the shard loader and writer threads */
+static pthread_mutex_t histogramLock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* opNames[STAT_OP_COUNT] = {
+    "load", "save", "create", "add", "delete", "modify", "search_id", "search_name",
+    "search_fuzzy", "duplicates", "autosave", "commit", "filter", "ingest",
+    "reload"
+};
+
+static int bucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return (int)value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int subBucket = (int)((value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket;
+}
+
+static uint64_t bucketMidpoint(int index) {
+    if (index < SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint64_t subBucket = (uint64_t)(index % SUB_BUCKETS);
+    uint64_t width = 1ULL << (exponent - SUB_BUCKET_BITS);
+    return ((SUB_BUCKETS + subBucket) << (exponent - SUB_BUCKET_BITS)) + width / 2;
+}
+
+uint64_t statsNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+void statsRecord(StatOp op, uint64_t nanos) {
+    Histogram* histogram = &histograms[op];
+    int bucket = bucketIndex(nanos);
+
+    pthread_mutex_lock(&histogramLock);
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->total += nanos;
+    if (nanos > histogram->max) {
+        histogram->max = nanos;
+    }
+    pthread_mutex_unlock(&histogramLock);
+}
+
+uint64_t statsCount(StatOp op) {
+    return histograms[op].count;
+}
+
+uint64_t statsPercentile(StatOp op, double percentile) {
+    const Histogram* histogram = &histograms[op];
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    // Rank of the requested value, 1-based
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > histogram->count) rank = histogram->count;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            uint64_t value = bucketMidpoint(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+const char* statsOpName(StatOp op) {
+    return opNames[op];
+}
+
+/**
+ * Format a duration with a unit that keeps it readable
+ */
+void formatDuration(char* buffer, size_t size, uint64_t nanos) {
+    if (nanos < 1000ULL) {
+        snprintf(buffer, size, "%lluns", (unsigned long long)nanos);
+    } else if (nanos < 1000000ULL) {
+        snprintf(buffer, size, "%.1fus", (double)nanos / 1e3);
+    } else if (nanos < 1000000000ULL) {
+        snprintf(buffer, size, "%.1fms", (double)nanos / 1e6);
+    } else {
+        snprintf(buffer, size, "%.1fs", (double)nanos / 1e9);
+    }
+}
+
+void printStats(FILE* out) {
+    char p50[32], p99[32], max[32];
+
+    if (!statsEnabled) {
+        fprintf(out, "Statistics are disabled (start with --stats to record them).\n");
+    }
+
+    fprintf(out, "%-12s %10s %10s %10s %10s\n", "Operation", "Count", "p50", "p99", "Max");
+    for (int op = 0; op < STAT_OP_COUNT; op++) {
+        const Histogram* histogram = &histograms[op];
+        if (histogram->count == 0) continue;
+
+        formatDuration(p50, sizeof(p50), statsPercentile((StatOp)op, 50.0));
+        formatDuration(p99, sizeof(p99), statsPercentile((StatOp)op, 99.0));
+        formatDuration(max, sizeof(max), histogram->max);
+        fprintf(out, "%-12s %10llu %10s %10s %10s\n", opNames[op],
+                (unsigned long long)histogram->count, p50, p99, max);
+    }
+}
+
+bool writeStatsJson(const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not open file %s for writing.\n", filename);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"unit\": \"ns\",\n  \"operations\": {");
+    bool first = true;
+    for (int op = 0; op < STAT_OP_COUNT; op++) {
+        const Histogram* histogram = &histograms[op];
+        if (histogram->count == 0) continue;
+
+        fprintf(file, "%s\n    \"%s\": {\"count\": %llu, \"mean\": %llu, \"p50\": %llu, "
+                      "\"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}",
+                first ? "" : ",",
+                opNames[op],
+                (unsigned long long)histogram->count,
+                (unsigned long long)(histogram->total / histogram->count),
+                (unsigned long long)statsPercentile((StatOp)op, 50.0),
+                (unsigned long long)statsPercentile((StatOp)op, 90.0),
+                (unsigned long long)statsPercentile((StatOp)op, 99.0),
+                (unsigned long long)statsPercentile((StatOp)op, 99.9),
+                (unsigned long long)histogram->max);
+        first = false;
+    }
+    fprintf(file, "\n  }\n}\n");
+
+    return fclose(file) == 0;
+}
+
+void resetStats(void) {
+    memset(histograms, 0, sizeof(histograms));
+}
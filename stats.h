@@ -0,0 +1,114 @@
+/**
+ * @file stats.h
+ * @brief Header file containing operation latency instrumentation
+ *
+ * Operations are timed with a monotonic clock and recorded into
+ * log-scale latency histograms (one per operation), from which
+ * percentiles can be reported. Recording is switched on at runtime;
+ * while it is off each timing point costs a single branch. Building
+ * with -DSTATS_DISABLED removes the timing points entirely.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Operations that are timed */
+typedef enum {
+    STAT_LOAD,          /* loadStudentsFromFile / lazy index build */
+    STAT_SAVE,          /* saveStudentsToFile */
+    STAT_CREATE,        /* createStudent */
+    STAT_ADD,           /* addStudent */
+    STAT_DELETE,        /* deleteStudent */
+    STAT_MODIFY,        /* modifyStudent */
+    STAT_SEARCH_ID,     /* searchStudentById / lazyGetStudent */
+    STAT_SEARCH_NAME,   /* searchStudentsByName / lazySearchStudentsByName */
+    STAT_SEARCH_FUZZY,  /* searchStudentsByNameFuzzy / lazySearchStudentsByNameFuzzy */
+    STAT_DUPLICATES,    /* findDuplicateCandidates */
+    STAT_AUTOSAVE,      /* Background snapshot write, sync and rename */
+    STAT_COMMIT,        /* commitTransaction journal write and fsync */
+    STAT_FILTER,        /* searchStudentsByFilter / lazySearchStudentsByFilter */
+    STAT_INGEST,        /* Applying and committing one ingest ring buffer */
+    STAT_RELOAD,        /* Reconciling the roster with a data file changed on disk */
+    STAT_OP_COUNT       /* Number of timed operations */
+} StatOp;
+
+/* true while timings are being recorded */
+extern bool statsEnabled;
+
+#ifdef STATS_DISABLED
+#define STATS_BEGIN(timer)
+#define STATS_END(op, timer)
+#else
+/* Start timing an operation; declares a local holding the start time */
+#define STATS_BEGIN(timer) uint64_t timer = statsEnabled ? statsNow() : 0
+/* Stop timing an operation started with STATS_BEGIN and record it */
+#define STATS_END(op, timer) \
+    do { if (statsEnabled) statsRecord((op), statsNow() - (timer)); } while (0)
+#endif
+
+/**
+ * @brief Read the monotonic clock
+ * @return Current time in nanoseconds
+ */
+uint64_t statsNow(void);
+
+/**
+ * @brief Record one timed operation
+ * @param op Operation that was timed
+ * @param nanos Duration in nanoseconds
+ */
+void statsRecord(StatOp op, uint64_t nanos);
+
+/**
+ * @brief Get the number of recorded calls of an operation
+ * @param op Operation to query
+ * @return Number of recorded calls
+ */
+uint64_t statsCount(StatOp op);
+
+/**
+ * @brief Estimate a latency percentile of an operation
+ * @param op Operation to query
+ * @param percentile Percentile between 0 and 100
+ * @return Latency in nanoseconds (within about 3% of the exact value)
+ */
+uint64_t statsPercentile(StatOp op, double percentile);
+
+/**
+ * @brief Get the name of an operation as shown in reports
+ * @param op Operation to name
+ * @return Operation name
+ */
+const char* statsOpName(StatOp op);
+
+/**
+ * @brief Format a duration with a unit that keeps it short ("850ns", "12.3us", "4.5ms")
+ * @param buffer Buffer for the text
+ * @param size Size of the buffer
+ * @param nanos Duration in nanoseconds
+ */
+void formatDuration(char* buffer, size_t size, uint64_t nanos);
+
+/**
+ * @brief Print count, p50, p99 and max latency of every recorded operation
+ * @param out Stream to print to
+ */
+void printStats(FILE* out);
+
+/**
+ * @brief Write the statistics of every operation as JSON
+ * @param filename Name of the file to write
+ * @return true if the file was written, false otherwise
+ */
+bool writeStatsJson(const char* filename);
+
+/**
+ * @brief Clear every histogram and counter
+ */
+void resetStats(void);
+
+#endif /* STATS_H */
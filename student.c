@@ -4,55 +4,236 @@
  */
 
 #include "student.h"
+#include "stats.h"
+#include "memtrack.h"
+#include "utils.h"
+#include "idindex.h"
+#include "txn.h"
+#include "shard.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
-Student* createStudent(const char* id, const char* name, int age, const char* course, const char* grades) {
+/* Optional ID index kept in sync by addStudent and deleteStudent */
+static IdIndex* attachedIndex = NULL;
+
+/* Optional shard set whose shards record which IDs changed */
+static ShardSet* attachedShards = NULL;
+
+/* Bumped by every successful add, delete and modify */
+static unsigned long storeVersion = 0;
+
+/* Tombstones still linked, and the node compaction resumes after (NULL: the head) */
+static int tombstones = 0;
+static Student* compactCursor = NULL;
+
+/* Field-wise copy and compare, expanded from the schema */
+#define COPY_FIELD(member, kind, size, label, width) SCHEMA_COPY_##kind(to->member, from->member);
+#define COMPARE_FIELD(member, kind, size, label, width) \
+    if ((result = SCHEMA_COMPARE_##kind(first->member, second->member)) != 0) return result;
+
+void copyStudentFields(Student* to, const Student* from) {
+    STUDENT_FIELDS(COPY_FIELD)
+}
+
+int compareStudentFields(const Student* first, const Student* second) {
+    int result;
+    STUDENT_FIELDS(COMPARE_FIELD)
+    return 0;
+}
+
+Student* createStudentFrom(const Student* fields) {
+    STATS_BEGIN(timer);
+    
     // Allocate memory for a new student
-    Student* newStudent = (Student*)malloc(sizeof(Student));
+    Student* newStudent = (Student*)trackedMalloc(sizeof(Student), MEM_RECORDS);
     if (newStudent == NULL) {
         fprintf(stderr, "Memory allocation failed for new student\n");
         return NULL;
     }
 
-    // Copy data to the new student
-    strncpy(newStudent->id, id, ID_LENGTH - 1);
-    newStudent->id[ID_LENGTH - 1] = '\0';  // Ensure null termination
+    copyStudentFields(newStudent, fields);
+    foldSearchKey(newStudent->nameKey, newStudent->name, MAX_NAME_LENGTH);
+    newStudent->deleted = false;
+    newStudent->next = NULL;
     
-    strncpy(newStudent->name, name, MAX_NAME_LENGTH - 1);
-    newStudent->name[MAX_NAME_LENGTH - 1] = '\0';
+    STATS_END(STAT_CREATE, timer);
+    return newStudent;
+}
+
+Student* createStudent(const char* id, const char* name, int age, const char* course, const char* grades) {
+    // Values longer than a field are truncated to fit
+    Student fields;
+    SCHEMA_SET_TEXT(fields.id, id);
+    SCHEMA_SET_TEXT(fields.name, name);
+    SCHEMA_SET_INT(fields.age, age);
+    SCHEMA_SET_TEXT(fields.course, course);
+    SCHEMA_SET_TEXT(fields.grades, grades);
+    return createStudentFrom(&fields);
+}
+
+void attachIdIndex(IdIndex* index) {
+    attachedIndex = index;
+}
+
+IdIndex* getAttachedIdIndex(void) {
+    return attachedIndex;
+}
+
+void attachShardSet(ShardSet* set) {
+    attachedShards = set;
+}
+
+ShardSet* getAttachedShardSet(void) {
+    return attachedShards;
+}
+
+unsigned long studentStoreVersion(void) {
+    return storeVersion;
+}
+
+/**
+ * Link a student after the last node (NULL for an empty list), keeping
+ * the index, the shard set and the undo log in step
+ */
+static void linkAtTail(Student* last, Student* student) {
+    storeVersion++;
     
-    newStudent->age = age;
+    if (attachedIndex != NULL) {
+        idIndexInsert(attachedIndex, student);
+    }
+    if (attachedShards != NULL) {
+        shardMarkDirty(attachedShards, student->id);
+    }
     
-    strncpy(newStudent->course, course, MAX_COURSE_LENGTH - 1);
-    newStudent->course[MAX_COURSE_LENGTH - 1] = '\0';
+    if (last != NULL) {
+        last->next = student;
+    }
+    if (transactionActive()) {
+        txnLogAdd(student, last);
+    }
+}
+
+Student* addStudent(Student* head, Student* student) {
+    STATS_BEGIN(timer);
     
-    strncpy(newStudent->grades, grades, MAX_GRADES_LENGTH - 1);
-    newStudent->grades[MAX_GRADES_LENGTH - 1] = '\0';
+    // Find the last node in the list
+    Student* last = head;
+    while (last != NULL && last->next != NULL) {
+        last = last->next;
+    }
     
-    newStudent->next = NULL;
+    // Add the new student at the end, or as the head of an empty list
+    linkAtTail(last, student);
     
-    return newStudent;
+    STATS_END(STAT_ADD, timer);
+    return head != NULL ? head : student;
 }
 
-Student* addStudent(Student* head, Student* student) {
-    // If the list is empty, make the new student the head
-    if (head == NULL) {
-        return student;
+void appendStudent(Student** head, Student** tail, Student* student) {
+    STATS_BEGIN(timer);
+    
+    linkAtTail(*tail, student);
+    if (*head == NULL) {
+        *head = student;
     }
+    *tail = student;
     
-    // Find the last node in the list
-    Student* current = head;
-    while (current->next != NULL) {
-        current = current->next;
+    STATS_END(STAT_ADD, timer);
+}
+
+/**
+ * Check whether tombstones make up enough of the roster to compact
+ */
+static bool compactionDue(void) {
+    if (tombstones < COMPACT_MIN_TOMBSTONES) {
+        return false;
+    }
+    // Without an index the live count is unknown, so the minimum decides
+    if (attachedIndex == NULL) {
+        return true;
+    }
+    return (long)tombstones * 100 >=
+           ((long)tombstones + idIndexCount(attachedIndex)) * COMPACT_DEAD_PERCENT;
+}
+
+bool removeStudent(Student** head, const char* id) {
+    Student* student = searchStudentById(*head, id);
+    if (student == NULL) {
+        return false;
     }
     
-    // Add the new student at the end
-    current->next = student;
+    // Leave it linked as a tombstone; compaction frees it later
+    student->deleted = true;
+    tombstones++;
+    storeVersion++;
     
-    return head;
+    if (attachedIndex != NULL) {
+        idIndexRemove(attachedIndex, id);
+    }
+    if (attachedShards != NULL) {
+        shardMarkDirty(attachedShards, id);
+    }
+    if (transactionActive()) {
+        txnLogDelete(student);
+    }
+    
+    if (compactionDue()) {
+        compactStudentList(head, COMPACT_STEP);
+    }
+    return true;
+}
+
+void restoreStudent(Student* student) {
+    student->deleted = false;
+    tombstones--;
+    if (attachedIndex != NULL) {
+        idIndexInsert(attachedIndex, student);
+    }
+}
+
+int compactStudentList(Student** head, int budget) {
+    if (transactionActive() || tombstones == 0) {
+        return 0;
+    }
+    
+    // A full pass starts from the head
+    if (budget < 0) {
+        compactCursor = NULL;
+    }
+    
+    int freed = 0;
+    int visited = 0;
+    while (budget < 0 || visited < budget) {
+        Student* next = compactCursor != NULL ? compactCursor->next : *head;
+        visited++;
+        
+        if (next == NULL) {
+            // End of the list: the next step starts over from the head
+            compactCursor = NULL;
+            if (budget < 0 || tombstones == 0) break;
+            continue;
+        }
+        if (next->deleted) {
+            // Unlink it; the cursor stays put to look at the new successor
+            if (compactCursor != NULL) {
+                compactCursor->next = next->next;
+            } else {
+                *head = next->next;
+            }
+            freeStudent(next);
+            tombstones--;
+            freed++;
+        } else {
+            compactCursor = next;
+        }
+    }
+    return freed;
+}
+
+int studentTombstoneCount(void) {
+    return tombstones;
 }
 
 Student* deleteStudent(Student* head, const char* id) {
@@ -61,98 +242,134 @@ Student* deleteStudent(Student* head, const char* id) {
         return NULL;
     }
     
-    Student* current = head;
-    Student* previous = NULL;
-    
-    // Check if the head node needs to be deleted
-    if (strcmp(current->id, id) == 0) {
-        Student* newHead = current->next;
-        free(current);
-        printf("Student with ID %s has been deleted.\n", id);
-        return newHead;
-    }
-    
-    // Search for the student to delete
-    while (current != NULL && strcmp(current->id, id) != 0) {
-        previous = current;
-        current = current->next;
-    }
+    STATS_BEGIN(timer);
     
-    // If student was found
-    if (current != NULL) {
-        previous->next = current->next;
-        free(current);
+    if (removeStudent(&head, id)) {
         printf("Student with ID %s has been deleted.\n", id);
     } else {
         printf("Student with ID %s not found.\n", id);
     }
     
+    STATS_END(STAT_DELETE, timer);
     return head;
 }
 
-bool modifyStudent(Student* head, const char* id, const char* name, int age, const char* course, const char* grades) {
+/**
+ * Find the student about to be modified and record the change: bump the
+ * version, mark its shard dirty and log its old values
+ */
+static Student* beginModify(Student* head, const char* id) {
     Student* student = searchStudentById(head, id);
+    if (student == NULL) {
+        return NULL;
+    }
+    
+    storeVersion++;
+    if (attachedShards != NULL) {
+        shardMarkDirty(attachedShards, id);
+    }
+    if (transactionActive()) {
+        txnLogModify(student);
+    }
+    return student;
+}
+
+bool modifyStudent(Student* head, const char* id, const char* name, int age, const char* course, const char* grades) {
+    STATS_BEGIN(timer);
+    Student* student = beginModify(head, id);
     
     if (student == NULL) {
+        STATS_END(STAT_MODIFY, timer);
         return false;
     }
     
     // Update fields only if new values are provided
     if (name != NULL) {
-        strncpy(student->name, name, MAX_NAME_LENGTH - 1);
-        student->name[MAX_NAME_LENGTH - 1] = '\0';
+        SCHEMA_SET_TEXT(student->name, name);
+        foldSearchKey(student->nameKey, student->name, MAX_NAME_LENGTH);
     }
     
     if (age != -1) {
-        student->age = age;
+        SCHEMA_SET_INT(student->age, age);
     }
     
     if (course != NULL) {
-        strncpy(student->course, course, MAX_COURSE_LENGTH - 1);
-        student->course[MAX_COURSE_LENGTH - 1] = '\0';
+        SCHEMA_SET_TEXT(student->course, course);
     }
     
     if (grades != NULL) {
-        strncpy(student->grades, grades, MAX_GRADES_LENGTH - 1);
-        student->grades[MAX_GRADES_LENGTH - 1] = '\0';
+        SCHEMA_SET_TEXT(student->grades, grades);
     }
     
+    STATS_END(STAT_MODIFY, timer);
+    return true;
+}
+
+bool updateStudent(Student* head, const Student* record) {
+    STATS_BEGIN(timer);
+    Student* student = beginModify(head, record->id);
+    
+    if (student == NULL) {
+        STATS_END(STAT_MODIFY, timer);
+        return false;
+    }
+    
+    copyStudentFields(student, record);
+    foldSearchKey(student->nameKey, student->name, MAX_NAME_LENGTH);
+    
+    STATS_END(STAT_MODIFY, timer);
     return true;
 }
 
 Student* searchStudentById(Student* head, const char* id) {
+    STATS_BEGIN(timer);
     Student* current = head;
     
+    if (attachedIndex != NULL) {
+        current = idIndexFind(attachedIndex, id);
+        STATS_END(STAT_SEARCH_ID, timer);
+        return current;
+    }
+    
     while (current != NULL) {
-        if (strcmp(current->id, id) == 0) {
-            return current;
+        if (!current->deleted && strcmp(current->id, id) == 0) {
+            break;
         }
         current = current->next;
     }
     
-    return NULL;  // Student not found
+    STATS_END(STAT_SEARCH_ID, timer);
+    return current;  // NULL if the student was not found
 }
 
 Student** searchStudentsByName(Student* head, const char* name, int* count) {
+    STATS_BEGIN(timer);
+    
+    // Fold the query once; records carry their folded keys
+    char key[MAX_NAME_LENGTH];
+    foldSearchKey(key, name, MAX_NAME_LENGTH);
+    
     // First, count matching students
     *count = 0;
     Student* current = head;
     
     while (current != NULL) {
-        if (strstr(current->name, name) != NULL) {
+        if (!current->deleted && strstr(current->nameKey, key) != NULL) {
             (*count)++;
         }
         current = current->next;
     }
     
     if (*count == 0) {
+        STATS_END(STAT_SEARCH_NAME, timer);
         return NULL;
     }
     
     // Allocate array of pointers
-    Student** results = (Student**)malloc(sizeof(Student*) * (*count));
+    Student** results = (Student**)trackedMalloc(sizeof(Student*) * (*count), MEM_SEARCH_RESULTS);
     if (results == NULL) {
         *count = 0;
+        STATS_END(STAT_SEARCH_NAME, timer);
         return NULL;
     }
     
@@ -161,12 +378,13 @@ Student** searchStudentsByName(Student* head, const char* name, int* count) {
     int index = 0;
     
     while (current != NULL && index < *count) {
-        if (strstr(current->name, name) != NULL) {
+        if (!current->deleted && strstr(current->nameKey, key) != NULL) {
             results[index++] = current;
         }
         current = current->next;
     }
     
+    STATS_END(STAT_SEARCH_NAME, timer);
     return results;
 }
 
@@ -174,6 +392,14 @@ bool studentIdExists(Student* head, const char* id) {
     return searchStudentById(head, id) != NULL;
 }
 
+/* Display layouts, expanded from the schema: one card line per field, and table columns */
+#define DISPLAY_FIELD(member, kind, size, label, width) \
+    printf("║ %-8s%-47" SCHEMA_SPEC_##kind " ║\n", label ":", student->member);
+#define HEADING_FORMAT(member, kind, size, label, width) " %-" #width "s ║"
+#define HEADING_ARGUMENT(member, kind, size, label, width) , label
+#define ROW_FORMAT(member, kind, size, label, width) " %-" #width SCHEMA_SPEC_##kind " ║"
+#define ROW_ARGUMENT(member, kind, size, label, width) , student->member
+
 void displayStudent(const Student* student) {
     if (student == NULL) {
         printf("No student data to display.\n");
@@ -181,45 +407,121 @@ void displayStudent(const Student* student) {
     }
     
     printf("╔══════════════════════════════════════════════════════╗\n");
-    printf("║ ID:     %-47s ║\n", student->id);
-    printf("║ Name:   %-47s ║\n", student->name);
-    printf("║ Age:    %-47d ║\n", student->age);
-    printf("║ Course: %-47s ║\n", student->course);
-    printf("║ Grades: %-47s ║\n", student->grades);
+    STUDENT_FIELDS(DISPLAY_FIELD)
     printf("╚══════════════════════════════════════════════════════╝\n");
 }
 
+/**
+ * Print a horizontal table border, one segment per field
+ */
+static void displayTableBorder(const char* left, const char* middle, const char* right) {
+    static const int widths[] = { STUDENT_FIELDS(SCHEMA_WIDTH) };
+    
+    printf("%s", left);
+    for (int field = 0; field < STUDENT_FIELD_COUNT; field++) {
+        for (int i = 0; i < widths[field] + 2; i++) {
+            printf("═");
+        }
+        printf("%s", field + 1 < STUDENT_FIELD_COUNT ? middle : right);
+    }
+    printf("\n");
+}
+
+static void displayTableHeader(void) {
+    displayTableBorder("╔", "╦", "╗");
+    printf("║" STUDENT_FIELDS(HEADING_FORMAT) "\n" STUDENT_FIELDS(HEADING_ARGUMENT));
+    displayTableBorder("╠", "╬", "╣");
+}
+
+static void displayTableRow(const Student* student) {
+    printf("║" STUDENT_FIELDS(ROW_FORMAT) "\n" STUDENT_FIELDS(ROW_ARGUMENT));
+}
+
+static void displayTableFooter(void) {
+    displayTableBorder("╚", "╩", "╝");
+}
+
 int displayAllStudents(const Student* head) {
-    if (head == NULL) {
+    const Student* current = head;
+    while (current != NULL && current->deleted) {
+        current = current->next;
+    }
+    if (current == NULL) {
         printf("No students in the system.\n");
         return 0;
     }
     
-    const Student* current = head;
     int count = 0;
     
-    printf("╔═════════╦═════════════════════════╦═════╦═════════════════════╦═════════════╗\n");
-    printf("║ ID      ║ Name                    ║ Age ║ Course              ║ Grades      ║\n");
-    printf("╠═════════╬═════════════════════════╬═════╬═════════════════════╬═════════════╣\n");
+    displayTableHeader();
     
     while (current != NULL) {
-        printf("║ %-7s ║ %-25s ║ %-3d ║ %-19s ║ %-11s ║\n",
-               current->id, current->name, current->age, current->course, current->grades);
+        if (!current->deleted) {
+            displayTableRow(current);
+            count++;
+        }
         current = current->next;
+    }
+    
+    displayTableFooter();
+    return count;
+}
+
+int displayStudentsInIdOrder(const IdIndex* index) {
+    if (index == NULL || idIndexCount(index) == 0) {
+        printf("No students in the system.\n");
+        return 0;
+    }
+    
+    int count = 0;
+    
+    displayTableHeader();
+    
+    // The index is already ordered, so no sort pass is needed
+    for (const IdIndexNode* node = idIndexFirst(index); node != NULL; node = idIndexNext(node)) {
+        displayTableRow(idIndexStudent(node));
         count++;
     }
     
-    printf("╚═════════╩═════════════════════════╩═════╩═════════════════════╩═════════════╝\n");
+    displayTableFooter();
     return count;
 }
 
+int displayStudentArray(Student** students, int count) {
+    if (count == 0) {
+        printf("No students to display.\n");
+        return 0;
+    }
+    
+    displayTableHeader();
+    for (int i = 0; i < count; i++) {
+        displayTableRow(students[i]);
+    }
+    displayTableFooter();
+    return count;
+}
+
+void freeSearchResults(Student** results) {
+    trackedFree(results);
+}
+
+void freeStudent(Student* student) {
+    trackedFree(student);
+}
+
 void freeStudentList(Student* head) {
     Student* current = head;
     Student* next;
     
     while (current != NULL) {
         next = current->next;
-        free(current);
+        if (current->deleted) {
+            tombstones--;
+        }
+        if (current == compactCursor) {
+            compactCursor = NULL;
+        }
+        freeStudent(current);
         current = next;
     }
 }
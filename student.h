@@ -14,6 +14,7 @@
 #include <stdlib.h>  /* For memory allocation functions like malloc() */
 #include <string.h>  /* For string manipulation functions like strcpy() */
 #include <stdbool.h> /* For boolean data type */
+#include "schema.h"  /* Field list the members and record routines are expanded from */
 
 /* Maximum lengths for different student data fields */
 #define MAX_NAME_LENGTH 50    /* Maximum characters for student name */
@@ -21,6 +22,11 @@
 #define MAX_GRADES_LENGTH 20  /* Maximum characters for grades */
 #define ID_LENGTH 10          /* Fixed length for student ID */
 
+/* Compaction of deleted students (tombstones) */
+#define COMPACT_MIN_TOMBSTONES 16  /* Tombstones tolerated whatever the roster size */
+#define COMPACT_DEAD_PERCENT 25    /* Dead share of the roster that starts compaction */
+#define COMPACT_STEP 64            /* Nodes visited by the compaction step of one delete */
+
 /**
  * @struct Student
  * @brief Structure to store student information
@@ -28,16 +34,66 @@
  * This structure represents a single student in our system.
  * It stores personal and academic information, and contains
  * a pointer to the next student in the linked list.
+ *
+ * A deleted student stays linked as a tombstone until compaction
+ * unlinks and frees it, so pointers to it stay valid in the meantime.
+ * Every walk over the list skips tombstones.
+ *
+ * The stored fields (id, name, age, course, grades) are declared from
+ * STUDENT_FIELDS in schema.h; the members after them are derived or
+ * bookkeeping state that is never saved.
  */
 typedef struct Student {
-    char id[ID_LENGTH];         /* Unique identifier for each student */
-    char name[MAX_NAME_LENGTH]; /* Full name of the student */
-    int age;                    /* Age of the student */
-    char course[MAX_COURSE_LENGTH]; /* The course/program the student is enrolled in */
-    char grades[MAX_GRADES_LENGTH]; /* Student's academic grades */
+    STUDENT_FIELDS(SCHEMA_MEMBER)  /* Stored fields, in data file order */
+    char nameKey[MAX_NAME_LENGTH]; /* Lowercased, accent-folded name used by name searches */
+    bool deleted;               /* Tombstone: deleted, awaiting compaction */
     struct Student* next;       /* Pointer to the next student in the linked list - NULL if last student */
 } Student;
 
+/* Ordered ID index (see idindex.h) */
+struct IdIndex;
+
+/**
+ * @brief Attach an ID index that the list operations keep in sync
+ *
+ * While an index is attached, addStudent and deleteStudent (through
+ * removeStudent) update it and
+ * searchStudentById answers from it in O(log n) instead of scanning the
+ * list. The index must cover the same list that is passed to them.
+ *
+ * @param index Index to attach, or NULL to detach
+ */
+void attachIdIndex(struct IdIndex* index);
+
+/**
+ * @brief Get the attached ID index
+ * @return Attached index, or NULL if none
+ */
+struct IdIndex* getAttachedIdIndex(void);
+
+/* Sharded data file layout (see shard.h) */
+struct ShardSet;
+
+/**
+ * @brief Attach a shard set whose shards addStudent, removeStudent and
+ *        modifyStudent mark dirty, so a save rewrites only those shards
+ * @param set Shard set to attach, or NULL to detach
+ */
+void attachShardSet(struct ShardSet* set);
+
+/**
+ * @brief Get the attached shard set
+ * @return Attached shard set, or NULL if the roster is a single file
+ */
+struct ShardSet* getAttachedShardSet(void);
+
+/**
+ * @brief Get the version of the roster, bumped by every add, delete and modify
+ * @return Current version; a change means the roster differs from any
+ *         snapshot taken at an earlier version
+ */
+unsigned long studentStoreVersion(void);
+
 /**
  * @brief Create a new student node
  * @param id Student ID
@@ -49,6 +105,31 @@ typedef struct Student {
  */
 Student* createStudent(const char* id, const char* name, int age, const char* course, const char* grades);
 
+/**
+ * @brief Create a new student node from the stored fields of another
+ * @param fields Student whose schema fields are copied (other members are ignored)
+ * @return Pointer to the newly created student
+ */
+Student* createStudentFrom(const Student* fields);
+
+/**
+ * @brief Copy every stored field from one student to another
+ *
+ * Derived members such as nameKey are not updated.
+ *
+ * @param to Student to overwrite
+ * @param from Student to copy
+ */
+void copyStudentFields(Student* to, const Student* from);
+
+/**
+ * @brief Compare the stored fields of two students, in schema order
+ * @param first First student
+ * @param second Second student
+ * @return Negative, zero or positive like strcmp; zero if every field is equal
+ */
+int compareStudentFields(const Student* first, const Student* second);
+
 /**
  * @brief Add a student to the linked list
  * @param head Pointer to the head of the linked list
@@ -57,6 +138,15 @@ Student* createStudent(const char* id, const char* name, int age, const char* co
  */
 Student* addStudent(Student* head, Student* student);
 
+/**
+ * @brief Add a student after a known last node, without walking the list
+ * @param head Pointer to the head of the linked list (set if the list was empty)
+ * @param tail Pointer to the last node, or to NULL if the list is empty;
+ *             updated to the new student
+ * @param student Student to be added
+ */
+void appendStudent(Student** head, Student** tail, Student* student);
+
 /**
  * @brief Delete a student from the linked list
  * @param head Pointer to the head of the linked list
@@ -65,6 +155,45 @@ Student* addStudent(Student* head, Student* student);
  */
 Student* deleteStudent(Student* head, const char* id);
 
+/**
+ * @brief Delete a student without printing anything
+ *
+ * The student is found through the attached ID index and marked as a
+ * tombstone, so no predecessor search or free is needed. Once tombstones
+ * pass COMPACT_DEAD_PERCENT of the roster, each removal also runs one
+ * compaction step.
+ *
+ * @param head Pointer to the head of the linked list (updated in place)
+ * @param id ID of the student to remove
+ * @return true if the student was found and removed, false otherwise
+ */
+bool removeStudent(Student** head, const char* id);
+
+/**
+ * @brief Bring back a tombstone (used by rollbackTransaction)
+ * @param student Deleted student that is still linked into the list
+ */
+void restoreStudent(Student* student);
+
+/**
+ * @brief Unlink and free tombstones, resuming where the last call stopped
+ *
+ * Each call visits at most budget nodes, so compaction is spread over
+ * many operations instead of pausing for a full pass. Nothing is done
+ * while a transaction is open, since the undo log refers to list links.
+ *
+ * @param head Pointer to the head of the linked list (updated in place)
+ * @param budget Largest number of nodes to visit (-1 for a full pass)
+ * @return Number of tombstones freed
+ */
+int compactStudentList(Student** head, int budget);
+
+/**
+ * @brief Get the number of tombstones not yet compacted
+ * @return Deleted students still linked into a list
+ */
+int studentTombstoneCount(void);
+
 /**
  * @brief Modify a student's information
  * @param head Pointer to the head of the linked list
@@ -77,6 +206,14 @@ Student* deleteStudent(Student* head, const char* id);
  */
 bool modifyStudent(Student* head, const char* id, const char* name, int age, const char* course, const char* grades);
 
+/**
+ * @brief Replace every stored field of the student with the record's ID
+ * @param head Pointer to the head of the linked list
+ * @param record New values, including the ID of the student to modify
+ * @return true if student was found and modified, false otherwise
+ */
+bool updateStudent(Student* head, const Student* record);
+
 /**
  * @brief Search for a student by ID
  * @param head Pointer to the head of the linked list
@@ -86,11 +223,15 @@ bool modifyStudent(Student* head, const char* id, const char* name, int age, con
 Student* searchStudentById(Student* head, const char* id);
 
 /**
- * @brief Search for students by name
+ * @brief Search for students by name (case-insensitive, accents ignored)
+ *
+ * The query is folded once and matched against the search keys kept
+ * with every record, so the scan costs the same as an exact match.
+ *
  * @param head Pointer to the head of the linked list
  * @param name Name to search for
  * @param count Pointer to store the count of matching students
- * @return Array of pointers to matching students (must be freed by caller)
+ * @return Array of pointers to matching students (free with freeSearchResults)
  */
 Student** searchStudentsByName(Student* head, const char* name, int* count);
 
@@ -116,7 +257,34 @@ void displayStudent(const Student* student);
 int displayAllStudents(const Student* head);
 
 /**
- * @brief Free all memory allocated for the linked list
+ * @brief Display the students of an ID index in ID order
+ * @param index ID index over the linked list
+ * @return Number of students displayed
+ */
+int displayStudentsInIdOrder(const struct IdIndex* index);
+
+/**
+ * @brief Display an array of students as a table
+ * @param students Array of pointers to students
+ * @param count Number of students in the array
+ * @return Number of students displayed
+ */
+int displayStudentArray(Student** students, int count);
+
+/**
+ * @brief Free a result array returned by a name search
+ * @param results Array to free (the students themselves are not freed)
+ */
+void freeSearchResults(Student** results);
+
+/**
+ * @brief Free a single student that is not linked into a list
+ * @param student Student to free
+ */
+void freeStudent(Student* student);
+
+/**
+ * @brief Free all memory allocated for the linked list, tombstones included
  * @param head Pointer to the head of the linked list
  */
 void freeStudentList(Student* head);
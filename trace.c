@@ -0,0 +1,281 @@
+/**
+ * @file trace.c
+ * @brief Implementation of session trace recording and replay timing
+ */
+
+#include "trace.h"
+#include "utils.h"
+#include "memtrack.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_OPERATIONS 64   /* First size of the operation and timing arrays */
+
+static FILE* traceFile = NULL;
+static char* operationInput = NULL;  /* Input consumed so far, collected through inputEcho */
+static size_t operationLength = 0;
+static int currentChoice = 0;        /* Operation in progress, 0 if none */
+
+static const char* choiceNames[TRACE_MENU_CHOICES + 1] = {
+    "invalid", "add", "modify", "delete", "search", "display", "reports", "save"
+};
+
+/**
+ * Drop the input collected so far and start collecting again
+ */
+static void restartCollecting(void) {
+    if (inputEcho != NULL) {
+        fclose(inputEcho);
+    }
+    free(operationInput);
+    operationInput = NULL;
+    operationLength = 0;
+    inputEcho = open_memstream(&operationInput, &operationLength);
+}
+
+bool startTraceRecording(const char* filename) {
+    traceFile = fopen(filename, "w");
+    if (traceFile == NULL) {
+        fprintf(stderr, "Error: Could not open trace %s for writing.\n", filename);
+        return false;
+    }
+    fprintf(traceFile, "%s\n", TRACE_HEADER);
+    currentChoice = 0;
+    restartCollecting();
+    return true;
+}
+
+void traceBeginOperation(int choice) {
+    if (traceFile == NULL) {
+        return;
+    }
+    restartCollecting();
+    currentChoice = choice >= 1 && choice <= TRACE_MENU_CHOICES ? choice : 0;
+}
+
+void traceEndOperation(void) {
+    if (traceFile == NULL) {
+        return;
+    }
+
+    if (currentChoice != 0 && inputEcho != NULL) {
+        fflush(inputEcho);
+        size_t lines = 0;
+        for (size_t i = 0; i < operationLength; i++) {
+            lines += operationInput[i] == '\n';
+        }
+
+        // Input cut off by end of file still ends its line in the trace
+        bool unterminated = operationLength > 0 && operationInput[operationLength - 1] != '\n';
+        fprintf(traceFile, "@%d %zu\n", currentChoice, lines + unterminated);
+        fwrite(operationInput, 1, operationLength, traceFile);
+        if (unterminated) {
+            fputc('\n', traceFile);
+        }
+        fflush(traceFile);
+    }
+    currentChoice = 0;
+    restartCollecting();
+}
+
+void stopTraceRecording(void) {
+    if (traceFile == NULL) {
+        return;
+    }
+    traceEndOperation();
+    if (inputEcho != NULL) {
+        fclose(inputEcho);
+        inputEcho = NULL;
+    }
+    free(operationInput);
+    operationInput = NULL;
+    operationLength = 0;
+    fclose(traceFile);
+    traceFile = NULL;
+}
+
+static bool appendInput(TraceOperation* operation, const char* line, size_t length) {
+    char* input = (char*)trackedRealloc(operation->input, operation->length + length + 1, MEM_IO_BUFFERS);
+    if (input == NULL) {
+        return false;
+    }
+    memcpy(input + operation->length, line, length);
+    operation->length += length;
+    input[operation->length] = '\0';
+    operation->input = input;
+    return true;
+}
+
+static TraceOperation* addOperation(SessionTrace* trace, size_t* capacity) {
+    if (trace->count == *capacity) {
+        size_t grown = *capacity == 0 ? MIN_OPERATIONS : *capacity * 2;
+        TraceOperation* operations = (TraceOperation*)trackedRealloc(trace->operations,
+                                                                     grown * sizeof(TraceOperation),
+                                                                     MEM_IO_BUFFERS);
+        if (operations == NULL) {
+            return NULL;
+        }
+        trace->operations = operations;
+        *capacity = grown;
+    }
+
+    TraceOperation* operation = &trace->operations[trace->count++];
+    memset(operation, 0, sizeof(TraceOperation));
+    return operation;
+}
+
+SessionTrace* loadSessionTrace(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not open trace %s.\n", filename);
+        return NULL;
+    }
+
+    char* line = NULL;
+    size_t lineCapacity = 0;
+    ssize_t length = getline(&line, &lineCapacity, file);
+    if (length <= 0 || strncmp(line, TRACE_HEADER, strlen(TRACE_HEADER)) != 0) {
+        fprintf(stderr, "Error: %s is not a session trace.\n", filename);
+        free(line);
+        fclose(file);
+        return NULL;
+    }
+
+    SessionTrace* trace = (SessionTrace*)trackedCalloc(1, sizeof(SessionTrace), MEM_IO_BUFFERS);
+    size_t capacity = 0;
+    unsigned long long lineNumber = 1;
+    const char* problem = trace == NULL ? "out of memory" : NULL;
+
+    while (problem == NULL && (length = getline(&line, &lineCapacity, file)) > 0) {
+        lineNumber++;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        int choice;
+        unsigned long long lines;
+        if (sscanf(line, "@%d %llu", &choice, &lines) != 2 || choice < 1 || choice > TRACE_MENU_CHOICES) {
+            problem = "expected an operation (@CHOICE LINES)";
+            break;
+        }
+        TraceOperation* operation = addOperation(trace, &capacity);
+        if (operation == NULL) {
+            problem = "out of memory";
+            break;
+        }
+        operation->choice = choice;
+
+        for (unsigned long long i = 0; i < lines; i++) {
+            length = getline(&line, &lineCapacity, file);
+            if (length <= 0) {
+                problem = "the trace ends inside an operation";
+                break;
+            }
+            lineNumber++;
+            if (!appendInput(operation, line, (size_t)length)) {
+                problem = "out of memory";
+                break;
+            }
+        }
+    }
+
+    free(line);
+    fclose(file);
+    if (problem != NULL) {
+        fprintf(stderr, "%s:%llu: %s\n", filename, lineNumber, problem);
+        freeSessionTrace(trace);
+        return NULL;
+    }
+    return trace;
+}
+
+void freeSessionTrace(SessionTrace* trace) {
+    if (trace == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < trace->count; i++) {
+        trackedFree(trace->operations[i].input);
+    }
+    trackedFree(trace->operations);
+    trackedFree(trace);
+}
+
+const char* traceChoiceName(int choice) {
+    return choice >= 1 && choice <= TRACE_MENU_CHOICES ? choiceNames[choice] : choiceNames[0];
+}
+
+void recordReplayTiming(ReplayTimings* timings, int choice, uint64_t nanos) {
+    if (choice < 1 || choice > TRACE_MENU_CHOICES) {
+        return;
+    }
+
+    if (timings->count[choice] == timings->capacity[choice]) {
+        size_t capacity = timings->capacity[choice] == 0 ? MIN_OPERATIONS : timings->capacity[choice] * 2;
+        uint64_t* nanosList = (uint64_t*)trackedRealloc(timings->nanos[choice], capacity * sizeof(uint64_t),
+                                                        MEM_IO_BUFFERS);
+        if (nanosList == NULL) {
+            return;
+        }
+        timings->nanos[choice] = nanosList;
+        timings->capacity[choice] = capacity;
+    }
+    timings->nanos[choice][timings->count[choice]++] = nanos;
+}
+
+static int compareNanos(const void* a, const void* b) {
+    uint64_t first = *(const uint64_t*)a;
+    uint64_t second = *(const uint64_t*)b;
+    return (first > second) - (first < second);
+}
+
+/**
+ * Nearest-rank percentile of sorted durations
+ */
+static uint64_t percentile(const uint64_t* sorted, size_t count, double percent) {
+    size_t rank = (size_t)(percent / 100.0 * (double)count + 0.999999);
+    return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+void printReplayReport(FILE* out, ReplayTimings* timings, uint64_t totalNanos) {
+    char total[32], mean[32], p50[32], p99[32], max[32];
+    size_t operations = 0;
+
+    fprintf(out, "%-10s %8s %10s %10s %10s %10s %10s\n", "Operation", "Count", "Total", "Mean", "p50", "p99", "Max");
+    for (int choice = 1; choice <= TRACE_MENU_CHOICES; choice++) {
+        size_t count = timings->count[choice];
+        if (count == 0) continue;
+
+        uint64_t* sorted = timings->nanos[choice];
+        qsort(sorted, count, sizeof(uint64_t), compareNanos);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; i++) {
+            sum += sorted[i];
+        }
+
+        formatDuration(total, sizeof(total), sum);
+        formatDuration(mean, sizeof(mean), sum / count);
+        formatDuration(p50, sizeof(p50), percentile(sorted, count, 50.0));
+        formatDuration(p99, sizeof(p99), percentile(sorted, count, 99.0));
+        formatDuration(max, sizeof(max), sorted[count - 1]);
+        fprintf(out, "%-10s %8zu %10s %10s %10s %10s %10s\n", choiceNames[choice], count,
+                total, mean, p50, p99, max);
+        operations += count;
+    }
+
+    formatDuration(total, sizeof(total), totalNanos);
+    fprintf(out, "Replayed %zu operation(s) in %s", operations, total);
+    if (totalNanos > 0) {
+        fprintf(out, " (%.0f operations/s)", (double)operations * 1e9 / (double)totalNanos);
+    }
+    fprintf(out, "\n");
+}
+
+void freeReplayTimings(ReplayTimings* timings) {
+    for (int choice = 0; choice <= TRACE_MENU_CHOICES; choice++) {
+        trackedFree(timings->nanos[choice]);
+        timings->nanos[choice] = NULL;
+        timings->count[choice] = 0;
+        timings->capacity[choice] = 0;
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file trace.h
+ * @brief Header file containing session trace recording and replay timing
+ *
+ * A trace records an interactive session as the main menu operations it
+ * ran, each with the input its handler consumed:
+ *
+ *   # student-trace 1
+ *   @2 4            main menu choice, then the number of input lines
+ *   S4              the lines, exactly as the handler read them
+ *   1
+ *   Alice Smith
+ *   <empty line>
+ *
+ * Think time and screen output are not recorded, so a replay feeds the
+ * same handlers from the trace at full speed. Invalid main menu input is
+ * left out.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_HEADER "# student-trace 1"
+#define TRACE_MENU_CHOICES 7    /* Main menu choices 1 to 7 */
+
+/* One recorded main menu operation */
+typedef struct {
+    int choice;          /* Main menu choice, 1 to TRACE_MENU_CHOICES */
+    char* input;         /* Input the handler consumed, lines with their newlines */
+    size_t length;
+} TraceOperation;
+
+/* A trace read back from a file */
+typedef struct {
+    TraceOperation* operations;
+    size_t count;
+} SessionTrace;
+
+/* Durations of replayed operations, per main menu choice */
+typedef struct {
+    uint64_t* nanos[TRACE_MENU_CHOICES + 1];
+    size_t count[TRACE_MENU_CHOICES + 1];
+    size_t capacity[TRACE_MENU_CHOICES + 1];
+} ReplayTimings;
+
+/**
+ * @brief Start recording the session to a trace file
+ * @param filename Trace file to create or truncate
+ * @return true if the file could be created
+ */
+bool startTraceRecording(const char* filename);
+
+/**
+ * @brief Start an operation once its main menu choice has been read
+ *
+ * Input read before this (the choice itself) is not part of the operation.
+ *
+ * @param choice Main menu choice
+ */
+void traceBeginOperation(int choice);
+
+/**
+ * @brief Write the operation in progress, with the input it consumed,
+ *        before the next main menu choice is read
+ */
+void traceEndOperation(void);
+
+/**
+ * @brief Write the last operation and close the trace file
+ */
+void stopTraceRecording(void);
+
+/**
+ * @brief Read a trace file
+ * @param filename Trace file to read
+ * @return Trace, or NULL if the file is missing or malformed
+ */
+SessionTrace* loadSessionTrace(const char* filename);
+
+/**
+ * @brief Free a trace and its operations
+ * @param trace Trace to free
+ */
+void freeSessionTrace(SessionTrace* trace);
+
+/**
+ * @brief Get the name of a main menu choice, as used in reports
+ * @param choice Main menu choice
+ * @return Name, or "invalid"
+ */
+const char* traceChoiceName(int choice);
+
+/**
+ * @brief Add the duration of one replayed operation
+ * @param timings Timings to add to
+ * @param choice Main menu choice of the operation
+ * @param nanos Duration in nanoseconds
+ */
+void recordReplayTiming(ReplayTimings* timings, int choice, uint64_t nanos);
+
+/**
+ * @brief Print the count, total and percentiles of each kind of operation
+ * @param out Stream to print to
+ * @param timings Timings of the replay
+ * @param totalNanos Wall time of the whole replay
+ */
+void printReplayReport(FILE* out, ReplayTimings* timings, uint64_t totalNanos);
+
+/**
+ * @brief Free the recorded durations
+ * @param timings Timings to free
+ */
+void freeReplayTimings(ReplayTimings* timings);
+
+#endif /* TRACE_H */
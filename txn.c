@@ -0,0 +1,370 @@
+/**
+ * @file txn.c
+ * @brief Implementation of multi-statement transactions
+ */
+
+#include "txn.h"
+#include "fileio.h"
+#include "idindex.h"
+#include "memtrack.h"
+#include "stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define JOURNAL_LINE_LENGTH 256  /* Longest journal line, including the tag */
+
+_Static_assert(STUDENT_FIELDS_LENGTH + 3 <= JOURNAL_LINE_LENGTH,
+               "a journaled record must fit the line buffer");
+
+typedef enum {
+    UNDO_ADD,
+    UNDO_DELETE,
+    UNDO_MODIFY
+} UndoType;
+
+/* How to undo one change */
+typedef struct {
+    UndoType type;
+    Student* student;   /* Student that changed (a tombstone for UNDO_DELETE) */
+    Student* previous;  /* UNDO_ADD: tail before the append */
+    Student* before;    /* UNDO_MODIFY: copy of the fields before the change */
+} UndoEntry;
+
+static bool active = false;
+static bool incomplete = false;  /* An entry could not be logged */
+static UndoEntry* entries = NULL;
+static int entryCount = 0;
+static int entryCapacity = 0;
+
+static UndoEntry* appendEntry(UndoType type, Student* student) {
+    if (entryCount == entryCapacity) {
+        int capacity = entryCapacity == 0 ? 64 : entryCapacity * 2;
+        UndoEntry* grown = (UndoEntry*)trackedRealloc(entries, sizeof(UndoEntry) * capacity,
+                                                      MEM_TRANSACTIONS);
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Memory allocation failed for the undo log.\n");
+            incomplete = true;
+            return NULL;
+        }
+        entries = grown;
+        entryCapacity = capacity;
+    }
+
+    UndoEntry* entry = &entries[entryCount++];
+    entry->type = type;
+    entry->student = student;
+    entry->previous = NULL;
+    entry->before = NULL;
+    return entry;
+}
+
+/**
+ * Release the log; deleted students stay linked as tombstones for compaction
+ */
+static void clearLog(void) {
+    for (int i = 0; i < entryCount; i++) {
+        trackedFree(entries[i].before);
+    }
+    trackedFree(entries);
+    entries = NULL;
+    entryCount = 0;
+    entryCapacity = 0;
+    active = false;
+    incomplete = false;
+}
+
+bool beginTransaction(void) {
+    if (active) {
+        return false;
+    }
+    active = true;
+    incomplete = false;
+    return true;
+}
+
+bool transactionActive(void) {
+    return active;
+}
+
+int transactionChangeCount(void) {
+    return entryCount;
+}
+
+void txnLogAdd(Student* student, Student* previousTail) {
+    UndoEntry* entry = appendEntry(UNDO_ADD, student);
+    if (entry != NULL) {
+        entry->previous = previousTail;
+    }
+}
+
+void txnLogDelete(Student* student) {
+    appendEntry(UNDO_DELETE, student);
+}
+
+void txnLogModify(const Student* student) {
+    UndoEntry* entry = appendEntry(UNDO_MODIFY, (Student*)student);
+    if (entry == NULL) {
+        return;
+    }
+    entry->before = (Student*)trackedMalloc(sizeof(Student), MEM_TRANSACTIONS);
+    if (entry->before == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed for the undo log.\n");
+        entryCount--;
+        incomplete = true;
+        return;
+    }
+    memcpy(entry->before, student, sizeof(Student));
+}
+
+/**
+ * Append text to the commit buffer, growing it as needed
+ */
+static bool appendText(char** buffer, size_t* length, size_t* capacity, const char* text, size_t size) {
+    if (*length + size > *capacity) {
+        size_t grownCapacity = *capacity == 0 ? 64 * 1024 : *capacity * 2;
+        while (grownCapacity < *length + size) grownCapacity *= 2;
+        char* grown = (char*)trackedRealloc(*buffer, grownCapacity, MEM_IO_BUFFERS);
+        if (grown == NULL) {
+            return false;
+        }
+        *buffer = grown;
+        *capacity = grownCapacity;
+    }
+    memcpy(*buffer + *length, text, size);
+    *length += size;
+    return true;
+}
+
+/**
+ * Write the whole buffer with as few write calls as the kernel allows
+ */
+static bool writeAll(int fd, const char* buffer, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, buffer, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        buffer += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+bool commitTransaction(const char* journalFile) {
+    if (!active) {
+        return false;
+    }
+    if (entryCount == 0) {
+        clearLog();
+        return true;
+    }
+
+    STATS_BEGIN(timer);
+    char line[JOURNAL_LINE_LENGTH];
+    char* buffer = NULL;
+    size_t length = 0, capacity = 0;
+    bool ok = true;
+
+    // Each change is journaled with the record as it stands at commit;
+    // replaying them in order reaches the same final state
+    for (int i = 0; i < entryCount && ok; i++) {
+        const Student* student = entries[i].student;
+        int size;
+        if (entries[i].type == UNDO_DELETE) {
+            size = snprintf(line, sizeof(line), "D,%s\n", student->id);
+        } else {
+            line[0] = entries[i].type == UNDO_ADD ? 'A' : 'M';
+            line[1] = ',';
+            size = 2 + formatStudentFields(line + 2, student);
+            line[size++] = '\n';
+        }
+        ok = appendText(&buffer, &length, &capacity, line, (size_t)size);
+    }
+    ok = ok && appendText(&buffer, &length, &capacity, "C\n", 2);
+
+    int fd = ok ? open(journalFile, O_WRONLY | O_CREAT | O_APPEND, 0644) : -1;
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open journal %s: %s\n", journalFile,
+                ok ? strerror(errno) : "out of memory");
+        trackedFree(buffer);
+        return false;
+    }
+
+    ok = writeAll(fd, buffer, length) && fsync(fd) == 0;
+    if (!ok) {
+        fprintf(stderr, "Error: Could not write journal %s: %s\n", journalFile, strerror(errno));
+    }
+    close(fd);
+    trackedFree(buffer);
+
+    if (ok) {
+        clearLog();
+        STATS_END(STAT_COMMIT, timer);
+    }
+    return ok;
+}
+
+bool rollbackTransaction(Student** head) {
+    if (!active) {
+        return false;
+    }
+    if (incomplete) {
+        fprintf(stderr, "Error: The undo log is incomplete; the transaction can't be rolled back.\n");
+        return false;
+    }
+
+    IdIndex* index = getAttachedIdIndex();
+
+    // Undo newest first, so every change sees the list exactly as it was
+    // right after that change was made
+    for (int i = entryCount - 1; i >= 0; i--) {
+        UndoEntry* entry = &entries[i];
+        Student* student = entry->student;
+
+        switch (entry->type) {
+            case UNDO_ADD: // It was the tail, and is again now
+                if (entry->previous != NULL) {
+                    entry->previous->next = NULL;
+                } else {
+                    *head = NULL;
+                }
+                if (index != NULL) {
+                    idIndexRemove(index, student->id);
+                }
+                freeStudent(student);
+                break;
+
+            case UNDO_DELETE: // Still linked as a tombstone
+                // A lazily loaded record is only dropped after the commit,
+                // so it never became one
+                if (student->deleted) {
+                    restoreStudent(student);
+                }
+                break;
+
+            case UNDO_MODIFY: // Restore the fields, keeping the list link
+                entry->before->next = student->next;
+                memcpy(student, entry->before, sizeof(Student));
+                break;
+        }
+    }
+
+    clearLog();
+    return true;
+}
+
+/**
+ * Add a journaled record, or overwrite the student with the same ID, so
+ * replaying over a file that already holds the change is harmless. The
+ * tail is found once and then followed; NULL means it must be looked up.
+ */
+static void upsertStudent(Student** head, Student** tail, Student* record) {
+    if (studentIdExists(*head, record->id)) {
+        updateStudent(*head, record);
+        freeStudent(record);
+        return;
+    }
+    if (*tail == NULL) {
+        Student* last = *head;
+        while (last != NULL && last->next != NULL) {
+            last = last->next;
+        }
+        *tail = last;
+    }
+    appendStudent(head, tail, record);
+}
+
+/**
+ * Apply one journal line (without its newline)
+ */
+static void applyJournalLine(Student** head, Student** tail, char* line) {
+    if (line[0] == 'D' && line[1] == ',') {
+        // The deleted student may have been the tail
+        if (removeStudent(head, line + 2)) {
+            *tail = NULL;
+        }
+    } else if ((line[0] == 'A' || line[0] == 'M') && line[1] == ',') {
+        Student* record = parseStudentLine(line + 2);
+        if (record != NULL) {
+            upsertStudent(head, tail, record);
+        }
+    }
+}
+
+/**
+ * Cut the journal back to the end of its last complete transaction, so
+ * the next commit isn't appended to the partial lines of a torn one
+ */
+static bool cutJournal(const char* journalFile, long length) {
+    int fd = open(journalFile, O_WRONLY);
+    bool ok = fd >= 0 && ftruncate(fd, length) == 0 && fsync(fd) == 0;
+    if (!ok) {
+        fprintf(stderr, "Error: Could not cut the incomplete transaction from journal %s: %s\n",
+                journalFile, strerror(errno));
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return ok;
+}
+
+int replayJournal(const char* journalFile, Student** head) {
+    FILE* file = fopen(journalFile, "r");
+    if (file == NULL) {
+        return 0;
+    }
+
+    char line[JOURNAL_LINE_LENGTH];
+    long committedEnd = 0;
+    int transactions = 0;
+
+    // First pass: find where the last complete transaction ends
+    while (fgets(line, sizeof(line), file)) {
+        if (strcmp(line, "C\n") == 0) {
+            committedEnd = ftell(file);
+            transactions++;
+        }
+    }
+
+    // Whatever follows the last commit marker was torn by a crash
+    if (ftell(file) > committedEnd) {
+        cutJournal(journalFile, committedEnd);
+    }
+
+    rewind(file);
+    Student* tail = NULL;
+    while (ftell(file) < committedEnd && fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\n")] = '\0';
+        applyJournalLine(head, &tail, line);
+    }
+
+    fclose(file);
+    return transactions;
+}
+
+bool journalIsEmpty(const char* journalFile) {
+    FILE* file = fopen(journalFile, "r");
+    if (file == NULL) {
+        return true;
+    }
+    bool empty = fgetc(file) == EOF;
+    fclose(file);
+    return empty;
+}
+
+bool truncateJournal(const char* journalFile) {
+    if (!doesFileExist(journalFile)) {
+        return true;
+    }
+    FILE* file = fopen(journalFile, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not truncate journal %s.\n", journalFile);
+        return false;
+    }
+    return fclose(file) == 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file txn.h
+ * @brief Header file containing multi-statement transactions
+ *
+ * Between beginTransaction and commitTransaction, addStudent,
+ * deleteStudent and modifyStudent record how to undo each change in an
+ * in-memory undo log, so the whole group can be rolled back. Committing
+ * appends the resulting records to a journal with a single write and a
+ * single fsync, however many changes the transaction holds. The journal
+ * is replayed on startup to recover committed changes that were not yet
+ * saved, and truncated after every full save.
+ *
+ * Journal lines are "A,<record>" (add), "M,<record>" (modify), "D,<id>"
+ * (delete) and "C" (end of a committed transaction). Lines after the
+ * last "C" belong to an interrupted commit and are ignored.
+ */
+
+#ifndef TXN_H
+#define TXN_H
+
+#include "student.h"
+
+#define JOURNAL_FILE "students.journal"  /* Journal of committed transactions */
+
+/**
+ * @brief Start a transaction
+ * @return true if started, false if a transaction is already open
+ */
+bool beginTransaction(void);
+
+/**
+ * @brief Check if a transaction is open
+ * @return true between beginTransaction and commit or rollback
+ */
+bool transactionActive(void);
+
+/**
+ * @brief Get the number of changes in the open transaction
+ * @return Number of logged adds, deletes and modifies
+ */
+int transactionChangeCount(void);
+
+/**
+ * @brief Make the changes of the open transaction durable and close it
+ * @param journalFile Journal to append the changes to
+ * @return true if committed; false if no transaction is open or the
+ *         journal could not be written (the transaction then stays open)
+ */
+bool commitTransaction(const char* journalFile);
+
+/**
+ * @brief Undo every change of the open transaction and close it
+ * @param head Pointer to the head of the linked list (updated in place)
+ * @return true if rolled back, false if no transaction is open or the
+ *         undo log is incomplete
+ */
+bool rollbackTransaction(Student** head);
+
+/**
+ * @brief Apply the committed transactions of a journal to the list
+ *
+ * An incomplete transaction after the last commit marker is cut from
+ * the journal, so later commits start on a clean line.
+ *
+ * @param journalFile Journal to replay
+ * @param head Pointer to the head of the linked list (updated in place)
+ * @return Number of transactions replayed
+ */
+int replayJournal(const char* journalFile, Student** head);
+
+/**
+ * @brief Check if a journal holds anything to replay
+ * @param journalFile Journal to check
+ * @return true if the journal is missing or empty
+ */
+bool journalIsEmpty(const char* journalFile);
+
+/**
+ * @brief Empty the journal once its changes are in the data file
+ * @param journalFile Journal to truncate
+ * @return true if the journal is empty or doesn't exist
+ */
+bool truncateJournal(const char* journalFile);
+
+/**
+ * @brief Log an added student (called by addStudent)
+ * @param student Student that was appended
+ * @param previousTail Last student before the append, or NULL if the list was empty
+ */
+void txnLogAdd(Student* student, Student* previousTail);
+
+/**
+ * @brief Log a removed student (called by deleteStudent)
+ * @param student Student just marked as a tombstone; it stays linked, and
+ *        compaction waits for the transaction to end
+ */
+void txnLogDelete(Student* student);
+
+/**
+ * @brief Log the fields of a student before a change (called by modifyStudent)
+ * @param student Student about to be modified
+ */
+void txnLogModify(const Student* student);
+
+#endif /* TXN_H */
@@ -5,11 +5,25 @@
 
 #include "ui.h"
 #include "utils.h"
+#include "stats.h"
+#include "memtrack.h"
+#include "fuzzy.h"
+#include "idindex.h"
+#include "dedup.h"
+#include "autosave.h"
+#include "reload.h"
+#include "txn.h"
+#include "filter.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
+#define MAX_DUPLICATES_SHOWN 20  /* Pairs listed by the duplicate report */
+
+bool uiHeadless = false;
+const char* uiJournalFile = JOURNAL_FILE;
+
 void displayMainMenu() {
     printf("\n");
     printf("╔══════════════════════════════════════════════════╗\n");
@@ -20,44 +34,22 @@ void displayMainMenu() {
     printf("║ 3. Delete a student                              ║\n");
     printf("║ 4. Search for a student                          ║\n");
     printf("║ 5. Display all students                          ║\n");
-    printf("║ 6. Save and exit                                 ║\n");
+    printf("║ 6. Reports and statistics                        ║\n");
+    printf("║ 7. Save and exit                                 ║\n");
     printf("╚══════════════════════════════════════════════════╝\n");
-    printf("Enter your choice (1-6): ");
+    printf("Enter your choice (1-7): ");
 }
 
-Student* handleAddStudent(Student* head) {
-    char id[ID_LENGTH];
-    char name[MAX_NAME_LENGTH];
-    int age;
-    char course[MAX_COURSE_LENGTH];
-    char grades[MAX_GRADES_LENGTH];
-    
-    clearScreen();
-    printf("╔══════════════════════════════════════════════════╗\n");
-    printf("║               ADD A NEW STUDENT                  ║\n");
-    printf("╚══════════════════════════════════════════════════╝\n\n");
-    
-    // Get student ID
-    do {
-        printf("Enter student ID (max %d chars): ", ID_LENGTH - 1);
-        if (!getStringInput(id, ID_LENGTH)) {
-            printf("Error reading input. Please try again.\n");
-            continue;
-        }
-        
-        // Check if ID already exists
-        if (studentIdExists(head, id)) {
-            printf("Error: A student with ID %s already exists. Please use a different ID.\n", id);
-            continue;
-        }
-        
-        break;
-    } while (1);
-    
+/**
+ * Prompt for every field of a new student except the ID
+ * @return false if the input ran out first
+ */
+static bool promptStudentDetails(char* name, int* age, char* course, char* grades) {
     // Get student name
     do {
         printf("Enter student name (max %d chars): ", MAX_NAME_LENGTH - 1);
         if (!getStringInput(name, MAX_NAME_LENGTH)) {
+            if (inputEnded()) return false;
             printf("Error reading input. Please try again.\n");
             continue;
         }
@@ -67,7 +59,8 @@ Student* handleAddStudent(Student* head) {
     // Get student age
     do {
         printf("Enter student age (1-120): ");
-        if (!getIntInput(&age) || age < 1 || age > 120) {
+        if (!getIntInput(age) || *age < 1 || *age > 120) {
+            if (inputEnded()) return false;
             printf("Please enter a valid age between 1 and 120.\n");
             continue;
         }
@@ -78,6 +71,7 @@ Student* handleAddStudent(Student* head) {
     do {
         printf("Enter student course (max %d chars): ", MAX_COURSE_LENGTH - 1);
         if (!getStringInput(course, MAX_COURSE_LENGTH)) {
+            if (inputEnded()) return false;
             printf("Error reading input. Please try again.\n");
             continue;
         }
@@ -88,70 +82,94 @@ Student* handleAddStudent(Student* head) {
     do {
         printf("Enter student grades (max %d chars): ", MAX_GRADES_LENGTH - 1);
         if (!getStringInput(grades, MAX_GRADES_LENGTH)) {
+            if (inputEnded()) return false;
             printf("Error reading input. Please try again.\n");
             continue;
         }
         break;
     } while (1);
     
-    // Create and add the student
-    Student* newStudent = createStudent(id, name, age, course, grades);
-    if (newStudent == NULL) {
-        printf("Error: Failed to create student. Memory allocation failed.\n");
-        return head;
-    }
-    
-    Student* updatedHead = addStudent(head, newStudent);
-    printf("\nStudent added successfully!\n");
-    waitForEnter();
-    
-    return updatedHead;
+    return true;
 }
 
-void handleModifyStudent(Student* head) {
+Student* handleAddStudent(Student* head) {
     char id[ID_LENGTH];
-    int choice;
     char name[MAX_NAME_LENGTH];
     int age;
     char course[MAX_COURSE_LENGTH];
     char grades[MAX_GRADES_LENGTH];
-    bool modified = false;
     
     clearScreen();
     printf("╔══════════════════════════════════════════════════╗\n");
-    printf("║             MODIFY STUDENT DETAILS               ║\n");
+    printf("║               ADD A NEW STUDENT                  ║\n");
     printf("╚══════════════════════════════════════════════════╝\n\n");
     
-    if (head == NULL) {
-        printf("There are no students in the system.\n");
-        waitForEnter();
-        return;
-    }
+    // Get student ID
+    do {
+        printf("Enter student ID (max %d chars): ", ID_LENGTH - 1);
+        if (!getStringInput(id, ID_LENGTH)) {
+            if (inputEnded()) return head;
+            printf("Error reading input. Please try again.\n");
+            continue;
+        }
+        
+        // Check if ID already exists
+        if (studentIdExists(head, id)) {
+            printf("Error: A student with ID %s already exists. Please use a different ID.\n", id);
+            continue;
+        }
+        
+        break;
+    } while (1);
     
-    // Display all students for reference
-    printf("Current students in the system:\n");
-    displayAllStudents(head);
-    printf("\n");
+    if (!promptStudentDetails(name, &age, course, grades)) {
+        return head;
+    }
     
-    // Get student ID to modify
-    printf("Enter the ID of the student to modify: ");
-    if (!getStringInput(id, ID_LENGTH)) {
-        printf("Error reading input.\n");
-        waitForEnter();
-        return;
+    // Create and add the student
+    Student* newStudent = createStudent(id, name, age, course, grades);
+    if (newStudent == NULL) {
+        printf("Error: Failed to create student. Memory allocation failed.\n");
+        return head;
     }
     
-    // Search for the student
-    Student* student = searchStudentById(head, id);
-    if (student == NULL) {
-        printf("No student found with ID %s.\n", id);
+    // Each menu change is its own transaction, so it is journaled (and
+    // survives a crash) as soon as it is made
+    beginTransaction();
+    Student* updatedHead = addStudent(head, newStudent);
+    if (!commitTransaction(uiJournalFile)) {
+        rollbackTransaction(&updatedHead);
+        printf("\nError: Failed to record the new student. Nothing was added.\n");
         waitForEnter();
-        return;
+        return updatedHead;
     }
+    printf("\nStudent added successfully!\n");
+    waitForEnter();
     
-    // Display current details
-    printf("\nCurrent details of student ID %s:\n", id);
-    displayStudent(student);
+    return updatedHead;
+}
+
+/**
+ * Modify a student as a single transaction, so the change is journaled
+ * before it is reported as done
+ */
+static bool modifyAndCommit(Student* head, const char* id, const char* name, int age,
+                            const char* course, const char* grades) {
+    beginTransaction();
+    if (modifyStudent(head, id, name, age, course, grades) && commitTransaction(uiJournalFile)) {
+        return true;
+    }
+    rollbackTransaction(&head);
+    return false;
+}
+
+/**
+ * Ask which fields to change and read their new values. Fields that are
+ * not changed keep their current values in the buffers.
+ * @return true if the buffers hold values to apply, false if canceled
+ */
+static bool promptFieldChanges(const Student* student, char* name, int* age, char* course, char* grades) {
+    int choice;
     
     // Select what to modify
     printf("\nWhat would you like to modify?\n");
@@ -165,13 +183,12 @@ void handleModifyStudent(Student* head) {
     
     if (!getIntInput(&choice) || choice < 1 || choice > 6) {
         printf("Invalid choice. Modification canceled.\n");
-        waitForEnter();
-        return;
+        return false;
     }
     
     // Initialize with default values (no change)
     strncpy(name, student->name, MAX_NAME_LENGTH);
-    age = student->age;
+    *age = student->age;
     strncpy(course, student->course, MAX_COURSE_LENGTH);
     strncpy(grades, student->grades, MAX_GRADES_LENGTH);
     
@@ -179,58 +196,95 @@ void handleModifyStudent(Student* head) {
     switch (choice) {
         case 1: // Name only
             printf("Enter new name: ");
-            if (getStringInput(name, MAX_NAME_LENGTH)) {
-                modified = modifyStudent(head, id, name, -1, NULL, NULL);
-            }
-            break;
+            return getStringInput(name, MAX_NAME_LENGTH);
             
         case 2: // Age only
             printf("Enter new age (1-120): ");
-            if (getIntInput(&age) && age >= 1 && age <= 120) {
-                modified = modifyStudent(head, id, NULL, age, NULL, NULL);
-            } else {
+            if (!getIntInput(age) || *age < 1 || *age > 120) {
                 printf("Invalid age. Modification canceled.\n");
+                return false;
             }
-            break;
+            return true;
             
         case 3: // Course only
             printf("Enter new course: ");
-            if (getStringInput(course, MAX_COURSE_LENGTH)) {
-                modified = modifyStudent(head, id, NULL, -1, course, NULL);
-            }
-            break;
+            return getStringInput(course, MAX_COURSE_LENGTH);
             
         case 4: // Grades only
             printf("Enter new grades: ");
-            if (getStringInput(grades, MAX_GRADES_LENGTH)) {
-                modified = modifyStudent(head, id, NULL, -1, NULL, grades);
-            }
-            break;
+            return getStringInput(grades, MAX_GRADES_LENGTH);
             
         case 5: // All fields
             printf("Enter new name: ");
-            if (!getStringInput(name, MAX_NAME_LENGTH)) break;
+            if (!getStringInput(name, MAX_NAME_LENGTH)) return false;
             
             printf("Enter new age (1-120): ");
-            if (!getIntInput(&age) || age < 1 || age > 120) {
+            if (!getIntInput(age) || *age < 1 || *age > 120) {
                 printf("Invalid age. Modification canceled.\n");
-                break;
+                return false;
             }
             
             printf("Enter new course: ");
-            if (!getStringInput(course, MAX_COURSE_LENGTH)) break;
+            if (!getStringInput(course, MAX_COURSE_LENGTH)) return false;
             
             printf("Enter new grades: ");
-            if (!getStringInput(grades, MAX_GRADES_LENGTH)) break;
-            
-            modified = modifyStudent(head, id, name, age, course, grades);
-            break;
-            
-        case 6: // Cancel
-            printf("Modification canceled.\n");
-            waitForEnter();
-            return;
+            return getStringInput(grades, MAX_GRADES_LENGTH);
+    }
+    
+    // Cancel
+    printf("Modification canceled.\n");
+    return false;
+}
+
+void handleModifyStudent(Student* head) {
+    char id[ID_LENGTH];
+    char name[MAX_NAME_LENGTH];
+    int age;
+    char course[MAX_COURSE_LENGTH];
+    char grades[MAX_GRADES_LENGTH];
+    bool modified = false;
+    
+    clearScreen();
+    printf("╔══════════════════════════════════════════════════╗\n");
+    printf("║             MODIFY STUDENT DETAILS               ║\n");
+    printf("╚══════════════════════════════════════════════════╝\n\n");
+    
+    if (head == NULL) {
+        printf("There are no students in the system.\n");
+        waitForEnter();
+        return;
+    }
+    
+    // Display all students for reference
+    printf("Current students in the system:\n");
+    displayAllStudents(head);
+    printf("\n");
+    
+    // Get student ID to modify
+    printf("Enter the ID of the student to modify: ");
+    if (!getStringInput(id, ID_LENGTH)) {
+        printf("Error reading input.\n");
+        waitForEnter();
+        return;
+    }
+    
+    // Search for the student
+    Student* student = searchStudentById(head, id);
+    if (student == NULL) {
+        printf("No student found with ID %s.\n", id);
+        waitForEnter();
+        return;
+    }
+    
+    // Display current details
+    printf("\nCurrent details of student ID %s:\n", id);
+    displayStudent(student);
+    
+    if (!promptFieldChanges(student, name, &age, course, grades)) {
+        waitForEnter();
+        return;
     }
+    modified = modifyAndCommit(head, id, name, age, course, grades);
     
     if (modified) {
         printf("\nStudent details updated successfully!\n");
@@ -283,7 +337,7 @@ Student* handleDeleteStudent(Student* head) {
     displayStudent(student);
     
     printf("\nAre you sure you want to delete this student? (y/n): ");
-    if (!scanf(" %c", &confirmation)) {
+    if (!getCharInput(&confirmation)) {
         printf("Error reading input.\n");
         waitForEnter();
         return head;
@@ -293,7 +347,14 @@ Student* handleDeleteStudent(Student* head) {
     clearInputBuffer();
     
     if (tolower(confirmation) == 'y') {
+        beginTransaction();
         head = deleteStudent(head, id);
+        if (!commitTransaction(uiJournalFile)) {
+            rollbackTransaction(&head);
+            printf("Error: Failed to record the deletion. The student was kept.\n");
+            waitForEnter();
+            return head;
+        }
         printf("Student deleted successfully.\n");
     } else {
         printf("Deletion canceled.\n");
@@ -309,20 +370,126 @@ void displaySearchMenu() {
     printf("╠══════════════════════════════════════════════════╣\n");
     printf("║ 1. Search by ID                                  ║\n");
     printf("║ 2. Search by Name                                ║\n");
-    printf("║ 3. Return to Main Menu                           ║\n");
+    printf("║ 3. Fuzzy search by Name (tolerates typos)        ║\n");
+    printf("║ 4. Search by ID range                            ║\n");
+    printf("║ 5. Filter expression                             ║\n");
+    printf("║ 6. Return to Main Menu                           ║\n");
     printf("╚══════════════════════════════════════════════════╝\n");
-    printf("Enter your choice (1-3): ");
+    printf("Enter your choice (1-6): ");
+}
+
+static void showIdSearchResult(const Student* foundStudent, const char* searchId) {
+    if (foundStudent != NULL) {
+        printf("\nStudent found:\n");
+        displayStudent(foundStudent);
+    } else {
+        printf("\nNo student found with ID %s.\n", searchId);
+    }
+}
+
+static void showNameSearchResults(Student** results, int count, const char* searchName) {
+    if (count > 0) {
+        printf("\nFound %d student(s) matching '%s':\n\n", count, searchName);
+        for (int i = 0; i < count; i++) {
+            displayStudent(results[i]);
+            printf("\n");
+        }
+    } else {
+        printf("\nNo students found with name containing '%s'.\n", searchName);
+    }
+}
+
+static bool readFuzzyQuery(char* searchName, int* maxDistance) {
+    printf("Enter student name to search (typos tolerated): ");
+    if (!getStringInput(searchName, MAX_NAME_LENGTH)) {
+        printf("Error reading input.\n");
+        return false;
+    }
+    
+    printf("Enter maximum number of typos (1-%d): ", MAX_FUZZY_DISTANCE);
+    if (!getIntInput(maxDistance) || *maxDistance < 1 || *maxDistance > MAX_FUZZY_DISTANCE) {
+        printf("Please enter a number between 1 and %d.\n", MAX_FUZZY_DISTANCE);
+        return false;
+    }
+    return true;
+}
+
+static bool readIdRange(char* low, char* high) {
+    printf("Enter the lowest ID of the range: ");
+    if (!getStringInput(low, ID_LENGTH)) {
+        printf("Error reading input.\n");
+        return false;
+    }
+    printf("Enter the highest ID of the range: ");
+    if (!getStringInput(high, ID_LENGTH)) {
+        printf("Error reading input.\n");
+        return false;
+    }
+    return true;
+}
+
+static void showIdRangeResults(Student** results, int count, const char* low, const char* high) {
+    if (count > 0) {
+        printf("\nFound %d student(s) with IDs from %s to %s:\n\n", count, low, high);
+        displayStudentArray(results, count);
+    } else {
+        printf("\nNo students found with IDs from %s to %s.\n", low, high);
+    }
+}
+
+static FilterProgram* readFilter(char* text) {
+    char error[128];
+    
+    printf("Fields: id, name, age, course, grades. Operators: == != < <= > >= ~ between\n");
+    printf("Example: course == \"Physics\" and age between 18 and 21 and name ~ \"son\"\n");
+    printf("Enter filter expression: ");
+    if (!getStringInput(text, MAX_FILTER_LENGTH)) {
+        printf("Error reading input.\n");
+        return NULL;
+    }
+    
+    FilterProgram* program = compileFilter(text, error, sizeof(error));
+    if (program == NULL) {
+        printf("Invalid filter: %s\n", error);
+    }
+    return program;
+}
+
+static void showFilterResults(Student** results, int count, const char* text) {
+    if (count > 0) {
+        printf("\nFound %d student(s) matching %s:\n\n", count, text);
+        displayStudentArray(results, count);
+    } else {
+        printf("\nNo students match %s.\n", text);
+    }
+}
+
+static void showFuzzySearchResults(const FuzzyMatch* matches, int count, const char* searchName) {
+    if (count > 0) {
+        printf("\nFound %d student(s) close to '%s' (best matches first):\n\n", count, searchName);
+        for (int i = 0; i < count; i++) {
+            printf("Typos: %d\n", matches[i].distance);
+            displayStudent(matches[i].student);
+            printf("\n");
+        }
+    } else {
+        printf("\nNo students found with a name close to '%s'.\n", searchName);
+    }
 }
 
 void handleSearchStudent(Student* head) {
     int choice;
     char searchId[ID_LENGTH];
+    char highId[ID_LENGTH];
     char searchName[MAX_NAME_LENGTH];
+    char filterText[MAX_FILTER_LENGTH];
+    int maxDistance;
+    int count = 0;
     
     clearScreen();
     displaySearchMenu();
     
-    if (!getIntInput(&choice) || choice < 1 || choice > 3) {
+    if (!getIntInput(&choice) || choice < 1 || choice > 6) {
         printf("Invalid choice. Returning to main menu.\n");
         waitForEnter();
         return;
@@ -336,45 +503,582 @@ void handleSearchStudent(Student* head) {
                 break;
             }
             
-            Student* foundStudent = searchStudentById(head, searchId);
-            if (foundStudent != NULL) {
-                printf("\nStudent found:\n");
-                displayStudent(foundStudent);
-            } else {
-                printf("\nNo student found with ID %s.\n", searchId);
-            }
+            showIdSearchResult(searchStudentById(head, searchId), searchId);
             break;
             
         case 2: // Search by Name
-            printf("Enter student name to search (partial match supported): ");
+            printf("Enter student name to search (partial, case-insensitive): ");
             if (!getStringInput(searchName, MAX_NAME_LENGTH)) {
                 printf("Error reading input.\n");
                 break;
             }
             
-            int count = 0;
             Student** results = searchStudentsByName(head, searchName, &count);
+            showNameSearchResults(results, count, searchName);
+            freeSearchResults(results);
+            break;
+            
+        case 3: // Fuzzy search by Name, ranked by number of typos
+            if (!readFuzzyQuery(searchName, &maxDistance)) {
+                break;
+            }
+            
+            FuzzyMatch* matches = searchStudentsByNameFuzzy(head, searchName, maxDistance, &count);
+            showFuzzySearchResults(matches, count, searchName);
+            freeFuzzyMatches(matches);
+            break;
+            
+        case 4: // Search by ID range, in ID order
+            if (!readIdRange(searchId, highId)) {
+                break;
+            }
+            
+            Student** rangeResults = NULL;
+            IdIndex* index = getAttachedIdIndex();
+            if (index != NULL) {
+                rangeResults = idIndexRange(index, searchId, highId, &count);
+            }
+            showIdRangeResults(rangeResults, count, searchId, highId);
+            freeSearchResults(rangeResults);
+            break;
             
-            if (count > 0) {
-                printf("\nFound %d student(s) matching '%s':\n\n", count, searchName);
-                for (int i = 0; i < count; i++) {
-                    displayStudent(results[i]);
-                    printf("\n");
-                }
-                free(results);
-            } else {
-                printf("\nNo students found with name containing '%s'.\n", searchName);
+        case 5: { // Filter expression, compiled once and run over the roster
+            FilterProgram* program = readFilter(filterText);
+            if (program == NULL) {
+                break;
             }
+            
+            Student** filterResults = searchStudentsByFilter(head, program, &count);
+            showFilterResults(filterResults, count, filterText);
+            freeSearchResults(filterResults);
+            freeFilter(program);
             break;
+        }
             
-        case 3: // Return to main menu
+        case 6: // Return to main menu
             return;
     }
     
     waitForEnter();
 }
 
-void clearScreen() {
+void handleLazyAddStudent(LazyStudentFile* file) {
+    char id[ID_LENGTH];
+    char name[MAX_NAME_LENGTH];
+    int age;
+    char course[MAX_COURSE_LENGTH];
+    char grades[MAX_GRADES_LENGTH];
+    
+    clearScreen();
+    printf("╔══════════════════════════════════════════════════╗\n");
+    printf("║               ADD A NEW STUDENT                  ║\n");
+    printf("╚══════════════════════════════════════════════════╝\n\n");
+    
+    // Get student ID, checked against the index and the one matching record
+    do {
+        printf("Enter student ID (max %d chars): ", ID_LENGTH - 1);
+        if (!getStringInput(id, ID_LENGTH)) {
+            if (inputEnded()) return;
+            printf("Error reading input. Please try again.\n");
+            continue;
+        }
+        
+        if (lazyStudentIdExists(file, id)) {
+            printf("Error: A student with ID %s already exists. Please use a different ID.\n", id);
+            continue;
+        }
+        
+        break;
+    } while (1);
+    
+    if (!promptStudentDetails(name, &age, course, grades)) {
+        return;
+    }
+    
+    Student* newStudent = createStudent(id, name, age, course, grades);
+    if (newStudent == NULL) {
+        printf("Error: Failed to create student. Memory allocation failed.\n");
+        return;
+    }
+    
+    // Journaled like an add to the full roster; a lazy file is only opened
+    // with an empty journal, so the add is its only entry until a save
+    Student* unlinked = NULL;
+    beginTransaction();
+    txnLogAdd(newStudent, NULL);
+    if (!commitTransaction(uiJournalFile)) {
+        rollbackTransaction(&unlinked);
+        printf("\nError: Failed to record the new student. Nothing was added.\n");
+        waitForEnter();
+        return;
+    }
+    if (!lazyPutStudent(file, newStudent)) {
+        freeStudent(newStudent);
+        printf("Error: Failed to add the student. It is restored from %s on the next start.\n",
+               uiJournalFile);
+        waitForEnter();
+        return;
+    }
+    
+    printf("\nStudent added successfully!\n");
+    waitForEnter();
+}
+
+void handleLazyDeleteStudent(LazyStudentFile* file) {
+    char id[ID_LENGTH];
+    char confirmation;
+    
+    clearScreen();
+    printf("╔══════════════════════════════════════════════════╗\n");
+    printf("║                DELETE A STUDENT                  ║\n");
+    printf("╚══════════════════════════════════════════════════╝\n\n");
+    
+    if (lazyStudentCount(file) == 0) {
+        printf("There are no students in the system.\n");
+        waitForEnter();
+        return;
+    }
+    
+    // Get student ID to delete; only that record is parsed
+    printf("Enter the ID of the student to delete: ");
+    if (!getStringInput(id, ID_LENGTH)) {
+        printf("Error reading input.\n");
+        waitForEnter();
+        return;
+    }
+    
+    Student* student = lazyGetStudent(file, id);
+    if (student == NULL) {
+        printf("No student found with ID %s.\n", id);
+        waitForEnter();
+        return;
+    }
+    
+    // Display student details and confirm deletion
+    printf("\nStudent details:\n");
+    displayStudent(student);
+    
+    printf("\nAre you sure you want to delete this student? (y/n): ");
+    if (!getCharInput(&confirmation)) {
+        printf("Error reading input.\n");
+        waitForEnter();
+        return;
+    }
+    
+    // Clear input buffer
+    clearInputBuffer();
+    
+    if (tolower(confirmation) != 'y') {
+        printf("Deletion canceled.\n");
+        waitForEnter();
+        return;
+    }
+    
+    // Journaled like a delete from the full roster; the cached record is
+    // only dropped from the overlay once the commit is on disk
+    Student* unlinked = NULL;
+    beginTransaction();
+    txnLogDelete(student);
+    if (!commitTransaction(uiJournalFile)) {
+        rollbackTransaction(&unlinked);
+        printf("Error: Failed to record the deletion. The student was kept.\n");
+        waitForEnter();
+        return;
+    }
+    lazyDeleteStudent(file, id);
+    
+    printf("Student deleted successfully.\n");
+    waitForEnter();
+}
+
+void handleLazySearchStudent(LazyStudentFile* file) {
+    int choice;
+    char searchId[ID_LENGTH];
+    char highId[ID_LENGTH];
+    char searchName[MAX_NAME_LENGTH];
+    char filterText[MAX_FILTER_LENGTH];
+    int maxDistance;
+    int count = 0;
+    
+    clearScreen();
+    displaySearchMenu();
+    
+    if (!getIntInput(&choice) || choice < 1 || choice > 6) {
+        printf("Invalid choice. Returning to main menu.\n");
+        waitForEnter();
+        return;
+    }
+    
+    switch (choice) {
+        case 1: // Search by ID, materializing only the requested record
+            printf("Enter student ID to search: ");
+            if (!getStringInput(searchId, ID_LENGTH)) {
+                printf("Error reading input.\n");
+                break;
+            }
+            
+            showIdSearchResult(lazyGetStudent(file, searchId), searchId);
+            break;
+            
+        case 2: // Search by Name, materializing only the matches
+            printf("Enter student name to search (partial, case-insensitive): ");
+            if (!getStringInput(searchName, MAX_NAME_LENGTH)) {
+                printf("Error reading input.\n");
+                break;
+            }
+            
+            Student** results = lazySearchStudentsByName(file, searchName, &count);
+            showNameSearchResults(results, count, searchName);
+            freeSearchResults(results);
+            break;
+            
+        case 3: // Fuzzy search by Name, ranked by number of typos
+            if (!readFuzzyQuery(searchName, &maxDistance)) {
+                break;
+            }
+            
+            FuzzyMatch* matches = lazySearchStudentsByNameFuzzy(file, searchName, maxDistance, &count);
+            showFuzzySearchResults(matches, count, searchName);
+            freeFuzzyMatches(matches);
+            break;
+            
+        case 4: // Search by ID range, in ID order
+            if (!readIdRange(searchId, highId)) {
+                break;
+            }
+            
+            Student** rangeResults = lazySearchStudentsByIdRange(file, searchId, highId, &count);
+            showIdRangeResults(rangeResults, count, searchId, highId);
+            freeSearchResults(rangeResults);
+            break;
+            
+        case 5: { // Filter expression, compiled once and run over the roster
+            FilterProgram* program = readFilter(filterText);
+            if (program == NULL) {
+                break;
+            }
+            
+            Student** filterResults = lazySearchStudentsByFilter(file, program, &count);
+            showFilterResults(filterResults, count, filterText);
+            freeSearchResults(filterResults);
+            freeFilter(program);
+            break;
+        }
+            
+        case 6: // Return to main menu
+            return;
+    }
+    
+    waitForEnter();
+}
+
+void handleSharedAddStudent(SharedRoster* roster) {
+    char id[ID_LENGTH];
+    char name[MAX_NAME_LENGTH];
+    int age;
+    char course[MAX_COURSE_LENGTH];
+    char grades[MAX_GRADES_LENGTH];
+    
+    clearScreen();
+    printf("╔══════════════════════════════════════════════════╗\n");
+    printf("║               ADD A NEW STUDENT                  ║\n");
+    printf("╚══════════════════════════════════════════════════╝\n\n");
+    
+    do {
+        printf("Enter student ID (max %d chars): ", ID_LENGTH - 1);
+        if (!getStringInput(id, ID_LENGTH)) {
+            if (inputEnded()) return;
+            printf("Error reading input. Please try again.\n");
+            continue;
+        }
+        
+        if (sharedStudentIdExists(roster, id)) {
+            printf("Error: A student with ID %s already exists. Please use a different ID.\n", id);
+            continue;
+        }
+        
+        break;
+    } while (1);
+    
+    if (!promptStudentDetails(name, &age, course, grades)) {
+        return;
+    }
+    
+    // The record is copied into the segment; another session may have
+    // taken the ID while the details were being typed
+    Student* newStudent = createStudent(id, name, age, course, grades);
+    bool added = newStudent != NULL && sharedAddStudent(roster, newStudent);
+    freeStudent(newStudent);
+    
+    if (added) {
+        printf("\nStudent added successfully!\n");
+    } else {
+        printf("\nError: Failed to add student %s.\n", id);
+    }
+    waitForEnter();
+}
+
+void handleSharedModifyStudent(SharedRoster* roster) {
+    char id[ID_LENGTH];
+    char name[MAX_NAME_LENGTH];
+    int age;
+    char course[MAX_COURSE_LENGTH];
+    char grades[MAX_GRADES_LENGTH];
+    Student student;
+    
+    clearScreen();
+    printf("╔══════════════════════════════════════════════════╗\n");
+    printf("║             MODIFY STUDENT DETAILS               ║\n");
+    printf("╚══════════════════════════════════════════════════╝\n\n");
+    
+    printf("Enter the ID of the student to modify: ");
+    if (!getStringInput(id, ID_LENGTH)) {
+        printf("Error reading input.\n");
+        waitForEnter();
+        return;
+    }
+    
+    if (!sharedGetStudent(roster, id, &student)) {
+        printf("No student found with ID %s.\n", id);
+        waitForEnter();
+        return;
+    }
+    
+    printf("\nCurrent details of student ID %s:\n", id);
+    displayStudent(&student);
+    
+    if (!promptFieldChanges(&student, name, &age, course, grades)) {
+        waitForEnter();
+        return;
+    }
+    
+    if (sharedModifyStudent(roster, id, name, age, course, grades) &&
+        sharedGetStudent(roster, id, &student)) {
+        printf("\nStudent details updated successfully!\n");
+        displayStudent(&student);
+    } else {
+        printf("\nFailed to update student details.\n");
+    }
+    
+    waitForEnter();
+}
+
+void handleSharedDeleteStudent(SharedRoster* roster) {
+    char id[ID_LENGTH];
+    char confirmation;
+    Student student;
+    
+    clearScreen();
+    printf("╔══════════════════════════════════════════════════╗\n");
+    printf("║                DELETE A STUDENT                  ║\n");
+    printf("╚══════════════════════════════════════════════════╝\n\n");
+    
+    printf("Enter the ID of the student to delete: ");
+    if (!getStringInput(id, ID_LENGTH)) {
+        printf("Error reading input.\n");
+        waitForEnter();
+        return;
+    }
+    
+    if (!sharedGetStudent(roster, id, &student)) {
+        printf("No student found with ID %s.\n", id);
+        waitForEnter();
+        return;
+    }
+    
+    printf("\nStudent details:\n");
+    displayStudent(&student);
+    
+    printf("\nAre you sure you want to delete this student? (y/n): ");
+    if (!getCharInput(&confirmation)) {
+        printf("Error reading input.\n");
+        waitForEnter();
+        return;
+    }
+    clearInputBuffer();
+    
+    if (tolower(confirmation) != 'y') {
+        printf("Deletion canceled.\n");
+    } else if (sharedDeleteStudent(roster, id)) {
+        printf("Student deleted successfully.\n");
+    } else {
+        printf("Student with ID %s was already deleted by another session.\n", id);
+    }
+    
+    waitForEnter();
+}
+
+void handleSharedSearchStudent(SharedRoster* roster) {
+    int choice;
+    char searchId[ID_LENGTH];
+    char highId[ID_LENGTH];
+    char searchName[MAX_NAME_LENGTH];
+    char filterText[MAX_FILTER_LENGTH];
+    int maxDistance;
+    int count = 0;
+    Student student;
+    
+    clearScreen();
+    displaySearchMenu();
+    
+    if (!getIntInput(&choice) || choice < 1 || choice > 6) {
+        printf("Invalid choice. Returning to main menu.\n");
+        waitForEnter();
+        return;
+    }
+    
+    switch (choice) {
+        case 1: // Search by ID, through the shared hash table
+            printf("Enter student ID to search: ");
+            if (!getStringInput(searchId, ID_LENGTH)) {
+                printf("Error reading input.\n");
+                break;
+            }
+            
+            showIdSearchResult(sharedGetStudent(roster, searchId, &student) ? &student : NULL, searchId);
+            break;
+            
+        case 2: // Search by Name
+            printf("Enter student name to search (partial, case-insensitive): ");
+            if (!getStringInput(searchName, MAX_NAME_LENGTH)) {
+                printf("Error reading input.\n");
+                break;
+            }
+            
+            Student** results = sharedSearchStudentsByName(roster, searchName, &count);
+            showNameSearchResults(results, count, searchName);
+            freeSearchResults(results);
+            break;
+            
+        case 3: // Fuzzy search by Name, ranked by number of typos
+            if (!readFuzzyQuery(searchName, &maxDistance)) {
+                break;
+            }
+            
+            FuzzyMatch* matches = sharedSearchStudentsByNameFuzzy(roster, searchName, maxDistance, &count);
+            showFuzzySearchResults(matches, count, searchName);
+            freeFuzzyMatches(matches);
+            break;
+            
+        case 4: // Search by ID range, in ID order
+            if (!readIdRange(searchId, highId)) {
+                break;
+            }
+            
+            Student** rangeResults = sharedSearchStudentsByIdRange(roster, searchId, highId, &count);
+            showIdRangeResults(rangeResults, count, searchId, highId);
+            freeSearchResults(rangeResults);
+            break;
+            
+        case 5: { // Filter expression, compiled once and run over the roster
+            FilterProgram* program = readFilter(filterText);
+            if (program == NULL) {
+                break;
+            }
+            
+            Student** filterResults = sharedSearchStudentsByFilter(roster, program, &count);
+            showFilterResults(filterResults, count, filterText);
+            freeSearchResults(filterResults);
+            freeFilter(program);
+            break;
+        }
+            
+        case 6: // Return to main menu
+            return;
+    }
+    
+    waitForEnter();
+}
+
+void displayReportsMenu() {
+    printf("╔══════════════════════════════════════════════════╗\n");
+    printf("║             REPORTS AND STATISTICS               ║\n");
+    printf("╠══════════════════════════════════════════════════╣\n");
+    printf("║ 1. Operation latency statistics                  ║\n");
+    printf("║ 2. Memory footprint                              ║\n");
+    printf("║ 3. Duplicate candidates                          ║\n");
+    printf("║ 4. Autosave status                               ║\n");
+    printf("║ 5. Live reload status                            ║\n");
+    printf("║ 6. Return to Main Menu                           ║\n");
+    printf("╚══════════════════════════════════════════════════╝\n");
+    printf("Enter your choice (1-6): ");
+}
+
+/**
+ * Show the most similar pairs of students that may be the same person
+ */
+static void showDuplicateCandidates(Student* head) {
+    int count = 0;
+    DuplicateCandidate* candidates = findDuplicateCandidates(head, DEFAULT_DUPLICATE_THRESHOLD, &count);
+    
+    if (count == 0) {
+        printf("\nNo duplicate candidates found.\n");
+        return;
+    }
+    
+    printf("\n%-6s %-10s %-25s %-10s %-25s\n", "Score", "ID", "Name", "ID", "Name");
+    for (int i = 0; i < count && i < MAX_DUPLICATES_SHOWN; i++) {
+        printf("%-6.3f %-10s %-25s %-10s %-25s\n", candidates[i].similarity,
+               candidates[i].first->id, candidates[i].first->name,
+               candidates[i].second->id, candidates[i].second->name);
+    }
+    if (count > MAX_DUPLICATES_SHOWN) {
+        printf("... showing the %d most similar of %d pairs.\n", MAX_DUPLICATES_SHOWN, count);
+    } else {
+        printf("\nFound %d duplicate candidate pair(s).\n", count);
+    }
+    freeDuplicateCandidates(candidates);
+}
+
+void handleReports(Student* head) {
+    int choice;
+    
+    clearScreen();
+    displayReportsMenu();
+    
+    if (!getIntInput(&choice) || choice < 1 || choice > 6) {
+        printf("Invalid choice. Returning to main menu.\n");
+        waitForEnter();
+        return;
+    }
+    
+    switch (choice) {
+        case 1: // Latency percentiles per operation
+            printf("\n");
+            printStats(stdout);
+            break;
+            
+        case 2: // Live and peak memory per category
+            printf("\n");
+            printMemoryReport(stdout);
+            break;
+            
+        case 3: // Same course and similar names under different IDs
+            showDuplicateCandidates(head);
+            break;
+            
+        case 4: // Background snapshot interval, duration and size
+            printf("\n");
+            printAutosaveReport(stdout);
+            break;
+            
+        case 5: // Changes reconciled from the data file on disk
+            printf("\n");
+            printLiveReloadReport(stdout);
+            break;
+            
+        case 6: // Return to main menu
+            return;
+    }
+    
+    waitForEnter();
+}
+
+void clearScreen() {
+    if (uiHeadless) {
+        return;
+    }
+    
     // This is a cross-platform way to clear the screen
     #ifdef _WIN32
         system("cls");
@@ -386,5 +1090,5 @@ void clearScreen() {
 void waitForEnter() {
     printf("\nPress Enter to continue...");
     clearInputBuffer();
-    getchar();
+    getInputChar();
 }
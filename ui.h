@@ -7,6 +7,14 @@
 #define UI_H
 
 #include "student.h"
+#include "lazyload.h"
+#include "shmroster.h"
+
+/* Set while a trace is replayed: clearScreen does nothing */
+extern bool uiHeadless;
+
+/* Journal the menu handlers commit to; JOURNAL_FILE unless a trace is replayed */
+extern const char* uiJournalFile;
 
 /**
  * @brief Display the main menu of the application
@@ -44,6 +52,59 @@ void handleSearchStudent(Student* head);
  */
 void displaySearchMenu();
 
+/**
+ * @brief Display the reports and statistics menu
+ */
+void displayReportsMenu();
+
+/**
+ * @brief Handle the reports and statistics menu
+ * @param head Pointer to the head of the linked list
+ */
+void handleReports(Student* head);
+
+/**
+ * @brief Handle the add student operation on a lazily opened file
+ * @param file Lazily opened student data file
+ */
+void handleLazyAddStudent(LazyStudentFile* file);
+
+/**
+ * @brief Handle the delete student operation on a lazily opened file
+ * @param file Lazily opened student data file
+ */
+void handleLazyDeleteStudent(LazyStudentFile* file);
+
+/**
+ * @brief Handle the search student operation on a lazily opened file
+ * @param file Lazily opened student data file
+ */
+void handleLazySearchStudent(LazyStudentFile* file);
+
+/**
+ * @brief Handle the add student operation on the shared roster
+ * @param roster Shared roster
+ */
+void handleSharedAddStudent(SharedRoster* roster);
+
+/**
+ * @brief Handle the modify student operation on the shared roster
+ * @param roster Shared roster
+ */
+void handleSharedModifyStudent(SharedRoster* roster);
+
+/**
+ * @brief Handle the delete student operation on the shared roster
+ * @param roster Shared roster
+ */
+void handleSharedDeleteStudent(SharedRoster* roster);
+
+/**
+ * @brief Handle the search student operation on the shared roster
+ * @param roster Shared roster
+ */
+void handleSharedSearchStudent(SharedRoster* roster);
+
 /**
  * @brief Clear the console screen (platform-independent)
  */
@@ -11,13 +11,37 @@
 #include <ctype.h>
 #include <time.h>
 
+FILE* inputStream = NULL;
+FILE* inputEcho = NULL;
+
+/**
+ * Read a line (or as much of it as fits) and echo it to the trace recorder
+ */
+static bool readInputLine(char* buffer, int size) {
+    if (!fgets(buffer, size, inputStream != NULL ? inputStream : stdin)) {
+        return false;
+    }
+    if (inputEcho != NULL) {
+        fputs(buffer, inputEcho);
+    }
+    return true;
+}
+
+int getInputChar() {
+    int c = getc(inputStream != NULL ? inputStream : stdin);
+    if (c != EOF && inputEcho != NULL) {
+        putc(c, inputEcho);
+    }
+    return c;
+}
+
 void clearInputBuffer() {
     int c;
-    while ((c = getchar()) != '\n' && c != EOF);
+    while ((c = getInputChar()) != '\n' && c != EOF);
 }
 
 bool getStringInput(char* buffer, int maxLength) {
-    if (!fgets(buffer, maxLength, stdin)) {
+    if (!readInputLine(buffer, maxLength)) {
         return false;
     }
     
@@ -45,7 +69,7 @@ bool getStringInput(char* buffer, int maxLength) {
 bool getIntInput(int* value) {
     char buffer[20]; // Large enough for any integer
     
-    if (!fgets(buffer, sizeof(buffer), stdin)) {
+    if (!readInputLine(buffer, sizeof(buffer))) {
         return false;
     }
     
@@ -75,6 +99,79 @@ bool getIntInput(int* value) {
     return (*endptr == '\0');
 }
 
+bool getCharInput(char* value) {
+    int c;
+    do {
+        c = getInputChar();
+    } while (c != EOF && isspace(c));
+    
+    if (c == EOF) {
+        return false;
+    }
+    *value = (char)c;
+    return true;
+}
+
+bool inputEnded() {
+    return feof(inputStream != NULL ? inputStream : stdin) != 0;
+}
+
+/*
+ * Base letters for U+00C0 to U+017F; '\0' keeps the character unchanged.
+ * Uppercase and lowercase forms fold to the same lowercase letter.
+ */
+static const char accentFolds[192] =
+    "aaaaaaaceeeeiiii" "dnooooo\0ouuuuy\0s"   /* U+00C0 - U+00DF */
+    "aaaaaaaceeeeiiii" "dnooooo\0ouuuuy\0y"   /* U+00E0 - U+00FF */
+    "aaaaaaccccccccdd" "ddeeeeeeeeeegggg"     /* U+0100 - U+011F */
+    "gggghhhhiiiiiiii" "iiiijjkkklllllll"     /* U+0120 - U+013F */
+    "lllnnnnnnnnnoooo" "oooorrrrrrssssss"     /* U+0140 - U+015F */
+    "ssttttttuuuuuuuu" "uuuuwwyyyzzzzzzs";    /* U+0160 - U+017F */
+
+void foldSearchKey(char* dest, const char* src, int maxLength) {
+    const unsigned char* in = (const unsigned char*)src;
+    int out = 0;
+    
+    while (*in != '\0' && out < maxLength - 1) {
+        unsigned char c = *in;
+        
+        if (c < 0x80) {
+            dest[out++] = (char)tolower(c);
+            in++;
+            continue;
+        }
+        
+        // Two-byte sequences cover U+0080 to U+07FF
+        if ((c & 0xE0) == 0xC0 && (in[1] & 0xC0) == 0x80) {
+            unsigned codePoint = ((unsigned)(c & 0x1F) << 6) | (in[1] & 0x3F);
+            if (codePoint >= 0xC0 && codePoint <= 0x17F && accentFolds[codePoint - 0xC0] != '\0') {
+                dest[out++] = accentFolds[codePoint - 0xC0];
+                in += 2;
+                continue;
+            }
+        }
+        
+        // Copy any other sequence whole, or not at all if it doesn't fit
+        int length = 1;
+        if ((c & 0xE0) == 0xC0) length = 2;
+        else if ((c & 0xF0) == 0xE0) length = 3;
+        else if ((c & 0xF8) == 0xF0) length = 4;
+        
+        int available = 0;
+        while (available < length && in[available] != '\0') {
+            available++;
+        }
+        if (out + available > maxLength - 1) {
+            break;
+        }
+        memcpy(dest + out, in, available);
+        out += available;
+        in += available;
+    }
+    
+    dest[out] = '\0';
+}
+
 void generateBackupFilename(char* buffer, const char* prefix, 
                            const char* extension, int maxLength) {
     time_t now = time(NULL);
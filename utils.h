@@ -7,12 +7,25 @@
 #define UTILS_H
 
 #include <stdbool.h>
+#include <stdio.h>
+
+/* Stream the input functions read from; NULL reads stdin (set while a trace is replayed) */
+extern FILE* inputStream;
+
+/* When set, every byte the input functions consume is copied here (trace recording) */
+extern FILE* inputEcho;
 
 /**
  * @brief Clear the input buffer
  */
 void clearInputBuffer();
 
+/**
+ * @brief Read one character of input
+ * @return The character, or EOF
+ */
+int getInputChar();
+
 /**
  * @brief Get a string input with validation
  * @param buffer Buffer to store the input
@@ -28,6 +41,32 @@ bool getStringInput(char* buffer, int maxLength);
  */
 bool getIntInput(int* value);
 
+/**
+ * @brief Get the next character that isn't whitespace, like scanf(" %c")
+ * @param value Pointer to store the character
+ * @return true if a character was read, false at end of input
+ */
+bool getCharInput(char* value);
+
+/**
+ * @brief Check if the input has run out, so prompts that retry should give up
+ * @return true once a read has hit end of input
+ */
+bool inputEnded();
+
+/**
+ * @brief Build a normalized search key: lowercased, with accented Latin
+ *        letters (UTF-8, U+00C0 to U+017F) folded to their base letter
+ *
+ * The key is never longer than the input, so a buffer of the input's
+ * size is always large enough.
+ *
+ * @param dest Buffer to store the key
+ * @param src Text to normalize
+ * @param maxLength Size of the destination buffer
+ */
+void foldSearchKey(char* dest, const char* src, int maxLength);
+
 /**
  * @brief Generate a unique filename using the current timestamp
  * @param buffer Buffer to store the generated filename